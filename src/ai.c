@@ -1,6 +1,17 @@
 /* Simple AI utilities: a basic evaluator and a negamax search with
    alpha-beta pruning. We keep heuristics readable and lightweight. */
 #include "ai.h"
+#include "profile.h"
+#include <stdio.h>
+#include <string.h>
+
+int eval_weights[EVAL_NUM_TERMS] = {
+  MOBILITY_WEIGHT, MATERIAL_WEIGHT, CORNER_WEIGHT, EDGE_WEIGHT, JUMP_POTENTIAL_WEIGHT, ISOLATION_PENALTY
+};
+
+const char *const eval_term_names[EVAL_NUM_TERMS] = {
+  "mobility", "material", "corner", "edge", "jump_potential", "isolation"
+};
 
 // Seed rand (used by simple AI heuristics/random moves)
 void ai_init(void) {
@@ -9,281 +20,295 @@ void ai_init(void) {
 
 // Choose a random valid move (fallback, for very simple AI behavior)
 bool ai_random_move(Board *board, bool is_white_turn, MoveSequence *chosen_seq) {
-  MoveSequence all_moves[MAX_MOVES];
-  int num_moves = generate_all_moves(board, is_white_turn, all_moves);
-
-  if (num_moves == 0) return false;
-
-  int rand_idx = rand() % num_moves;
-  *chosen_seq = all_moves[rand_idx];
-
-  return true;
+  /* Seeded from rand() so ai_init's srand still controls it */
+  uint64_t state = (((uint64_t)rand() << 31) ^ (uint64_t)rand()) | 1;
+  return sample_random_move(board, is_white_turn, &state, chosen_seq);
 }
 
-/* Direction vectors: up, right, down, left */
-static const int dir_row[4] = {-1, 0, 1, 0};
-static const int dir_col[4] = {0, 1, 0, -1};
-
-int eval_position(Board *board, bool player_is_white) {  
-  int score = 0;
+// Evaluate a position from a player's perspective (see kernel_impl.h)
+int eval_position(Board *board, bool player_is_white) {
+  PROFILE_PHASE(PROF_EVAL);
+  return cpu_kernels->eval_position(board, player_is_white);
+}
 
-  MoveSequence white_moves[MAX_MOVES];
-  MoveSequence black_moves[MAX_MOVES];
+// eval_position for n boards, four at a time with AVX2 (see kernel_impl.h)
+void eval_batch(const Board *boards, int n, const bool *player_is_white, int *scores) {
+  PROFILE_PHASE(PROF_EVAL);
+  cpu_kernels->eval_batch(boards, n, player_is_white, scores);
+}
 
-  // Mobility
-  int white_mob = generate_all_moves(board, true, white_moves);
-  int black_mob = generate_all_moves(board, false, black_moves);
+// The terms of eval_position, White minus Black; false at a decided position
+bool eval_terms(const Board *board, int *terms) {
+  PROFILE_PHASE(PROF_EVAL);
+  return cpu_kernels->eval_terms(board, terms);
+}
 
-  int mob_diff = white_mob - black_mob;
+/* Every line is "name value" ('#' starts a comment); terms that are not
+   listed keep their current weight */
+bool eval_weights_load(const char *path) {
+  FILE *f = fopen(path, "r");
+  if (!f) return false;
+
+  int weights[EVAL_NUM_TERMS];
+  memcpy(weights, eval_weights, sizeof(weights));
+  char line[256], name[64];
+  int value;
+  bool ok = true;
+
+  while (ok && fgets(line, sizeof(line), f)) {
+    char *p = line + strspn(line, " \t");
+    if (*p == '#' || *p == '\n' || *p == '\0') continue;
+
+    ok = sscanf(p, "%63s %d", name, &value) == 2;
+    int t = 0;
+    while (ok && t < EVAL_NUM_TERMS && strcmp(name, eval_term_names[t])) t++;
+    if (t == EVAL_NUM_TERMS) ok = false;
+    if (ok) weights[t] = value;
+  }
+  fclose(f);
 
-  if (player_is_white) score += mob_diff * MOBILITY_WEIGHT;  
-  else score -= mob_diff * MOBILITY_WEIGHT;  
+  if (ok) memcpy(eval_weights, weights, sizeof(weights));
+  return ok;
+}
 
-  // Material
-  int white_stone_count = popcount(board->white);
-  int black_stone_count = popcount(board->black);
+bool eval_weights_save(const int *weights, const char *path) {
+  FILE *f = fopen(path, "w");
+  if (!f) return false;
 
-  int stone_diff = white_stone_count - black_stone_count;
+  fprintf(f, "# konane evaluation weights (%dx%d)\n", BOARD_SIZE, BOARD_SIZE);
+  for (int t = 0; t < EVAL_NUM_TERMS; t++) fprintf(f, "%s %d\n", eval_term_names[t], weights[t]);
+  return fclose(f) == 0;
+}
 
-  if (player_is_white) score += stone_diff * MATERIAL_WEIGHT;  
-  else score -= stone_diff * MATERIAL_WEIGHT;  
+// Back to the compiled-in defaults
+void eval_weights_reset(void) {
+  const int defaults[EVAL_NUM_TERMS] = {
+    MOBILITY_WEIGHT, MATERIAL_WEIGHT, CORNER_WEIGHT, EDGE_WEIGHT, JUMP_POTENTIAL_WEIGHT, ISOLATION_PENALTY
+  };
+  memcpy(eval_weights, defaults, sizeof(defaults));
+}
 
-  // Corners
-  Bitboard corner_mask = get_bitmask(0, 0) | get_bitmask(0, BOARD_SIZE-1) |
-                         get_bitmask(BOARD_SIZE-1, 0) | get_bitmask(BOARD_SIZE-1, BOARD_SIZE-1);
+static bool engine_out_of_budget(Engine *eng);
 
-  int white_corners = popcount(board->white & corner_mask);
-  int black_corners = popcount(board->black & corner_mask);
-  int corner_diff = white_corners - black_corners;
+/* Move ordering keys: hash move, then the two killers, then history */
+#define ORDER_TT_MOVE 1000000000
+#define ORDER_KILLER_1 900000000
+#define ORDER_KILLER_2 800000000
 
-  if (player_is_white) score += corner_diff * CORNER_WEIGHT;  
-  else score -= corner_diff * CORNER_WEIGHT;  
+static int seq_from(const MoveSequence *seq) {
+    return MOVE_FROM(seq->jumps[0]);
+}
 
-  // Edges
-  Bitboard edge_mask = 0;
-  for (int i = 0; i < BOARD_SIZE; i++) {
-    edge_mask |= get_bitmask(0, i);
-    edge_mask |= get_bitmask(BOARD_SIZE-1, i);
-    edge_mask |= get_bitmask(i, 0);
-    edge_mask |= get_bitmask(i, BOARD_SIZE-1);
-  }
+static int seq_to(const MoveSequence *seq) {
+    return MOVE_TO(seq->jumps[seq->count - 1]);
+}
 
-  edge_mask &= ~corner_mask;
-
-  int white_edges = popcount(board->white & edge_mask);
-  int black_edges = popcount(board->black & edge_mask);
-  int edge_diff = white_edges - black_edges;
-
-  if (player_is_white) score += edge_diff * EDGE_WEIGHT;  
-  else score -= edge_diff * EDGE_WEIGHT;  
-
-  // Jump potential
-  int white_jump_potential = 0;
-  int black_jump_potential = 0;
-
-  Bitboard white_stones_bb = board->white;
-  while (white_stones_bb) {
-    int idx = pop_lsb(&white_stones_bb);
-    int row, col;
-    index_to_coord(idx, &row, &col);
-    
-    for (int dir = 0; dir < 4; dir++) {
-      int jump_row = row + dir_row[dir];
-      int jump_col = col + dir_col[dir];
-      int land_row = row + 2 * dir_row[dir];
-      int land_col = col + 2 * dir_col[dir];
-      
-      if (is_valid_position(jump_row, jump_col) && 
-        is_valid_position(land_row, land_col)) {
-        if (is_black(board, jump_row, jump_col) &&
-          is_empty(board, land_row, land_col)) {
-          white_jump_potential++;
-        }
-      }
-    }
-  }
+static void score_moves(const Engine *eng, const MoveSequence *moves, int num_moves,
+                        bool is_white, int ply, MoveKey tt_move, int *order) {
+    for (int i = 0; i < num_moves; i++) {
+        MoveKey key = move_key_pack(&moves[i]);
 
-  Bitboard black_stones_bb = board->black;
-  while (black_stones_bb) {
-    int idx = pop_lsb(&black_stones_bb);
-    int row, col;
-    index_to_coord(idx, &row, &col);
-    
-    for (int dir = 0; dir < 4; dir++) {
-      int jump_row = row + dir_row[dir];
-      int jump_col = col + dir_col[dir];
-      int land_row = row + 2 * dir_row[dir];
-      int land_col = col + 2 * dir_col[dir];
-      
-      if (is_valid_position(jump_row, jump_col) && 
-          is_valid_position(land_row, land_col)) {
-        if (is_white(board, jump_row, jump_col) &&
-          is_empty(board, land_row, land_col)) {
-          black_jump_potential++;
-        }
-      }
+        if (tt_move && key == tt_move) order[i] = ORDER_TT_MOVE;
+        else if (key == eng->killers[ply][0]) order[i] = ORDER_KILLER_1;
+        else if (key == eng->killers[ply][1]) order[i] = ORDER_KILLER_2;
+        else order[i] = eng->history[is_white][seq_from(&moves[i])][seq_to(&moves[i])];
     }
-  }
+}
 
-  int jump_pot_diff = white_jump_potential - black_jump_potential;
-  if (player_is_white) score += jump_pot_diff * JUMP_POTENTIAL_WEIGHT;  
-  else score -= jump_pot_diff * JUMP_POTENTIAL_WEIGHT;  
-
-  // Isolated stones (penalty)
-  int white_isolated = 0;
-  int black_isolated = 0;
-
-  // Check each white stone
-  Bitboard stones_bb = board->white;
-  while (stones_bb) {
-    int idx = pop_lsb(&stones_bb);
-    int row, col;
-    index_to_coord(idx, &row, &col);
-    
-    bool has_friendly_neighbor = false;
-    for (int dir = 0; dir < 4; dir++) {
-      int n_row = row + dir_row[dir];
-      int n_col = col + dir_col[dir];
-      if (is_valid_position(n_row, n_col) && is_white(board, n_row, n_col)) {
-        has_friendly_neighbor = true;
-        break;
-      }
+// Bring the best-ordered remaining move to position i
+static void pick_move(MoveSequence *moves, int *order, int num_moves, int i) {
+    int best = i;
+    for (int j = i + 1; j < num_moves; j++) {
+        if (order[j] > order[best]) best = j;
     }
-    if (!has_friendly_neighbor) white_isolated++;
-  }
 
-  // Check each black stone
-  stones_bb = board->black;
-  while (stones_bb) {
-    int idx = pop_lsb(&stones_bb);
-    int row, col;
-    index_to_coord(idx, &row, &col);
-    
-    bool has_friendly_neighbor = false;
-    for (int dir = 0; dir < 4; dir++) {
-      int n_row = row + dir_row[dir];
-      int n_col = col + dir_col[dir];
-      if (is_valid_position(n_row, n_col) && is_black(board, n_row, n_col)) {
-        has_friendly_neighbor = true;
-        break;
-      }
+    if (best != i) {
+        MoveSequence tmp = moves[i];
+        moves[i] = moves[best];
+        moves[best] = tmp;
+        int t = order[i];
+        order[i] = order[best];
+        order[best] = t;
     }
-    if (!has_friendly_neighbor) black_isolated++;
-  }
-
-  int isolation_diff = white_isolated - black_isolated;
-  if (player_is_white) score += isolation_diff * ISOLATION_PENALTY;  
-  else score -= isolation_diff * ISOLATION_PENALTY;
-
-  // Endgame
-  if (white_mob == 0 && black_mob > 0) {
-    return player_is_white ? -10000 : 10000;
-  }
+}
 
-  if (black_mob == 0 && white_mob > 0) {
-    return player_is_white ? 10000 : -10000;
-  }
+// Record a node as it returns when the engine is tracing; gives back score
+static inline int traced(Engine *eng, int ply, int depth, int alpha, int beta, int score,
+                         int flags, int moves) {
+    if (eng && eng->trace)
+        trace_record(eng->trace, TRACE_NODE, ply, depth, flags, eng->trace->path[ply],
+                     alpha, beta, score, moves);
+    return score;
+}
 
-  return score;
+// The move list of a ply, allocated the first time a search gets there
+static SearchPly *search_ply(SearchPly **plies, int ply) {
+    if (!plies[ply]) plies[ply] = malloc(sizeof(SearchPly));
+    return plies[ply];
 }
 
-// Negamax search with alpha beta pruning
-int negamax(Board *board, int depth, bool is_white, int alpha, int beta, MoveSequence *best_sequence) {
-    //static int call_count = 0;
-    //static int max_depth = 0;
-    //call_count++;
-    //if (depth > max_depth) max_depth = depth;
-    
-    //printf("[negamax] Call #%d, depth=%d, is_white=%d, max_depth=%d\n", 
-    //       call_count, depth, is_white, max_depth);
-    
-    if (!board) {
-        printf("[negamax] ERROR: NULL board!\n");
-        return 0;
+static void free_plies(SearchPly **plies) {
+    for (int i = 0; i <= MAX_PLY; i++) {
+        free(plies[i]);
+        plies[i] = NULL;
     }
-    
-    //printf("[negamax] Board state: white=0x%lx, black=0x%lx, empty=0x%lx\n",
-    //       board->white, board->black, board->empty);
-    
-    if (depth == 0) {
-        int eval = eval_position(board, is_white);
-    //    printf("[negamax] depth=0, returning eval=%d\n", eval);
-        return eval;
+}
+
+/* Negamax with alpha-beta. With an engine context it also uses the
+   layered transposition table, killer and history ordering. `stones` is
+   the stone count of `board`; each jump removes exactly one stone, so
+   children are one layer down per jump and no popcount is needed.
+   `plies` holds the move lists by ply (the engine's own with one).
+   `stats`, when given, counts what the search does. */
+static int search(Engine *eng, SearchPly **plies, Board *board, int depth, int ply, bool is_white,
+                  int alpha, int beta, MoveSequence *best_sequence, int stones,
+                  SearchStats *stats) {
+    PROFILE_PHASE(PROF_SEARCH);
+    int alpha_orig = alpha, beta_orig = beta;
+    uint64_t key = 0;
+    MoveKey tt_move = 0;
+
+    if (stats) stats->nodes++;
+
+    if (eng) {
+        /* A stopped search unwinds at once; its results are discarded */
+        if (eng->aborted) return 0;
+        if ((eng->nodes & STOP_CHECK_INTERVAL) == 0 && engine_out_of_budget(eng)) {
+            eng->aborted = true;
+            return 0;
+        }
+
+        eng->nodes++;
+        key = board_hash(board, is_white);
+        const TTEntry *e = tt_probe(eng->tt, key, stones);
+
+        if (e) {
+            tt_move = e->move;
+
+            /* No cutoffs at the root: the caller needs a move back */
+            if (!best_sequence && e->depth >= depth) {
+                if (e->bound == TT_LOWER && e->score > alpha) alpha = e->score;
+                if (e->bound == TT_UPPER && e->score < beta) beta = e->score;
+                if (e->bound == TT_EXACT || alpha >= beta) {
+                    if (stats) stats->hash_cutoffs++;
+                    return traced(eng, ply, depth, alpha_orig, beta_orig, e->score, TRACE_HASH, 0);
+                }
+            }
+        }
     }
 
-    MoveSequence moves[MAX_MOVES];
-    for (int i = 0; i < MAX_MOVES; i++) {
-        moves[i].count = 0;
+    SearchPly *sp = depth > 0 ? search_ply(plies, ply) : NULL;
+    int num_moves = sp ? generate_all_moves(board, is_white, sp->moves) : -1;
+
+    /* A node with too many moves to list (see MAX_SEQUENCES), or no
+       memory for the list, is scored as a leaf too */
+    if (num_moves < 0) {
+        if (stats) stats->leaf_evals++;
+        int score = (eng && eng->nnue) ? nnue_evaluate(eng->nnue, &eng->nnue_acc[ply], is_white)
+                                       : eval_position(board, is_white);
+        return traced(eng, ply, depth, alpha_orig, beta_orig, score, TRACE_LEAF, 0);
     }
-    
-    int num_moves = generate_all_moves(board, is_white, moves);
-    //printf("[negamax] Generated %d moves\n", num_moves);
-    
+
+    MoveSequence *moves = sp->moves;
+    int *order = sp->order;
+
     if (num_moves == 0) {
-    //    printf("[negamax] No moves, returning -10000\n");
-        return -10000 + depth;
+        if (stats) stats->terminal_nodes++;
+        return traced(eng, ply, depth, alpha_orig, beta_orig, -SCORE_MATE + depth, TRACE_TERMINAL, 0);
     }
 
+    if (stats) {
+        for (int i = 0; i < num_moves; i++)
+            if (moves[i].count > stats->max_sequence) stats->max_sequence = moves[i].count;
+    }
+
+    if (eng) score_moves(eng, moves, num_moves, is_white, ply, tt_move, order);
+
     int best_score = INT_MIN;
-    MoveSequence best_local_sequence = { 0 };
+    int best_index = -1;
+    int searched = 0;
+
+    for (int i = 0; i < num_moves; i++) {
+        if (eng) pick_move(moves, order, num_moves, i);
+
+        Board board_copy = *board;
 
-    for (int i = 0; i < num_moves && i < MAX_MOVES; i++) {
-        //printf("[negamax] Processing move %d/%d\n", i+1, num_moves);
-        
-        Board board_copy;
-        board_copy.white = board->white;
-        board_copy.black = board->black;
-        board_copy.occupied = board->occupied;
-        board_copy.empty = board->empty;
-        
-        //printf("[negamax] Before execute: white=0x%lx\n", board_copy.white);
-        
         if (!execute_sequence(&board_copy, &moves[i], is_white)) {
-            //printf("[negamax] WARNING: execute_sequence failed for move %d\n", i);
-            continue;
-        }
-        
-        //printf("[negamax] After execute: white=0x%lx\n", board_copy.white);
-        
-        if (board_copy.white == 0 && board_copy.black == 0 && board_copy.empty == 0) {
-            //printf("[negamax] CRITICAL: Board zeroed out after execute_sequence!\n");
             continue;
         }
-        
-        int score = -negamax(&board_copy, depth - 1, !is_white, -beta, -alpha, NULL);
-        
-        //printf("[negamax] Move %d score: %d\n", i+1, score);
+        if (eng && eng->nnue)
+            nnue_update(eng->nnue, &eng->nnue_acc[ply], &eng->nnue_acc[ply + 1], &moves[i], is_white);
+        if (eng && eng->trace) eng->trace->path[ply + 1] = move_key_pack(&moves[i]);
+        searched++;
+
+        int score = -search(eng, plies, &board_copy, depth - 1, ply + 1, !is_white, -beta, -alpha,
+                            NULL, stones - moves[i].count, stats);
+
+        if (eng && eng->aborted) return 0;
 
         if (score > best_score) {
             best_score = score;
-            best_local_sequence = moves[i];
+            best_index = i;
         }
         
         if (score > alpha)
             alpha = score;
 
         if (alpha >= beta) {
-            //printf("[negamax] Beta cutoff at move %d\n", i+1);
+            if (stats) {
+                stats->beta_cutoffs++;
+                if (i == 0) stats->first_move_cutoffs++;
+            }
+            if (eng && order[i] < ORDER_KILLER_2) {
+                MoveKey mk = move_key_pack(&moves[i]);
+                eng->killers[ply][1] = eng->killers[ply][0];
+                eng->killers[ply][0] = mk;
+                eng->history[is_white][seq_from(&moves[i])][seq_to(&moves[i])] += depth * depth;
+            }
             break;
         }
     }
 
-    if (best_local_sequence.count > 0 && best_sequence) {
-        *best_sequence = best_local_sequence;
+    if (best_index >= 0 && best_sequence) {
+        *best_sequence = moves[best_index];
     }
 
-    //printf("[negamax] Returning best_score=%d\n", best_score);
-    return best_score;
+    if (eng && best_index >= 0) {
+        TTBound bound = TT_EXACT;
+        if (best_score <= alpha_orig) bound = TT_UPPER;
+        else if (best_score >= beta) bound = TT_LOWER;
+        tt_store(eng->tt, key, stones, depth, best_score, bound, move_key_pack(&moves[best_index]));
+    }
+
+    return traced(eng, ply, depth, alpha_orig, beta_orig, best_score,
+                  best_score >= beta ? TRACE_CUTOFF : 0, searched);
+}
+
+// Negamax search with alpha beta pruning
+int negamax(Board *board, int depth, bool is_white, int alpha, int beta, MoveSequence *best_sequence) {
+    return negamax_with_stats(board, depth, is_white, alpha, beta, best_sequence, NULL);
+}
+
+// Negamax that also adds its counts to stats (NULL = none)
+int negamax_with_stats(Board *board, int depth, bool is_white, int alpha, int beta,
+                       MoveSequence *best_sequence, SearchStats *stats) {
+    if (!board) return 0;
+
+    SearchPly *plies[MAX_PLY + 1] = { 0 };
+    int score = search(NULL, plies, board, depth, 0, is_white, alpha, beta, best_sequence,
+                       popcount(board_occupied(board)), stats);
+    free_plies(plies);
+    return score;
 }
 
 // Wrapper to get best move
 bool get_best_move(Board *board, bool is_white_turn, MoveSequence *chosen_seq, int depth) {
   if (!board || !chosen_seq || depth <= 0) return false;
 
-  MoveSequence moves[MAX_MOVES];
+  MoveSequence moves[MAX_SEQUENCES];
   int num_moves = generate_all_moves(board, is_white_turn, moves);
 
-  if (num_moves == 0) return false;
+  if (num_moves <= 0) return false;
 
   if (num_moves == 1) {
     *chosen_seq = moves[0];
@@ -294,7 +319,7 @@ bool get_best_move(Board *board, bool is_white_turn, MoveSequence *chosen_seq, i
   int alpha = INT_MIN;
   int beta = INT_MAX;
 
-  int score = negamax(board, depth, is_white_turn, alpha, beta, &best_sequence);
+  negamax(board, depth, is_white_turn, alpha, beta, &best_sequence);
 
   if (best_sequence.count == 0) {
     *chosen_seq = moves[0];
@@ -302,6 +327,365 @@ bool get_best_move(Board *board, bool is_white_turn, MoveSequence *chosen_seq, i
     *chosen_seq = best_sequence;
   }
 
-  printf("[Negamax] depth %d, score %d\n", depth, score);
+  return true;
+}
+
+/* ---- Persistent engine context ---- */
+
+// Monotonic wall-clock seconds
+double wall_seconds(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Create an engine with a hash table of tt_mb megabytes
+Engine *engine_create(size_t tt_mb) {
+  Engine *eng = calloc(1, sizeof(Engine));
+  if (!eng) return NULL;
+
+  eng->tt = tt_create(tt_mb);
+  if (!eng->tt) {
+    free(eng);
+    return NULL;
+  }
+
+  pthread_mutex_init(&eng->lock, NULL);
+  pthread_cond_init(&eng->done_cond, NULL);
+  return eng;
+}
+
+void engine_free(Engine *eng) {
+  if (!eng) return;
+
+  if (eng->worker_running) {
+    SearchResult ignored;
+    engine_stop(eng);
+    engine_wait(eng, &ignored, 0);
+  }
+
+  pthread_mutex_destroy(&eng->lock);
+  pthread_cond_destroy(&eng->done_cond);
+  tt_free(eng->tt);
+  free_plies(eng->plies);
+  free(eng);
+}
+
+// Ask a running search (from another thread) to stop as soon as possible
+void engine_stop(Engine *eng) {
+  __atomic_store_n(&eng->stop, 1, __ATOMIC_RELAXED);
+}
+
+// Allow searching again after engine_stop
+void engine_clear_stop(Engine *eng) {
+  __atomic_store_n(&eng->stop, 0, __ATOMIC_RELAXED);
+}
+
+// Forget everything learned (new game)
+void engine_new_game(Engine *eng) {
+  tt_clear(eng->tt);
+  memset(eng->history, 0, sizeof(eng->history));
+  memset(eng->killers, 0, sizeof(eng->killers));
+  eng->pv_length = 0;
+  eng->last_depth = 0;
+  eng->nodes = 0;
+  eng->pv_hits = 0;
+}
+
+// Report every completed iteration of later searches (fn NULL = off)
+void engine_set_info(Engine *eng, EngineInfoFn fn, void *ctx) {
+  eng->info = fn;
+  eng->info_ctx = ctx;
+}
+
+// Record the search into a trace ring (NULL = off); not while searching
+void engine_set_trace(Engine *eng, TraceBuffer *trace) {
+  eng->trace = trace;
+}
+
+// Evaluate leaves with a network instead of eval_position (NULL = back)
+void engine_set_nnue(Engine *eng, const Nnue *net) {
+  if (eng->nnue == net) return;
+  eng->nnue = net;
+  /* Stored scores came from the other evaluator */
+  tt_clear(eng->tt);
+}
+
+/* Called every STOP_CHECK_INTERVAL nodes: the stop flag, the deadline and
+   the node budget all end the search here, so a stop request is honoured
+   within a bounded number of nodes. */
+static bool engine_out_of_budget(Engine *eng) {
+  if (__atomic_load_n(&eng->stop, __ATOMIC_RELAXED)) return true;
+  if (eng->node_limit && eng->nodes >= eng->node_limit) return true;
+  if (eng->deadline > 0 && wall_seconds() >= eng->deadline) return true;
+  return false;
+}
+
+/* If the new root lies one or two plies down the last PV (our move, then
+   the predicted reply), the previous search already covered its subtree:
+   shift the killers along and return how many plies matched. */
+static int engine_follow_pv(Engine *eng, const Board *board, bool is_white_turn) {
+  Board b = eng->pv_root;
+  bool side = eng->pv_side;
+  uint64_t key = board_hash(board, is_white_turn);
+
+  for (int k = 1; k <= 2 && k <= eng->pv_length; k++) {
+    execute_sequence(&b, &eng->pv[k - 1], side);
+    side = !side;
+
+    if (side == is_white_turn && board_hash(&b, side) == key) {
+      memmove(eng->killers[0], eng->killers[k], sizeof(eng->killers[0]) * (MAX_PLY - k));
+      memset(eng->killers[MAX_PLY - k], 0, sizeof(eng->killers[0]) * k);
+      return k;
+    }
+  }
+
+  return 0;
+}
+
+// Rebuild the principal variation from hash moves
+static void engine_store_pv(Engine *eng, const Board *board, bool is_white_turn,
+                            const MoveSequence *first, int depth) {
+  Board b = *board;
+  bool side = is_white_turn;
+  int stones = popcount(board_occupied(board));
+
+  eng->pv_root = *board;
+  eng->pv_side = is_white_turn;
+  eng->pv[0] = *first;
+  eng->pv_length = 1;
+  execute_sequence(&b, first, side);
+  stones -= first->count;
+  side = !side;
+
+  /* Between searches, so the root ply's list is free */
+  SearchPly *sp = search_ply(eng->plies, 0);
+
+  while (sp && eng->pv_length < depth && eng->pv_length < MAX_PLY) {
+    const TTEntry *e = tt_probe(eng->tt, board_hash(&b, side), stones);
+    if (!e || !e->move) break;
+
+    MoveSequence *moves = sp->moves;
+    int num_moves = generate_all_moves(&b, side, moves);
+    int idx = move_key_find(moves, num_moves, e->move);
+    if (idx < 0) break;
+
+    eng->pv[eng->pv_length++] = moves[idx];
+    execute_sequence(&b, &moves[idx], side);
+    stones -= moves[idx].count;
+    side = !side;
+  }
+}
+
+// Make the best-so-far result visible to engine_poll
+static void engine_publish(Engine *eng, const SearchResult *result) {
+  pthread_mutex_lock(&eng->lock);
+  eng->result = *result;
+  pthread_mutex_unlock(&eng->lock);
+}
+
+// Iterative deepening search within limits; keeps tables between moves
+bool engine_search(Engine *eng, const Board *board, bool is_white_turn,
+                   const SearchLimits *limits, SearchResult *result) {
+  if (!eng || !board || !result) return false;
+
+  memset(result, 0, sizeof(*result));
+
+  double start_time = wall_seconds();
+  uint64_t hash_probes = eng->tt->probes, hash_hits = eng->tt->hits;
+  search_stats_reset(&eng->stats);
+  eng->nodes = 0;
+  eng->aborted = false;
+  eng->node_limit = limits ? limits->nodes : 0;
+  eng->deadline = (limits && limits->movetime_ms > 0) ? start_time + limits->movetime_ms / 1000.0 : 0.0;
+
+  int max_depth = (limits && limits->depth > 0) ? limits->depth : MAX_PLY;
+  if (max_depth > MAX_PLY) max_depth = MAX_PLY;
+
+  /* Listed in the root ply's list, which the search reuses; only the
+     count and the first move are kept */
+  SearchPly *sp = search_ply(eng->plies, 0);
+  int num_moves = sp ? generate_all_moves(board, is_white_turn, sp->moves) : -1;
+
+  /* No move, more than the search can list, or no memory for the list */
+  if (num_moves <= 0) {
+    engine_publish(eng, result);
+    return false;
+  }
+
+  /* A legal move is available from the very first poll */
+  result->best = sp->moves[0];
+  result->has_move = true;
+  engine_publish(eng, result);
+
+  Board root = *board;
+  int stones = popcount(board_occupied(board));
+  tt_set_root(eng->tt, stones);
+  if (eng->nnue) nnue_refresh(eng->nnue, &root, &eng->nnue_acc[0]);
+
+  int matched = engine_follow_pv(eng, board, is_white_turn);
+  if (matched) eng->pv_hits++;
+
+  /* Old history still orders well, but should not dominate */
+  for (int s = 0; s < 2; s++)
+    for (int f = 0; f < TOTAL_CELLS; f++)
+      for (int t = 0; t < TOTAL_CELLS; t++)
+        eng->history[s][f][t] /= 2;
+
+  int completed = 0;
+
+  if (num_moves > 1) {
+    /* Depths the previous search already covered below this root are
+       answered by the hash table; resume just under the old horizon */
+    int start = matched ? eng->last_depth - matched : 1;
+    if (start < 1) start = 1;
+    if (start > max_depth) start = max_depth;
+
+    for (int d = start; d <= max_depth; d++) {
+      MoveSequence iter_best = { 0 };
+      uint64_t iter_nodes = eng->stats.nodes;
+      double iter_start = wall_seconds();
+      int iter_score = search(eng, eng->plies, &root, d, 0, is_white_turn, INT_MIN, INT_MAX, &iter_best, stones,
+                              &eng->stats);
+
+      /* Keep the last fully searched iteration */
+      if (eng->aborted) break;
+      eng->stats.depth = d;
+      eng->stats.depth_nodes[d] = eng->stats.nodes - iter_nodes;
+      eng->stats.depth_seconds[d] = wall_seconds() - iter_start;
+      if (iter_best.count > 0) result->best = iter_best;
+      result->score = iter_score;
+      if (eng->trace)
+        trace_record(eng->trace, TRACE_ITERATION, 0, d, 0, move_key_pack(&result->best),
+                     INT_MIN, INT_MAX, iter_score, num_moves);
+      result->depth = completed = d;
+      result->nodes = eng->nodes;
+      result->seconds = wall_seconds() - start_time;
+      engine_publish(eng, result);
+
+      /* The line is only rebuilt from the hash table when someone listens */
+      if (eng->info) {
+        engine_store_pv(eng, board, is_white_turn, &result->best, d);
+        eng->info(eng->info_ctx, result, eng->pv, eng->pv_length);
+      }
+
+      /* Proven results do not change with more depth */
+      if (SCORE_IS_MATE(iter_score)) break;
+    }
+  } else {
+    result->depth = completed = 1;
+  }
+
+  if (completed > 0) {
+    engine_store_pv(eng, board, is_white_turn, &result->best, completed);
+    eng->last_depth = completed;
+  } else {
+    eng->pv_length = 0;
+  }
+
+  result->nodes = eng->nodes;
+  result->seconds = wall_seconds() - start_time;
+  eng->stats.seconds = result->seconds;
+  eng->stats.hash_probes = eng->tt->probes - hash_probes;
+  eng->stats.hash_hits = eng->tt->hits - hash_hits;
+  engine_publish(eng, result);
+  return true;
+}
+
+// Depth-limited search (blocking)
+bool engine_best_move(Engine *eng, Board *board, bool is_white_turn, int depth,
+                      MoveSequence *chosen_seq, int *score_out) {
+  if (!chosen_seq || depth <= 0) return false;
+
+  SearchLimits limits = { .depth = depth };
+  SearchResult result;
+
+  if (!engine_search(eng, board, is_white_turn, &limits, &result)) return false;
+
+  *chosen_seq = result.best;
+  if (score_out) *score_out = result.score;
+  return true;
+}
+
+static void *engine_worker(void *arg) {
+  Engine *eng = arg;
+  SearchResult result;
+
+  engine_search(eng, &eng->root, eng->root_white, &eng->limits, &result);
+
+  pthread_mutex_lock(&eng->lock);
+  eng->done = true;
+  pthread_cond_broadcast(&eng->done_cond);
+  pthread_mutex_unlock(&eng->lock);
+  return NULL;
+}
+
+// Start searching on a worker thread; false if a search is already running
+bool engine_start(Engine *eng, const Board *board, bool is_white_turn,
+                  const SearchLimits *limits) {
+  if (!eng || !board || eng->worker_running) return false;
+
+  eng->root = *board;
+  eng->root_white = is_white_turn;
+  eng->limits = limits ? *limits : (SearchLimits){ 0 };
+  memset(&eng->result, 0, sizeof(eng->result));
+  eng->done = false;
+  engine_clear_stop(eng);
+
+  if (pthread_create(&eng->worker, NULL, engine_worker, eng) != 0) return false;
+
+  eng->worker_running = true;
+  return true;
+}
+
+// Best result so far; true once the search has finished
+bool engine_poll(Engine *eng, SearchResult *result) {
+  pthread_mutex_lock(&eng->lock);
+  *result = eng->result;
+  bool done = eng->done;
+  pthread_mutex_unlock(&eng->lock);
+  return done;
+}
+
+/* Wait for the worker. With timeout_ms > 0 the search is stopped once
+   the timeout expires, so this returns within that bound plus one stop
+   check interval. */
+bool engine_wait(Engine *eng, SearchResult *result, int timeout_ms) {
+  if (!eng->worker_running) return false;
+
+  pthread_mutex_lock(&eng->lock);
+  if (timeout_ms < 0) {
+    while (!eng->done) pthread_cond_wait(&eng->done_cond, &eng->lock);
+  } else if (timeout_ms > 0) {
+    struct timespec until;
+    clock_gettime(CLOCK_REALTIME, &until);
+    until.tv_sec += timeout_ms / 1000;
+    until.tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+    if (until.tv_nsec >= 1000000000L) {
+      until.tv_sec++;
+      until.tv_nsec -= 1000000000L;
+    }
+
+    while (!eng->done) {
+      if (pthread_cond_timedwait(&eng->done_cond, &eng->lock, &until) != 0) break;
+    }
+  }
+  pthread_mutex_unlock(&eng->lock);
+
+  engine_stop(eng);
+  pthread_join(eng->worker, NULL);
+  eng->worker_running = false;
+  engine_clear_stop(eng);
+
+  pthread_mutex_lock(&eng->lock);
+  *result = eng->result;
+  pthread_mutex_unlock(&eng->lock);
+  return result->has_move;
+}
+
+// The reply the last search expects from the opponent
+bool engine_predicted_reply(const Engine *eng, MoveSequence *reply) {
+  if (eng->pv_length < 2) return false;
+  *reply = eng->pv[1];
   return true;
 }
@@ -0,0 +1,271 @@
+/* Streaming batch analysis. The reader fills a window of slots in input
+   order and hands each to the thread pool as a task; whoever completes the
+   slot at the head of the window writes out every finished slot from
+   there, so results leave in input order while the window keeps moving. */
+#include "analyze.h"
+#include "pool.h"
+#include <string.h>
+
+#define ANALYZE_LINE_MAX 256
+#define ANALYZE_WINDOW_PER_THREAD 4
+#define ANALYZE_EVAL_BLOCK 1024
+
+enum { SLOT_FREE, SLOT_PENDING, SLOT_DONE };
+
+typedef struct Batch Batch;
+
+typedef struct {
+  Batch *batch;
+  PoolTask task;
+  int state;
+  bool valid;
+  Board board;
+  bool is_white_turn;
+  char text[ANALYZE_LINE_MAX];
+  char output[ANALYZE_LINE_MAX + MOVE_TEXT_MAX + 96];
+} Slot;
+
+typedef struct {
+  Batch *batch;
+  Engine *engine;
+} AnalyzeWorker;
+
+struct Batch {
+  const AnalyzeConfig *config;
+  FILE *out;
+  AnalyzeStats *stats;
+  Pool *pool;
+  AnalyzeWorker *workers; // one per pool worker
+  Slot *slots;
+  uint64_t window;
+  uint64_t next_read;   // slots filled
+  uint64_t next_write;  // slots written out
+  pthread_mutex_t lock;
+  pthread_cond_t space_cond;
+};
+
+AnalyzeConfig analyze_default_config(void) {
+  AnalyzeConfig config = {
+    .limits = { .depth = DEF_DEPTH },
+    .threads = 0,
+    .hash_mb = ANALYZE_DEF_HASH_MB
+  };
+  return config;
+}
+
+static void analyze_slot(AnalyzeWorker *w, Slot *slot) {
+  char position[BOARD_TEXT_MAX];
+
+  if (!slot->valid) {
+    snprintf(slot->output, sizeof(slot->output), "%s error invalid position\n", slot->text);
+    return;
+  }
+
+  board_to_text(&slot->board, slot->is_white_turn, position);
+  engine_new_game(w->engine);
+
+  SearchResult result;
+  if (!engine_search(w->engine, &slot->board, slot->is_white_turn, &w->batch->config->limits, &result)) {
+    snprintf(slot->output, sizeof(slot->output), "%s bestmove none\n", position);
+    return;
+  }
+
+  char move[MOVE_TEXT_MAX];
+  move_sequence_to_text(&result.best, move);
+  snprintf(slot->output, sizeof(slot->output),
+           "%s bestmove %s score %d depth %d nodes %llu time %.0f\n",
+           position, move, result.score, result.depth,
+           (unsigned long long)result.nodes, result.seconds * 1000.0);
+
+  pthread_mutex_lock(&w->batch->lock);
+  w->batch->stats->nodes += result.nodes;
+  pthread_mutex_unlock(&w->batch->lock);
+}
+
+// Write finished slots from the head of the window (lock held)
+static void flush_done(Batch *batch) {
+  bool advanced = false;
+
+  while (batch->next_write < batch->next_read) {
+    Slot *slot = &batch->slots[batch->next_write % batch->window];
+    if (slot->state != SLOT_DONE) break;
+
+    fputs(slot->output, batch->out);
+    slot->state = SLOT_FREE;
+    batch->next_write++;
+    advanced = true;
+  }
+
+  if (advanced) {
+    fflush(batch->out);
+    pthread_cond_signal(&batch->space_cond);
+  }
+}
+
+// Pool task: one slot on the running worker's engine
+static void analyze_task(void *arg) {
+  Slot *slot = arg;
+  Batch *batch = slot->batch;
+
+  analyze_slot(&batch->workers[pool_worker_id(batch->pool)], slot);
+
+  pthread_mutex_lock(&batch->lock);
+  slot->state = SLOT_DONE;
+  flush_done(batch);
+  pthread_mutex_unlock(&batch->lock);
+}
+
+// Read the next position line into slot; false at end of input
+static bool read_slot(FILE *in, Slot *slot) {
+  char line[ANALYZE_LINE_MAX];
+
+  while (fgets(line, sizeof(line), in)) {
+    size_t len = strlen(line);
+    bool complete = len > 0 && line[len - 1] == '\n';
+
+    /* Over-long line: drop the rest and report it as invalid */
+    if (!complete && !feof(in)) {
+      int c;
+      while ((c = fgetc(in)) != EOF && c != '\n');
+    }
+
+    while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r' ||
+                       line[len - 1] == ' ' || line[len - 1] == '\t'))
+      line[--len] = '\0';
+
+    const char *p = line;
+    while (*p == ' ' || *p == '\t') p++;
+    if (*p == '\0' || *p == '#') continue;
+
+    snprintf(slot->text, sizeof(slot->text), "%s", p);
+    slot->valid = (complete || feof(in)) &&
+                  board_from_text(p, &slot->board, &slot->is_white_turn);
+    return true;
+  }
+
+  return false;
+}
+
+/* Static evaluation: read a block of lines, score the valid positions
+   with one eval_batch call (or the network) and write the block out in order */
+static bool evaluate_stream(FILE *in, FILE *out, const Nnue *nnue, AnalyzeStats *stats) {
+  Slot *slots = malloc(ANALYZE_EVAL_BLOCK * sizeof(Slot));
+  Board *boards = malloc(ANALYZE_EVAL_BLOCK * sizeof(Board));
+  bool *sides = malloc(ANALYZE_EVAL_BLOCK * sizeof(bool));
+  int *scores = malloc(ANALYZE_EVAL_BLOCK * sizeof(int));
+  bool ok = slots && boards && sides && scores;
+  double start = wall_seconds();
+
+  while (ok) {
+    int count = 0, valid = 0;
+    while (count < ANALYZE_EVAL_BLOCK && read_slot(in, &slots[count])) {
+      if (slots[count].valid) {
+        boards[valid] = slots[count].board;
+        sides[valid++] = slots[count].is_white_turn;
+      } else {
+        stats->invalid++;
+      }
+      count++;
+    }
+    if (count == 0) break;
+
+    if (nnue) {
+      for (int i = 0; i < valid; i++) scores[i] = nnue_eval_position(nnue, &boards[i], sides[i]);
+    } else {
+      eval_batch(boards, valid, sides, scores);
+    }
+    stats->positions += count;
+
+    for (int i = 0, v = 0; i < count; i++) {
+      if (!slots[i].valid) {
+        fprintf(out, "%s error invalid position\n", slots[i].text);
+        continue;
+      }
+      char position[BOARD_TEXT_MAX];
+      board_to_text(&boards[v], sides[v], position);
+      fprintf(out, "%s eval %d\n", position, scores[v++]);
+    }
+    fflush(out);
+  }
+
+  stats->seconds = wall_seconds() - start;
+  free(slots);
+  free(boards);
+  free(sides);
+  free(scores);
+  return ok;
+}
+
+// Analyze every position from in, writing one result line each to out
+bool analyze_stream(FILE *in, FILE *out, const AnalyzeConfig *config, AnalyzeStats *stats) {
+  if (!in || !out || !config || !stats) return false;
+
+  memset(stats, 0, sizeof(*stats));
+  if (config->static_eval) return evaluate_stream(in, out, config->nnue, stats);
+
+  Pool *pool = pool_acquire(config->threads);
+  if (!pool) return false;
+  int threads = pool_threads(pool);
+
+  Batch batch = {
+    .config = config,
+    .out = out,
+    .stats = stats,
+    .pool = pool,
+    .window = (uint64_t)threads * ANALYZE_WINDOW_PER_THREAD
+  };
+  batch.slots = calloc(batch.window, sizeof(Slot));
+  AnalyzeWorker *workers = calloc((size_t)threads, sizeof(AnalyzeWorker));
+  batch.workers = workers;
+
+  pthread_mutex_init(&batch.lock, NULL);
+  pthread_cond_init(&batch.space_cond, NULL);
+
+  /* Any worker may take a slot, so every one needs its engine */
+  int ready = 0;
+  if (batch.slots && workers) {
+    for (; ready < threads; ready++) {
+      workers[ready].batch = &batch;
+      workers[ready].engine = engine_create(config->hash_mb);
+      if (!workers[ready].engine) break;
+      engine_set_nnue(workers[ready].engine, config->nnue);
+    }
+  }
+
+  double start = wall_seconds();
+  PoolGroup group = { 0 };
+
+  if (ready == threads) {
+    Slot next;
+
+    while (read_slot(in, &next)) {
+      pthread_mutex_lock(&batch.lock);
+      while (batch.next_read - batch.next_write >= batch.window)
+        pthread_cond_wait(&batch.space_cond, &batch.lock);
+
+      Slot *slot = &batch.slots[batch.next_read % batch.window];
+      *slot = next;
+      slot->batch = &batch;
+      slot->state = SLOT_PENDING;
+      batch.next_read++;
+      stats->positions++;
+      if (!next.valid) stats->invalid++;
+      pthread_mutex_unlock(&batch.lock);
+
+      pool_spawn(pool, &group, &slot->task, analyze_task, slot);
+    }
+    pool_wait(pool, &group);
+  }
+
+  for (int t = 0; t < ready; t++) engine_free(workers[t].engine);
+
+  stats->seconds = wall_seconds() - start;
+
+  pthread_cond_destroy(&batch.space_cond);
+  pthread_mutex_destroy(&batch.lock);
+  free(batch.slots);
+  free(workers);
+  pool_release(pool);
+
+  return ready == threads;
+}
@@ -1,9 +1,11 @@
 /* Board utilities and bitboard helpers.
-   The 7x7 board is stored in row-major order using the lower 49 bits
-   of a 64-bit bitboard (VALID_MASK). Index 0 = A1 (row 0, col 0). */
+   The board is stored in row-major order in the low TOTAL_CELLS bits of
+   the bitboard (VALID_MASK). Index 0 = A1 (row 0, col 0). */
 #include "board.h"
+#include "cpu.h"
+#include "profile.h"
 
-// Check if row,col is a valid position in the 7x7 board
+// Check if row,col is a valid position on the board
 bool is_valid_position(int row, int col) {
   if ((row < 0) || (row > BOARD_SIZE - 1) ||
       (col < 0) || (col > BOARD_SIZE - 1)) return false;
@@ -13,21 +15,17 @@ bool is_valid_position(int row, int col) {
 
 // Pop the least significant bit
 int pop_lsb(Bitboard *bitboard) {
-  if (*bitboard == 0) return -1;
+  if (!bb_any(*bitboard)) return -1;
 
-  int idx = __builtin_ctzll(*bitboard);
-  *bitboard &= (*bitboard - 1);
+  int idx = bb_ctz(*bitboard);
+  *bitboard = bb_clear_lsb(*bitboard);
 
   return idx;
 }
 
 // Count number of on bits
 int popcount(Bitboard bitboard) {
-  int count = 0;
-
-  while(bitboard) count += bitboard & 1, bitboard >>= 1;
-
-  return count;
+  return cpu_kernels->popcount(bitboard);
 }
 
 // Convert coordinates to index
@@ -41,12 +39,138 @@ void index_to_coord(int index, int *row, int *col) {
   *col = index % BOARD_SIZE;
 }
 
+// Parse a coordinate such as "D4" (column letter, row number)
+bool parse_coord(const char *text, int *row, int *col) {
+  if (!text) return false;
+
+  char col_char = text[0];
+  if (col_char >= 'a' && col_char <= 'z') col_char -= 'a' - 'A';
+  if (col_char < 'A' || col_char >= 'A' + BOARD_SIZE) return false;
+
+  int row_num = 0;
+  const char *p = text + 1;
+  if (*p < '0' || *p > '9') return false;
+  while (*p >= '0' && *p <= '9') row_num = row_num * 10 + (*p++ - '0');
+  if (*p != '\0' || row_num < 1 || row_num > BOARD_SIZE) return false;
+
+  *col = col_char - 'A';
+  *row = row_num - 1;
+  return true;
+}
+
+/* Position notation: rows from 1 to BOARD_SIZE separated by '/', 'B' and
+   'W' for stones and a digit for a run of empty squares, then a space and
+   the side to move ('b' or 'w'). After the removals D4, C4 the position is
+   "BWBWBWB/WBWBWBW/BWBWBWB/WB2WBW/BWBWBWB/WBWBWBW/BWBWBWB b". */
+
+// Empty run as digits of at most 9 (boards over 9 wide)
+static char *put_run(char *p, int run) {
+  for (; run > 9; run -= 9) *p++ = '9';
+  if (run) *p++ = (char)('0' + run);
+  return p;
+}
+
+// Serialize a position; buf needs BOARD_TEXT_MAX bytes
+void board_to_text(const Board *board, bool is_white_turn, char *buf) {
+  char *p = buf;
+
+  for (int row = 0; row < BOARD_SIZE; row++) {
+    int run = 0;
+    if (row > 0) *p++ = '/';
+
+    for (int col = 0; col < BOARD_SIZE; col++) {
+      char c = is_white(board, row, col) ? 'W' : is_black(board, row, col) ? 'B' : 0;
+      if (!c) {
+        run++;
+        continue;
+      }
+      p = put_run(p, run);
+      run = 0;
+      *p++ = c;
+    }
+
+    p = put_run(p, run);
+  }
+
+  *p++ = ' ';
+  *p++ = is_white_turn ? 'w' : 'b';
+  *p = '\0';
+}
+
+// Parse a position; false if the text is malformed
+bool board_from_text(const char *text, Board *board, bool *is_white_turn) {
+  if (!text) return false;
+
+  Board b = { 0 };
+  const char *p = text;
+  while (*p == ' ' || *p == '\t') p++;
+
+  for (int row = 0; row < BOARD_SIZE; row++) {
+    if (row > 0 && *p++ != '/') return false;
+
+    int col = 0;
+    while (col < BOARD_SIZE) {
+      char c = *p++;
+      if (c == 'B' || c == 'b') {
+        b.black |= get_bitmask(row, col++);
+      } else if (c == 'W' || c == 'w') {
+        b.white |= get_bitmask(row, col++);
+      } else if (c >= '1' && c <= '9') {
+        col += c - '0';
+      } else {
+        return false;
+      }
+    }
+    if (col != BOARD_SIZE) return false;
+  }
+
+  while (*p == ' ' || *p == '\t') p++;
+  if (*p != 'b' && *p != 'w') return false;
+  bool white = (*p++ == 'w');
+  if (*p != '\0' && *p != ' ' && *p != '\t' && *p != '\n' && *p != '\r') return false;
+
+  *board = b;
+  if (is_white_turn) *is_white_turn = white;
+  return true;
+}
+
+/* splitmix64 finalizer: cheap and well mixed, so a position hash needs
+   no random key tables. */
+static uint64_t mix64(uint64_t x) {
+  x ^= x >> 30;
+  x *= 0xBF58476D1CE4E5B9ULL;
+  x ^= x >> 27;
+  x *= 0x94D049BB133111EBULL;
+  x ^= x >> 31;
+  return x;
+}
+
+// Hash a position (stones plus side to move) into 64 bits
+uint64_t board_hash(const Board *board, bool is_white_turn) {
+  PROFILE_PHASE(PROF_HASH);
+  uint64_t h = mix64(bb_word(board->white, 0) + 0x9E3779B97F4A7C15ULL);
+  h = mix64(h ^ bb_word(board->black, 0));
+  for (int w = 1; w < BITBOARD_WORDS; w++) {
+    h = mix64(h ^ bb_word(board->white, w));
+    h = mix64(h ^ bb_word(board->black, w));
+  }
+  return is_white_turn ? ~h : h;
+}
+
+// Small per-caller PRNG (xorshift64*); state must be non-zero
+uint64_t random_next(uint64_t *state) {
+  uint64_t x = *state;
+  x ^= x >> 12;
+  x ^= x << 25;
+  x ^= x >> 27;
+  *state = x;
+  return x * 0x2545F4914F6CDD1DULL;
+}
+
 // Initialize board
 void init_board(Board *board) {
-  board->white = 0;
-  board->black = 0;
-  board->occupied = 0;
-  board->empty = VALID_MASK;
+  board->white = BB_ZERO;
+  board->black = BB_ZERO;
 
   for (int row = 0; row < BOARD_SIZE; row ++) {
     for (int col = 0; col < BOARD_SIZE; col ++) {
@@ -54,56 +178,119 @@ void init_board(Board *board) {
       else board->black |= get_bitmask(row, col);
     }
   }
-
-  board->occupied = board->white | board->black;
-  board->empty = (~board->occupied) & VALID_MASK;
 }
 
 // Check if stone is white/black/empty
 bool is_white(const Board *board, int row, int col) {
-  return (board->white & get_bitmask(row, col)) != 0;
+  return bb_any(board->white & get_bitmask(row, col));
 }
 
 bool is_black(const Board *board, int row, int col) {
-  return (board->black & get_bitmask(row, col)) != 0;
+  return bb_any(board->black & get_bitmask(row, col));
 }
 
 bool is_empty(const Board *board, int row, int col) {
-  return (board->occupied & get_bitmask(row, col)) == 0;
+  return !bb_any(board_occupied(board) & get_bitmask(row, col));
 }
 
 // Set a square to white/black/remove stone
 void set_white(Board *board, int row, int col) {
   Bitboard mask = get_bitmask(row, col);
   board->white |= mask;
-  board->occupied |= mask;
-  board->empty &= ~mask;
 }
 
 void set_black(Board *board, int row, int col) {
   Bitboard mask = get_bitmask(row, col);
   board->black |= mask;
-  board->occupied |= mask;
-  board->empty &= ~mask;
 }
 
 void remove_stone(Board *board, int row, int col) {
   Bitboard mask = get_bitmask(row, col);
-  board->occupied &= ~mask;
   board->white &= ~mask;
   board->black &= ~mask;
-  board->empty |= mask;
+}
+
+// Map a square index through a board symmetry
+int transform_index(int index, int sym) {
+  int row, col;
+  index_to_coord(index, &row, &col);
+
+  if (sym & 1) {
+    int tmp = row;
+    row = col;
+    col = tmp;
+  }
+  if (sym & 2) row = BOARD_SIZE - 1 - row;
+  if (sym & 4) col = BOARD_SIZE - 1 - col;
+
+  return coord_to_index(row, col);
+}
+
+// Map every stone of a bitboard through a board symmetry
+Bitboard transform_bitboard(Bitboard bitboard, int sym) {
+  Bitboard out = BB_ZERO;
+
+  while (bb_any(bitboard)) {
+    int idx = pop_lsb(&bitboard);
+    out |= BB_BIT(transform_index(idx, sym));
+  }
+
+  return out;
+}
+
+// Symmetry that undoes sym
+int inverse_symmetry(int sym) {
+  /* Two squares off every symmetry axis pin the transform down */
+  int a = coord_to_index(0, 1), b = coord_to_index(1, 2);
+
+  for (int inv = 0; inv < NUM_SYMMETRIES; inv++) {
+    if (transform_index(transform_index(a, sym), inv) == a &&
+        transform_index(transform_index(b, sym), inv) == b)
+      return inv;
+  }
+
+  return 0;
+}
+
+// Check that a symmetry keeps black squares black (always true on odd boards)
+bool symmetry_preserves_colors(int sym) {
+  /* Mirrors shift the (row + col) parity of every square alike, so
+     checking the A1 corner is enough */
+  int row, col;
+  index_to_coord(transform_index(0, sym), &row, &col);
+  return (row + col) % 2 == 0;
+}
+
+// Symmetry that maps a position to its canonical (smallest) form
+int canonical_symmetry(const Board *board) {
+  int best = 0;
+  Bitboard best_white = board->white, best_black = board->black;
+
+  for (int sym = 1; sym < NUM_SYMMETRIES; sym++) {
+    if (!symmetry_preserves_colors(sym)) continue;
+
+    Bitboard w = transform_bitboard(board->white, sym);
+    Bitboard b = transform_bitboard(board->black, sym);
+
+    if (bb_less(w, best_white) || (!bb_less(best_white, w) && bb_less(b, best_black))) {
+      best = sym;
+      best_white = w;
+      best_black = b;
+    }
+  }
+
+  return best;
 }
 
 // Get bitmask for a position (row, col)
 Bitboard get_bitmask(int row, int col) {
-  if (row < 0 || row >= BOARD_SIZE || col < 0 || col >= BOARD_SIZE) return 0;
+  if (row < 0 || row >= BOARD_SIZE || col < 0 || col >= BOARD_SIZE) return BB_ZERO;
 
   int index = coord_to_index(row, col);
   
-  if (index >= TOTAL_CELLS) return 0;
+  if (index >= TOTAL_CELLS) return BB_ZERO;
 
-  return ((Bitboard)1 << index) & VALID_MASK;
+  return BB_BIT(index) & VALID_MASK;
 }
 
 // Print board
@@ -143,7 +330,7 @@ void print_bitboard(const Bitboard bitboard) {
     printf("%d ", row + 1);
     for (int col = 0; col < BOARD_SIZE; col ++) {
       Bitboard mask = get_bitmask(row, col);
-      printf("%c ", (bitboard & mask) ? '1' : '0');
+      printf("%c ", bb_any(bitboard & mask) ? '1' : '0');
     }
     printf("%d\n", row + 1);
   }
@@ -0,0 +1,343 @@
+/* Opening book: precomputed replies for the removal phase and the first
+   plies. Positions are folded by board symmetry, keyed by the hash of
+   their canonical form and stored as a sorted array of fixed-size
+   entries, so a probe is a binary search over the memory-mapped file. */
+#include "book.h"
+#include "ai.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define BOOK_MAGIC "KBK1"
+
+enum { BOOK_KIND_MOVE = 0, BOOK_KIND_REMOVAL = 1 };
+
+typedef struct {
+  char magic[4];
+  uint32_t board_size;
+  uint32_t count;
+  uint32_t reserved;
+} BookHeader;
+
+typedef struct {
+  uint64_t key;   // board_hash of the canonical position
+  uint32_t move;  // MoveKey, or removal square, in the canonical frame
+  int16_t score;  // from the side to move
+  uint8_t depth;
+  uint8_t kind;
+} BookEntry;
+
+static struct {
+  void *map;
+  size_t map_size;
+  const BookEntry *entries;
+  size_t count;
+} book;
+
+// Map a book file into memory as the engine-wide book
+bool book_init(const char *path) {
+  book_close();
+
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) return false;
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(BookHeader)) {
+    close(fd);
+    return false;
+  }
+
+  void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) return false;
+
+  const BookHeader *header = map;
+  if (memcmp(header->magic, BOOK_MAGIC, 4) != 0 ||
+      header->board_size != BOARD_SIZE ||
+      sizeof(BookHeader) + (size_t)header->count * sizeof(BookEntry) > (size_t)st.st_size) {
+    munmap(map, st.st_size);
+    return false;
+  }
+
+  book.map = map;
+  book.map_size = st.st_size;
+  book.entries = (const BookEntry *)((const char *)map + sizeof(BookHeader));
+  book.count = header->count;
+  return true;
+}
+
+void book_close(void) {
+  if (book.map) munmap(book.map, book.map_size);
+  memset(&book, 0, sizeof(book));
+}
+
+// Number of positions in the loaded book (0 if none)
+size_t book_size(void) {
+  return book.count;
+}
+
+// Canonical key of a position, and the symmetry that produced it
+static uint64_t canonical_key(const Board *board, bool is_white_turn, int *sym) {
+  *sym = canonical_symmetry(board);
+
+  Board canon = *board;
+  canon.white = transform_bitboard(board->white, *sym);
+  canon.black = transform_bitboard(board->black, *sym);
+
+  return board_hash(&canon, is_white_turn);
+}
+
+static const BookEntry *book_find(uint64_t key) {
+  size_t lo = 0, hi = book.count;
+
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (book.entries[mid].key < key) lo = mid + 1;
+    else hi = mid;
+  }
+
+  return (lo < book.count && book.entries[lo].key == key) ? &book.entries[lo] : NULL;
+}
+
+// Book move for a position after the removals; false when out of book
+bool book_probe_move(const Board *board, bool is_white_turn,
+                     MoveSequence *seq, int *score) {
+  if (!book.count) return false;
+
+  int sym;
+  const BookEntry *e = book_find(canonical_key(board, is_white_turn, &sym));
+  if (!e || e->kind != BOOK_KIND_MOVE) return false;
+
+  /* Match against the legal moves seen through the same symmetry, which
+     also covers chains too long to unpack from a MoveKey */
+  MoveSequence moves[MAX_SEQUENCES];
+  int num_moves = generate_all_moves(board, is_white_turn, moves);
+
+  for (int i = 0; i < num_moves; i++) {
+    MoveSequence canon = moves[i];
+    transform_sequence(&canon, sym);
+
+    if (move_key_pack(&canon) == e->move) {
+      *seq = moves[i];
+      if (score) *score = e->score;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+// Book choice for an initial removal; false when out of book
+bool book_probe_removal(const Board *board, bool is_black,
+                        int *row, int *col) {
+  if (!book.count) return false;
+
+  int sym;
+  const BookEntry *e = book_find(canonical_key(board, !is_black, &sym));
+  if (!e || e->kind != BOOK_KIND_REMOVAL) return false;
+
+  index_to_coord(transform_index(e->move, inverse_symmetry(sym)), row, col);
+  return is_valid_initial_removal(board, *row, *col, is_black);
+}
+
+/* ---- Offline builder ---- */
+
+typedef struct {
+  uint64_t key;
+  int plies;          // deepest expansion so far
+} BuilderSeen;
+
+typedef struct {
+  BookEntry *items;
+  size_t count, cap;
+  BuilderSeen *seen;  // open-addressing map of canonical keys
+  size_t seen_mask;
+  size_t seen_count;
+  int depth;
+  Engine *eng;        // searches every position, sharing one hash table
+  MoveSequence *lists;  // a move list per plies left, off the recursive frames
+} BookBuilder;
+
+/* Raise key's expansion to plies; returns the plies it had (-1 = new key).
+   A position reached again with more plies left is expanded again. */
+static int builder_mark(BookBuilder *b, uint64_t key, int plies) {
+  if (b->seen_count * 2 >= b->seen_mask) {
+    size_t old_size = b->seen_mask + 1;
+    BuilderSeen *old = b->seen;
+
+    b->seen_mask = old_size * 2 - 1;
+    b->seen = calloc(old_size * 2, sizeof(BuilderSeen));
+    b->seen_count = 0;
+
+    for (size_t i = 0; i < old_size; i++) {
+      if (old[i].key) builder_mark(b, old[i].key, old[i].plies);
+    }
+    free(old);
+  }
+
+  size_t i = key & b->seen_mask;
+  while (b->seen[i].key) {
+    if (b->seen[i].key == key) {
+      int had = b->seen[i].plies;
+      if (plies > had) b->seen[i].plies = plies;
+      return had;
+    }
+    i = (i + 1) & b->seen_mask;
+  }
+
+  b->seen[i].key = key;
+  b->seen[i].plies = plies;
+  b->seen_count++;
+  return -1;
+}
+
+static void builder_add(BookBuilder *b, uint64_t key, uint32_t move, int score, int kind) {
+  if (b->count == b->cap) {
+    b->cap = b->cap ? b->cap * 2 : 1024;
+    b->items = realloc(b->items, b->cap * sizeof(BookEntry));
+  }
+
+  if (score > 32767) score = 32767;
+  if (score < -32767) score = -32767;
+
+  BookEntry *e = &b->items[b->count++];
+  e->key = key;
+  e->move = move;
+  e->score = (int16_t)score;
+  e->depth = (uint8_t)b->depth;
+  e->kind = (uint8_t)kind;
+}
+
+// Search a position, store its best move and expand its children
+static void builder_expand(BookBuilder *b, const Board *board, bool is_white_turn, int plies) {
+  int sym;
+  uint64_t key = canonical_key(board, is_white_turn, &sym);
+  int had = builder_mark(b, key, plies);
+  if (had >= plies) return;
+
+  MoveSequence *moves = b->lists + (size_t)plies * MAX_SEQUENCES;
+  int num_moves = generate_all_moves(board, is_white_turn, moves);
+  if (num_moves <= 0) return;
+
+  /* Searched once, whatever the plies it is reached with */
+  if (had < 0) {
+    Board copy = *board;
+    MoveSequence best = moves[0];
+    int score = 0;
+    engine_best_move(b->eng, &copy, is_white_turn, b->depth, &best, &score);
+
+    MoveSequence canon = best;
+    transform_sequence(&canon, sym);
+    builder_add(b, key, move_key_pack(&canon), score, BOOK_KIND_MOVE);
+  }
+
+  if (plies <= 0) return;
+
+  for (int i = 0; i < num_moves; i++) {
+    Board next = *board;
+    execute_sequence(&next, &moves[i], is_white_turn);
+    builder_expand(b, &next, !is_white_turn, plies - 1);
+  }
+}
+
+static int compare_entries(const void *a, const void *b) {
+  uint64_t ka = ((const BookEntry *)a)->key, kb = ((const BookEntry *)b)->key;
+  return (ka > kb) - (ka < kb);
+}
+
+// Search every removal pair and the first plies, and write a book file
+bool book_build(const char *path, int depth, int plies) {
+  BookBuilder b = { 0 };
+  b.depth = depth;
+  b.seen_mask = 1023;
+  b.seen = calloc(b.seen_mask + 1, sizeof(BuilderSeen));
+  b.eng = engine_create(TT_DEF_MB);
+  b.lists = malloc((size_t)(plies + 1) * MAX_SEQUENCES * sizeof(MoveSequence));
+  if (!b.seen || !b.eng || !b.lists) {
+    free(b.seen);
+    free(b.lists);
+    engine_free(b.eng);
+    return false;
+  }
+
+  Board start;
+  init_board(&start);
+
+  int best_black = -1, best_black_score = INT_MIN;
+
+  for (int idx = 0; idx < TOTAL_CELLS; idx++) {
+    int row, col;
+    index_to_coord(idx, &row, &col);
+
+    Board after_black = start;
+    if (!execute_initial_removal(&after_black, row, col, true)) continue;
+
+    /* Symmetric removals share one canonical position: search it once */
+    int sym;
+    uint64_t white_key = canonical_key(&after_black, true, &sym);
+    if (builder_mark(&b, white_key, 0) >= 0) continue;
+
+    int best_white = -1, best_white_score = INT_MAX;
+
+    for (int widx = 0; widx < TOTAL_CELLS; widx++) {
+      int wrow, wcol;
+      index_to_coord(widx, &wrow, &wcol);
+
+      Board after_white = after_black;
+      if (!execute_initial_removal(&after_white, wrow, wcol, false)) continue;
+
+      Board copy = after_white;
+      MoveSequence reply;
+      int black_score = -SCORE_MATE;   // Black has no jump: lost
+      engine_best_move(b.eng, &copy, false, depth, &reply, &black_score);
+      printf("  %c%d %c%d: %d (Black)\n", 'A' + col, row + 1, 'A' + wcol, wrow + 1, black_score);
+
+      if (black_score < best_white_score) {
+        best_white_score = black_score;
+        best_white = widx;
+      }
+
+      builder_expand(&b, &after_white, false, plies);
+    }
+
+    if (best_white < 0) continue;
+
+    builder_add(&b, white_key, transform_index(best_white, sym), -best_white_score, BOOK_KIND_REMOVAL);
+
+    if (best_white_score > best_black_score) {
+      best_black_score = best_white_score;
+      best_black = idx;
+    }
+  }
+
+  int root_sym;
+  uint64_t root_key = canonical_key(&start, false, &root_sym);
+  builder_add(&b, root_key, transform_index(best_black, root_sym), best_black_score, BOOK_KIND_REMOVAL);
+
+  qsort(b.items, b.count, sizeof(BookEntry), compare_entries);
+
+  bool ok = false;
+  FILE *f = fopen(path, "wb");
+  if (f) {
+    BookHeader header = { 0 };
+    memcpy(header.magic, BOOK_MAGIC, 4);
+    header.board_size = BOARD_SIZE;
+    header.count = (uint32_t)b.count;
+
+    ok = fwrite(&header, sizeof(header), 1, f) == 1 &&
+         fwrite(b.items, sizeof(BookEntry), b.count, f) == b.count;
+    ok = (fclose(f) == 0) && ok;
+  }
+
+  printf("Book: %zu positions (depth %d, %d plies) -> %s\n", b.count, depth, plies, path);
+
+  engine_free(b.eng);
+  free(b.items);
+  free(b.seen);
+  free(b.lists);
+  return ok;
+}
@@ -0,0 +1,125 @@
+/* Runtime selection of the board kernels (see cpu.h and kernel_impl.h). */
+#include "cpu.h"
+#include "ai.h"
+#include <stdlib.h>
+#include <string.h>
+#include <immintrin.h>
+
+/* Squares a stone can jump right from (all but the last two columns),
+   and left from; the rest of the geometry is in board.h */
+#if !BITBOARD_MULTI
+#define JUMP_RIGHT_FROM ((BB_BIT(BOARD_SIZE - 2) - 1) * COL_FIRST)
+#define JUMP_LEFT_FROM (JUMP_RIGHT_FROM << 2)
+#else
+#define JUMP_RIGHT_WORD(w) \
+  (VALID_WORD(w) & ~BB_COL_WORD(w, BOARD_SIZE - 2) & ~BB_COL_WORD(w, BOARD_SIZE - 1))
+#define JUMP_LEFT_WORD(w) (VALID_WORD(w) & ~BB_COL_WORD(w, 0) & ~BB_COL_WORD(w, 1))
+#define JUMP_UP_WORD(w) BB_RANGE_WORD(w, 2 * BOARD_SIZE, TOTAL_CELLS)
+#define JUMP_DOWN_WORD(w) BB_RANGE_WORD(w, 0, TOTAL_CELLS - 2 * BOARD_SIZE)
+#define JUMP_RIGHT_FROM BB_WORDS(JUMP_RIGHT_WORD)
+#define JUMP_LEFT_FROM BB_WORDS(JUMP_LEFT_WORD)
+#endif
+
+#if !BITBOARD_WIDE
+_Static_assert(sizeof(Board) == 2 * sizeof(uint64_t), "the AVX2 batch loads two boards per register");
+#endif
+
+/* Index step per direction, and the squares a jump in that direction
+   can start from */
+static const int dir_step[4] = {-BOARD_SIZE, 1, BOARD_SIZE, -1};
+#if !BITBOARD_MULTI
+static const Bitboard dir_from[4] = {
+  VALID_MASK & ~(BB_BIT(2 * BOARD_SIZE) - 1), JUMP_RIGHT_FROM,
+  BB_BIT(TOTAL_CELLS - 2 * BOARD_SIZE) - 1, JUMP_LEFT_FROM
+};
+#else
+static const Bitboard dir_from[4] = {
+  BB_WORDS(JUMP_UP_WORD), JUMP_RIGHT_FROM, BB_WORDS(JUMP_DOWN_WORD), JUMP_LEFT_FROM
+};
+#endif
+
+#define KERNEL(name) name##_baseline
+#include "kernel_impl.h"
+#undef KERNEL
+
+#pragma GCC push_options
+#pragma GCC target("popcnt,bmi,bmi2")
+#define KERNEL(name) name##_bmi2
+#include "kernel_impl.h"
+#undef KERNEL
+#pragma GCC pop_options
+
+/* AVX code passes four-word bitboards in registers where the rest of
+   the program passes them in memory, so those builds stop at BMI2.
+   CPU_TOP is the highest variant built. */
+#if !BITBOARD_MULTI
+#pragma GCC push_options
+#pragma GCC target("popcnt,bmi,bmi2,avx,avx2")
+#define KERNEL(name) name##_avx2
+#include "kernel_impl.h"
+#undef KERNEL
+#pragma GCC pop_options
+#define CPU_TOP CPU_AVX2
+#else
+#define CPU_TOP CPU_BMI2
+#endif
+
+#define KERNELS(level, name, suffix) \
+  { level, name, popcount_##suffix, count_all_moves_##suffix, \
+    sample_random_move_##suffix, eval_position_##suffix, eval_terms_##suffix, \
+    jump_origins_batch_##suffix, count_all_moves_batch_##suffix, eval_batch_##suffix, \
+    nnue_update_##suffix, nnue_output_##suffix }
+
+static const CpuKernels kernel_table[CPU_TOP + 1] = {
+  KERNELS(CPU_BASELINE, "baseline", baseline),
+  KERNELS(CPU_BMI2, "popcnt+bmi2", bmi2),
+#if !BITBOARD_MULTI
+  KERNELS(CPU_AVX2, "avx2", avx2),
+#endif
+};
+
+const CpuKernels *cpu_kernels = &kernel_table[CPU_BASELINE];
+
+// Best variant this processor supports and this build has
+CpuLevel cpu_detect(void) {
+  __builtin_cpu_init();
+
+  if (!__builtin_cpu_supports("popcnt") || !__builtin_cpu_supports("bmi") ||
+      !__builtin_cpu_supports("bmi2"))
+    return CPU_BASELINE;
+  if (!__builtin_cpu_supports("avx2")) return CPU_BMI2;
+  return CPU_TOP;
+}
+
+// Switch variant, e.g. for a benchmark; false if unsupported. Not while searching.
+bool cpu_select(CpuLevel level) {
+  if (level < 0 || level > cpu_detect()) return false;
+  cpu_kernels = &kernel_table[level];
+  return true;
+}
+
+// Kernels of one variant (they may only be called if supported)
+const CpuKernels *cpu_kernels_for(CpuLevel level) {
+  if (level < 0 || level > CPU_TOP) return NULL;
+  return &kernel_table[level];
+}
+
+/* Runs before main (and when the library is loaded), so every thread
+   sees the final choice */
+__attribute__((constructor))
+void cpu_init(void) {
+  CpuLevel level = cpu_detect();
+  const char *cap = getenv("KONANE_CPU");
+
+  if (cap) {
+    for (int l = 0; l <= CPU_TOP; l++) {
+      if (!strcmp(cap, kernel_table[l].name) ||
+          (l == CPU_BMI2 && !strcmp(cap, "bmi2"))) {
+        if ((CpuLevel)l < level) level = (CpuLevel)l;
+        break;
+      }
+    }
+  }
+
+  cpu_kernels = &kernel_table[level];
+}
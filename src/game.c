@@ -1,9 +1,17 @@
 /* Main game logic: setup, handle opening removals (human or AI),
    and alternate turns until no legal moves remain. */
 #include "game.h"
+#include "mcts.h"
+#include "ponder.h"
+#include "record.h"
 
-// Main game loop
+// Main game loop (negamax for every AI player)
 void run_game(GameMode mode) {
+    run_game_players(mode, PLAYER_TYPE_AI_NEGAMAX, PLAYER_TYPE_AI_NEGAMAX);
+}
+
+// Main game loop with a chosen engine for each AI side
+void run_game_players(GameMode mode, PlayerType black_ai, PlayerType white_ai) {
     /* Seed AI randomness if any AI is playing */
     if (mode == GAME_MODE_HUMAN_VS_AI || mode == GAME_MODE_AI_VS_AI) {
         ai_init();
@@ -11,6 +19,15 @@ void run_game(GameMode mode) {
     
     Board *board = (Board *)malloc(sizeof(Board));
     init_board(board);
+
+    /* One engine for the whole game: hash table, ordering tables and the
+       predicted line survive from one move to the next */
+    Engine *engine = engine_create(TT_DEF_MB);
+
+    /* MCTS players keep their own tree (indexed by is_white) */
+    Mcts *mcts[2] = { NULL, NULL };
+    if (black_ai == PLAYER_TYPE_AI_MCTS) mcts[0] = mcts_create(NULL);
+    if (white_ai == PLAYER_TYPE_AI_MCTS) mcts[1] = mcts_create(NULL);
   
     bool human_is_black = true;
     bool human_is_white = false;
@@ -40,29 +57,34 @@ void run_game(GameMode mode) {
     } else {
         printf("Black (AI) is removing a stone...\n");
         
-        int valid_positions[5][2] = {
-            {0, 0},     
-            {0, BOARD_SIZE - 1},
-            {BOARD_SIZE - 1, 0},
-            {BOARD_SIZE - 1, BOARD_SIZE - 1},
-            {BOARD_SIZE / 2, BOARD_SIZE / 2}
-        };
-        
-        int chosen_index = rand() % 5;
-        row = valid_positions[chosen_index][0];
-        col = valid_positions[chosen_index][1];
-        
-        if (!execute_initial_removal(board, row, col, true)) {
-            for (int i = 0; i < 5; i++) {
-                row = valid_positions[i][0];
-                col = valid_positions[i][1];
-                if (execute_initial_removal(board, row, col, true)) {
-                    break;
+        if (book_probe_removal(board, true, &row, &col) &&
+            execute_initial_removal(board, row, col, true)) {
+            printf("Black removed stone at %c%d (book)\n", 'A' + col, row + 1);
+        } else {
+            int valid_positions[5][2] = {
+                {0, 0},     
+                {0, BOARD_SIZE - 1},
+                {BOARD_SIZE - 1, 0},
+                {BOARD_SIZE - 1, BOARD_SIZE - 1},
+                {BOARD_SIZE / 2, BOARD_SIZE / 2}
+            };
+
+            int chosen_index = rand() % 5;
+            row = valid_positions[chosen_index][0];
+            col = valid_positions[chosen_index][1];
+
+            if (!execute_initial_removal(board, row, col, true)) {
+                for (int i = 0; i < 5; i++) {
+                    row = valid_positions[i][0];
+                    col = valid_positions[i][1];
+                    if (execute_initial_removal(board, row, col, true)) {
+                        break;
+                    }
                 }
             }
+
+            printf("Black removed stone at %c%d\n", 'A' + col, row + 1);
         }
-        
-        printf("Black removed stone at %c%d\n", 'A' + col, row + 1);
     }
     
     print_board(board);
@@ -77,12 +99,19 @@ void run_game(GameMode mode) {
     } else {
         printf("White (AI) is selecting removal adjacent to Black's removal...\n");
 
-        /* After Black's removal there should be exactly one empty square.
-           Choose a White stone adjacent to that empty square deterministically. */
+        /* Prefer the book's removal; otherwise there should be exactly one
+           empty square and we choose an adjacent White stone deterministically. */
         bool removed = false;
 
-        if (popcount(board->empty) == 1) {
-            int empty_idx = __builtin_ctzll(board->empty);
+        if (book_probe_removal(board, false, &row, &col) &&
+            execute_initial_removal(board, row, col, false)) {
+            printf("White removed stone at %c%d (book)\n", 'A' + col, row + 1);
+            removed = true;
+        }
+
+        Bitboard empty = board_empty(board);
+        if (!removed && popcount(empty) == 1) {
+            int empty_idx = bb_ctz(empty);
             int er, ec;
             index_to_coord(empty_idx, &er, &ec);
 
@@ -129,6 +158,14 @@ void run_game(GameMode mode) {
     bool is_white_turn = false;
     int move_count = 0; 
 
+    /* The game is kept as a record so it can be saved at the end */
+    GameRecord *record = malloc(sizeof(GameRecord));
+    if (record) record_begin(record, board);
+
+    /* Against a human the engine ponders on the human's time */
+    Ponder ponder = { 0 };
+    MoveSequence last_human_move = { 0 };
+
     while (true) {
         printf("--- Move %d ---\n", ++move_count);
         print_board(board);
@@ -147,6 +184,7 @@ void run_game(GameMode mode) {
 
         if (is_human_turn) {
             has_move = human_choose_move(board, is_white_turn, &seq);
+            last_human_move = seq;
             
             if (!has_move) {
                 printf("%s has no legal moves!\n", 
@@ -157,7 +195,39 @@ void run_game(GameMode mode) {
             printf("%s (AI) is thinking...\n", 
                    is_white_turn ? "White" : "Black");
             
-            has_move = get_best_move(board, is_white_turn, &seq, DEF_DEPTH);
+            PlayerType ai_type = is_white_turn ? white_ai : black_ai;
+            double start = wall_seconds();
+            int score = 0;
+            bool from_book = false;
+            bool from_ponder = false;
+
+            if (ai_type == PLAYER_TYPE_AI_MCTS) {
+                MctsResult result;
+                has_move = mcts_search(mcts[is_white_turn], board, is_white_turn, &result);
+                if (has_move) {
+                    seq = result.best;
+                    printf("[MCTS] %llu playouts (%llu reused), win rate %.1f%%\n",
+                           (unsigned long long)result.playouts, (unsigned long long)result.reused,
+                           result.win_rate * 100.0);
+                }
+            } else if (ai_type == PLAYER_TYPE_AI_RANDOM) {
+                has_move = ai_random_move(board, is_white_turn, &seq);
+            } else {
+                from_book = book_probe_move(board, is_white_turn, &seq, NULL);
+
+                if (from_book) ponder_finish(&ponder, NULL, NULL, NULL);
+                else from_ponder = ponder_finish(&ponder, &last_human_move, &seq, &score);
+
+                has_move = from_book || from_ponder ||
+                           engine_best_move(engine, board, is_white_turn, DEF_DEPTH, &seq, &score);
+                if (has_move && !from_book) printf("[Negamax] depth %d, score %d\n", DEF_DEPTH, score);
+            }
+
+            /* The searches cannot list more than MAX_SEQUENCES moves */
+            if (!has_move && count_all_moves(board, is_white_turn) > 0) {
+                printf("[Random] too many moves to search\n");
+                has_move = ai_random_move(board, is_white_turn, &seq);
+            }
             
             if (!has_move) {
                 printf("%s (AI) has no legal moves!\n", 
@@ -165,11 +235,21 @@ void run_game(GameMode mode) {
                 break;
             }
             
-            printf("AI plays: ");
+            if (mode == GAME_MODE_HUMAN_VS_AI) {
+                printf("AI replied in %.1f ms%s\n", (wall_seconds() - start) * 1000.0,
+                       from_ponder ? " (ponder hit)" : "");
+            }
+            printf(from_book ? "AI plays (book): " : "AI plays: ");
             print_move_sequence(&seq);
         }
         
         execute_sequence(board, &seq, is_white_turn);
+        if (record) record_move(record, &seq);
+
+        if (mode == GAME_MODE_HUMAN_VS_AI && !is_human_turn &&
+            (is_white_turn ? white_ai : black_ai) == PLAYER_TYPE_AI_NEGAMAX) {
+            ponder_start(&ponder, engine, board, !is_white_turn, DEF_DEPTH);
+        }
 
         is_white_turn = !is_white_turn;
         
@@ -184,10 +264,37 @@ void run_game(GameMode mode) {
   
     printf("Winner: %s\n", 
            is_white_turn ? "Black" : "White");
+
+    if (record) {
+        record->winner = is_white_turn ? RECORD_BLACK_WINS : RECORD_WHITE_WINS;
+        save_game_record(record);
+        free(record);
+    }
     
+    ponder_finish(&ponder, NULL, NULL, NULL);
+    engine_free(engine);
+    mcts_free(mcts[0]);
+    mcts_free(mcts[1]);
     free(board);
 }
 
+// Offer to append a finished game to the game archive
+void save_game_record(const GameRecord *record) {
+  char answer = 'n';
+
+  printf("Save game to %s? (y/n): ", RECORD_DEF_PATH);
+  if (scanf(" %c", &answer) != 1 || tolower(answer) != 'y') return;
+
+  ArchiveWriter *writer = archive_writer_open(RECORD_DEF_PATH);
+  bool ok = writer && archive_append(writer, record);
+  uint64_t number = writer ? writer->count : 0;
+
+  if (archive_writer_close(writer) && ok)
+    printf("Saved as game %llu of %s\n", (unsigned long long)number, RECORD_DEF_PATH);
+  else
+    printf("Could not write %s\n", RECORD_DEF_PATH);
+}
+
 // Read coordinate from user
 bool read_coord(int *row, int *col) {
   char col_char;
@@ -214,12 +321,17 @@ bool human_choose_move(Board *board, bool is_white_turn, MoveSequence *chosen_se
   char from_col_char, to_col_char;
   int from_row, to_row;
 
-  MoveSequence all_moves[MAX_MOVES];
+  MoveSequence all_moves[MAX_SEQUENCES];
   int num_moves = generate_all_moves(board, is_white_turn, all_moves);
 
   if (num_moves == 0)
     return false;
 
+  if (num_moves < 0) {
+    printf("More than %d legal moves, too many to list: playing a random one\n", MAX_SEQUENCES);
+    return ai_random_move(board, is_white_turn, chosen_seq);
+  }
+
   while (true) {
     printf("%s move: ", is_white_turn ? "White" : "Black");
     if (scanf(" %c%d %c%d", &from_col_char, &from_row, &to_col_char, &to_row) != 4) {
@@ -243,7 +355,7 @@ bool human_choose_move(Board *board, bool is_white_turn, MoveSequence *chosen_se
     int from_idx = coord_to_index(from_r, from_col);
     int to_idx   = coord_to_index(to_r, to_col);
 
-    MoveSequence matching_sequences[MAX_MOVES];
+    MoveSequence matching_sequences[MAX_SEQUENCES];
     int num_matching = 0;
     
     for (int i = 0; i < num_moves; i++) {
@@ -2,12 +2,18 @@
 #define __AI_H__
 
 #include "board.h"
+#include "cpu.h"
 #include "game.h"
 #include "move.h"
+#include "nnue.h"
+#include "stats.h"
+#include "trace.h"
+#include "tt.h"
+#include <pthread.h>
 #include <stdlib.h>
 #include <time.h>
 
-// Define weights for different eval factors
+// Default weights for the different eval factors
 #define MOBILITY_WEIGHT 20
 #define MATERIAL_WEIGHT 15
 #define CORNER_WEIGHT 6
@@ -15,6 +21,31 @@
 #define JUMP_POTENTIAL_WEIGHT 5
 #define ISOLATION_PENALTY -3
 
+/* eval_position is a weighted sum of these terms (White's count minus
+   Black's). The weights start at the defaults above and can be replaced
+   from a weights file, "name value" per line, e.g. written by the tuner. */
+typedef enum {
+  EVAL_MOBILITY,
+  EVAL_MATERIAL,
+  EVAL_CORNER,
+  EVAL_EDGE,
+  EVAL_JUMP_POTENTIAL,
+  EVAL_ISOLATION,
+  EVAL_NUM_TERMS
+} EvalTerm;
+
+#define EVAL_WEIGHTS_DEF_PATH "konane.weights"
+
+// Active weights (read by every kernel) and their names in weights files
+extern int eval_weights[EVAL_NUM_TERMS];
+extern const char *const eval_term_names[EVAL_NUM_TERMS];
+
+// Load / save weights; load fails (and changes nothing) on a missing or malformed file
+bool eval_weights_load(const char *path);
+bool eval_weights_save(const int *weights, const char *path);
+// Back to the compiled-in defaults
+void eval_weights_reset(void);
+
 // Alpha/Beta minimums and maximums
 #define INT_MIN -1e9
 #define INT_MAX 1e9
@@ -30,9 +61,134 @@ bool ai_random_move(Board *board, bool is_white_turn, MoveSequence *chosen_seq);
 
 // Evaluate a position from a player's perspective
 int eval_position(Board *board, bool player_is_white);
+// eval_position for n boards (scores[i] for player_is_white[i]), same scores, vectorized
+void eval_batch(const Board *boards, int n, const bool *player_is_white, int *scores);
+/* The terms of eval_position, White minus Black; false when a side has no
+   move left and eval_position returns its fixed win/loss score instead */
+bool eval_terms(const Board *board, int *terms);
 // Negamax search with alpha beta pruning
 int negamax(Board *board, int depth, bool is_white, int alpha, int beta, MoveSequence *best_sequence);
+// Negamax that also adds its counts to stats (NULL = none)
+int negamax_with_stats(Board *board, int depth, bool is_white, int alpha, int beta,
+                       MoveSequence *best_sequence, SearchStats *stats);
 // Wrapper to get best move
 bool get_best_move(Board *board, bool is_white_turn, MoveSequence *chosen_seq, int depth);
 
+/* Engine context kept alive by the game loop between moves: the hash
+   table, killer/history ordering tables and the predicted line. A search
+   can also run asynchronously on a worker thread owned by the engine. */
+#define MAX_PLY TOTAL_CELLS // every move removes at least one stone
+
+/* A side with no jump at a searched node loses: -SCORE_MATE plus the
+   remaining depth, so proven scores lie within MAX_PLY of +-SCORE_MATE.
+   The evaluation's verdict for a stuck side has not been searched and
+   stays just outside that band. */
+#define SCORE_MATE 10000
+#define SCORE_STUCK (SCORE_MATE - MAX_PLY - 1)
+#define SCORE_IS_MATE(s) ((s) >= SCORE_MATE - MAX_PLY || (s) <= -SCORE_MATE + MAX_PLY)
+
+// Nodes between checks of the stop flag, deadline and node budget (2^n - 1)
+#define STOP_CHECK_INTERVAL 63
+
+/* Move list and ordering scores of one search ply. They live on the heap:
+   a recursive frame holding MAX_SEQUENCES of each would overrun a thread's
+   stack on the large boards. */
+typedef struct {
+  MoveSequence moves[MAX_SEQUENCES];
+  int order[MAX_SEQUENCES];
+} SearchPly;
+
+typedef struct {
+  int depth;        // maximum depth (0 = no limit)
+  int movetime_ms;  // wall-clock budget (0 = no limit)
+  uint64_t nodes;   // node budget (0 = no limit)
+} SearchLimits;
+
+typedef struct {
+  MoveSequence best;
+  int score;        // from the side to move
+  int depth;        // last fully searched depth
+  uint64_t nodes;
+  double seconds;
+  bool has_move;
+} SearchResult;
+
+/* Called from the searching thread after every completed iteration, with
+   that iteration's result and principal variation */
+typedef void (*EngineInfoFn)(void *ctx, const SearchResult *result,
+                             const MoveSequence *pv, int pv_length);
+
+typedef struct {
+  TransTable *tt;
+  int history[2][TOTAL_CELLS][TOTAL_CELLS]; // [side][from][to] cutoff credit
+  MoveKey killers[MAX_PLY][2];
+  MoveSequence pv[MAX_PLY];                 // line expected from pv_root
+  int pv_length;
+  Board pv_root;
+  bool pv_side;
+  int last_depth;
+  uint64_t nodes;                           // nodes of the current search
+  uint64_t pv_hits;                         // searches that followed the PV
+  SearchStats stats;                        // of the last search
+  int stop;                                 // set by another thread to abort
+  bool aborted;                             // current search hit a limit
+  double deadline;                          // wall clock, 0 = none
+  uint64_t node_limit;
+  EngineInfoFn info;                        // per-iteration report (or NULL)
+  void *info_ctx;
+  const Nnue *nnue;                         // evaluator (NULL = eval_position)
+  NnueAccumulator nnue_acc[MAX_PLY + 1];    // per ply, updated move by move
+  SearchPly *plies[MAX_PLY + 1];            // per ply, allocated on first use
+  TraceBuffer *trace;                       // search trace (or NULL)
+
+  /* Asynchronous search */
+  pthread_t worker;
+  bool worker_running;
+  pthread_mutex_t lock;
+  pthread_cond_t done_cond;
+  bool done;
+  Board root;
+  bool root_white;
+  SearchLimits limits;
+  SearchResult result;                      // best so far (under lock)
+} Engine;
+
+// Monotonic wall-clock seconds
+double wall_seconds(void);
+
+// Create / free an engine with a hash table of tt_mb megabytes
+Engine *engine_create(size_t tt_mb);
+void engine_free(Engine *eng);
+// Forget everything learned (new game)
+void engine_new_game(Engine *eng);
+// Report every completed iteration of later searches (fn NULL = off)
+void engine_set_info(Engine *eng, EngineInfoFn fn, void *ctx);
+// Evaluate leaves with a network instead of eval_position (NULL = back); not while searching
+void engine_set_nnue(Engine *eng, const Nnue *net);
+// Record the search into a trace ring (NULL = off; the caller owns it); not while searching
+void engine_set_trace(Engine *eng, TraceBuffer *trace);
+
+// Iterative deepening search within limits (blocking); false with no move or more than MAX_SEQUENCES
+bool engine_search(Engine *eng, const Board *board, bool is_white_turn,
+                   const SearchLimits *limits, SearchResult *result);
+// Depth-limited search (blocking)
+bool engine_best_move(Engine *eng, Board *board, bool is_white_turn, int depth,
+                      MoveSequence *chosen_seq, int *score_out);
+
+// Start searching on the engine's worker thread
+bool engine_start(Engine *eng, const Board *board, bool is_white_turn,
+                  const SearchLimits *limits);
+// Best result so far; true once the search has finished
+bool engine_poll(Engine *eng, SearchResult *result);
+// Stop a running search as soon as possible / allow searching again
+void engine_stop(Engine *eng);
+void engine_clear_stop(Engine *eng);
+/* Join the worker and fetch the result: timeout_ms < 0 waits for the
+   search to finish, 0 stops it now, > 0 stops it when the timeout expires
+   (so the call returns within that bound plus one stop check interval). */
+bool engine_wait(Engine *eng, SearchResult *result, int timeout_ms);
+
+// The reply the last search expects from the opponent
+bool engine_predicted_reply(const Engine *eng, MoveSequence *reply);
+
 #endif
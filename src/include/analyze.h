@@ -0,0 +1,41 @@
+#ifndef __ANALYZE_H__
+#define __ANALYZE_H__
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "ai.h"
+
+/* Batch analysis: positions are read one per line (position notation,
+   blank lines and '#' comments are skipped), searched on the thread pool
+   (pool.h) and written in input order as
+     <position> bestmove <move> score <s> depth <d> nodes <n> time <ms>
+   Every worker has its own engine, cleared before each position, so the
+   output at a fixed depth does not depend on the thread count. With
+   static_eval set, positions are not searched but scored in blocks by
+   eval_batch, one "<position> eval <score>" line each (side to move's view).
+   A network (nnue) replaces eval_position in both modes. */
+
+#define ANALYZE_DEF_HASH_MB 16
+
+typedef struct {
+  SearchLimits limits;  // depth DEF_DEPTH when neither depth nor time is set
+  int threads;          // 0 = one per online CPU
+  size_t hash_mb;       // per worker
+  bool static_eval;     // static evaluation only, no search
+  const Nnue *nnue;     // evaluator (NULL = eval_position)
+} AnalyzeConfig;
+
+typedef struct {
+  uint64_t positions;
+  uint64_t invalid;
+  uint64_t nodes;
+  double seconds;
+} AnalyzeStats;
+
+AnalyzeConfig analyze_default_config(void);
+
+// Analyze every position from in, writing one result line each to out
+bool analyze_stream(FILE *in, FILE *out, const AnalyzeConfig *config, AnalyzeStats *stats);
+
+#endif
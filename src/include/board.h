@@ -5,23 +5,182 @@
 #include <stdbool.h>
 #include <stdio.h>
 
-/* Bitboard layout: 7x7 board stored in row-major order using the lower
-   49 bits of a 64-bit integer. Index 0 = row 0, col 0 (A1). */
-#define BOARD_SIZE 7
+/* Bitboard layout: BOARD_SIZE x BOARD_SIZE board stored in row-major
+   order in the low TOTAL_CELLS bits of the bitboard. Index 0 = row 0,
+   col 0 (A1). The size is fixed at compile time (-DBOARD_SIZE=N, 7 by
+   default) so every shift and mask below is a constant: boards up to 8x8
+   use one 64-bit word, up to 11x11 a 128-bit integer and larger ones four
+   words. */
+#define BOARD_DEFAULT_SIZE 7
+#ifndef BOARD_SIZE
+#define BOARD_SIZE BOARD_DEFAULT_SIZE
+#endif
+#if BOARD_SIZE < 4 || BOARD_SIZE > 16
+#error "BOARD_SIZE must be between 4 and 16"
+#endif
 #define TOTAL_CELLS (BOARD_SIZE * BOARD_SIZE)
 
+#if TOTAL_CELLS <= 64
 typedef uint64_t Bitboard;
+#define BITBOARD_WORDS 1
+#elif TOTAL_CELLS <= 128
+typedef unsigned __int128 Bitboard;
+#define BITBOARD_WORDS 2
+#else
+/* A GCC vector of four words: &, |, ^ and ~ work on it as on an integer,
+   shifts, tests and constants go through the helpers below. Every unit is
+   built without AVX (cpu.c leaves out its AVX2 kernels for this size), so
+   the 32-byte vectors are passed the same way everywhere. */
+typedef uint64_t Bitboard __attribute__((vector_size(32)));
+#define BITBOARD_WORDS 4
+#endif
+#define BITBOARD_WIDE (BITBOARD_WORDS > 1)
+#define BITBOARD_MULTI (BITBOARD_WORDS > 2)
 
+/* Only the two colours are stored (16 bytes on boards up to 8x8): the
+   search copies a board per node and caches keep many of them, while
+   occupied/empty cost one OR to derive */
 typedef struct {
   Bitboard white;
   Bitboard black;
-  Bitboard occupied; // (white | black)
-  Bitboard empty; // (~occupied & VALID_MASK)
 } Board;
 
-#define VALID_MASK 0x1FFFFFFFFFFFF // 2^49 - 1
+#if !BITBOARD_MULTI
+#define BB_ZERO ((Bitboard)0)
+#define BB_BIT(index) ((Bitboard)1 << (index))
+#define VALID_MASK (~(Bitboard)0 >> (8 * sizeof(Bitboard) - TOTAL_CELLS))
+
+/* Board geometry */
+#define ROW_FIRST (BB_BIT(BOARD_SIZE) - 1)                   // row 1
+#define ROW_LAST (ROW_FIRST << (TOTAL_CELLS - BOARD_SIZE))
+#define COL_FIRST (VALID_MASK / ROW_FIRST)                   // column A
+#define COL_LAST (COL_FIRST << (BOARD_SIZE - 1))
+#define CORNER_MASK ((COL_FIRST | COL_LAST) & (ROW_FIRST | ROW_LAST))
+#define EDGE_MASK ((COL_FIRST | COL_LAST | ROW_FIRST | ROW_LAST) & ~CORNER_MASK)
+
+/* Shifts by whole rows or a few columns, and the tests the wider layouts
+   cannot write as plain operators (macros, so unoptimized builds stay
+   as they were) */
+#define bb_shl(bitboard, n) ((bitboard) << (n))
+#define bb_shr(bitboard, n) ((bitboard) >> (n))
+#define bb_any(bitboard) ((bitboard) != 0)
+#define bb_test(bitboard, index) (((bitboard) >> (index)) & 1)
+#define bb_less(a, b) ((a) < (b))
+#define bb_clear_lsb(bitboard) ((bitboard) & ((bitboard) - 1))
+// Word w (0 = squares 0-63) of a bitboard
+#if BITBOARD_WIDE
+#define bb_word(bitboard, w) ((uint64_t)((bitboard) >> (64 * (w))))
+#else
+#define bb_word(bitboard, w) ((uint64_t)(bitboard))
+#endif
+
+// Index of the lowest set bit (bitboard must be non-zero)
+static inline int bb_ctz(Bitboard bitboard) {
+#if BITBOARD_WIDE
+  uint64_t low = (uint64_t)bitboard;
+  return low ? __builtin_ctzll(low) : 64 + __builtin_ctzll((uint64_t)(bitboard >> 64));
+#else
+  return __builtin_ctzll(bitboard);
+#endif
+}
+#else
+/* The masks are built word by word from integer constant expressions, so
+   they still fold and can initialize static tables. Word w of the squares
+   lo..hi-1, and of column c (its squares repeat every BOARD_SIZE bits,
+   a geometric series summed in 128 bits): */
+#define BB_ONES(n) ((n) >= 64 ? ~0ULL : (1ULL << ((n) & 63)) - 1)
+#define BB_CLAMP(n) ((n) < 0 ? 0 : (n) > 64 ? 64 : (n))
+#define BB_RANGE_WORD(w, lo, hi) \
+  (BB_ONES(BB_CLAMP((hi) - 64 * (w))) & ~BB_ONES(BB_CLAMP((lo) - 64 * (w))))
+#define BB_COL_START(w, c) (((c) - (64 * (w)) % BOARD_SIZE + BOARD_SIZE) % BOARD_SIZE)
+#define BB_COL_REPEAT(start) \
+  ((uint64_t)((((unsigned __int128)1 << (BOARD_SIZE * ((63 - (start)) / BOARD_SIZE + 1))) - 1) / \
+              (((unsigned __int128)1 << BOARD_SIZE) - 1)))
+#define BB_COL_WORD(w, c) \
+  ((BB_COL_REPEAT(BB_COL_START(w, c)) << BB_COL_START(w, c)) & VALID_WORD(w))
+#define BB_WORDS(word) ((Bitboard){ word(0), word(1), word(2), word(3) })
+
+#define VALID_WORD(w) BB_RANGE_WORD(w, 0, TOTAL_CELLS)
+#define ROW_FIRST_WORD(w) BB_RANGE_WORD(w, 0, BOARD_SIZE)
+#define ROW_LAST_WORD(w) BB_RANGE_WORD(w, TOTAL_CELLS - BOARD_SIZE, TOTAL_CELLS)
+#define COL_FIRST_WORD(w) BB_COL_WORD(w, 0)
+#define COL_LAST_WORD(w) BB_COL_WORD(w, BOARD_SIZE - 1)
+#define CORNER_WORD(w) \
+  ((COL_FIRST_WORD(w) | COL_LAST_WORD(w)) & (ROW_FIRST_WORD(w) | ROW_LAST_WORD(w)))
+#define EDGE_WORD(w) \
+  ((COL_FIRST_WORD(w) | COL_LAST_WORD(w) | ROW_FIRST_WORD(w) | ROW_LAST_WORD(w)) & ~CORNER_WORD(w))
+
+#define BB_ZERO ((Bitboard){ 0, 0, 0, 0 })
+#define BB_BIT_WORD(index, w) ((index) >> 6 == (w) ? 1ULL << ((index) & 63) : 0)
+#define BB_BIT(index) ((Bitboard){ BB_BIT_WORD(index, 0), BB_BIT_WORD(index, 1), \
+                                   BB_BIT_WORD(index, 2), BB_BIT_WORD(index, 3) })
+#define VALID_MASK BB_WORDS(VALID_WORD)
+
+/* Board geometry */
+#define ROW_FIRST BB_WORDS(ROW_FIRST_WORD)
+#define ROW_LAST BB_WORDS(ROW_LAST_WORD)
+#define COL_FIRST BB_WORDS(COL_FIRST_WORD)
+#define COL_LAST BB_WORDS(COL_LAST_WORD)
+#define CORNER_MASK BB_WORDS(CORNER_WORD)
+#define EDGE_MASK BB_WORDS(EDGE_WORD)
+
+typedef int64_t BitboardLanes __attribute__((vector_size(32)));
+
+// Shifts by 1 to 63 squares: each word takes the bits its neighbour shifts out
+static inline Bitboard bb_shl(Bitboard bitboard, int n) {
+  Bitboard carry = __builtin_shuffle(bitboard, BB_ZERO, (BitboardLanes){ 4, 0, 1, 2 });
+  return (bitboard << n) | (carry >> (64 - n));
+}
+
+static inline Bitboard bb_shr(Bitboard bitboard, int n) {
+  Bitboard carry = __builtin_shuffle(bitboard, BB_ZERO, (BitboardLanes){ 1, 2, 3, 4 });
+  return (bitboard >> n) | (carry << (64 - n));
+}
+
+static inline bool bb_any(Bitboard bitboard) {
+  return (bitboard[0] | bitboard[1] | bitboard[2] | bitboard[3]) != 0;
+}
 
-// Check if row,col is a valid position in the 7x7 board
+static inline bool bb_test(Bitboard bitboard, int index) {
+  return (bitboard[index >> 6] >> (index & 63)) & 1;
+}
+
+static inline uint64_t bb_word(Bitboard bitboard, int w) {
+  return bitboard[w];
+}
+
+static inline bool bb_less(Bitboard a, Bitboard b) {
+  for (int w = BITBOARD_WORDS - 1; w >= 0; w--)
+    if (a[w] != b[w]) return a[w] < b[w];
+  return false;
+}
+
+static inline int bb_ctz(Bitboard bitboard) {
+  int w = 0;
+  while (!bitboard[w]) w++;
+  return 64 * w + __builtin_ctzll(bitboard[w]);
+}
+
+static inline Bitboard bb_clear_lsb(Bitboard bitboard) {
+  int w = 0;
+  while (!bitboard[w]) w++;
+  bitboard[w] &= bitboard[w] - 1;
+  return bitboard;
+}
+#endif
+
+// Centre square row/column (D4 on 7x7), where the standard opening starts
+#define BOARD_CENTER (BOARD_SIZE / 2)
+
+static inline Bitboard board_occupied(const Board *board) {
+  return board->white | board->black;
+}
+
+static inline Bitboard board_empty(const Board *board) {
+  return ~(board->white | board->black) & VALID_MASK;
+}
+
+// Check if row,col is a valid position on the board
 bool is_valid_position(int row, int col);
 
 // Count number of on bits
@@ -32,6 +191,21 @@ int pop_lsb(Bitboard *bitboard);
 // Conversion functions
 int coord_to_index(int row, int col);
 void index_to_coord(int index, int *row, int *col);
+// Parse a coordinate such as "D4" (column letter, row number)
+bool parse_coord(const char *text, int *row, int *col);
+
+/* One-line position notation, e.g. "BWBWBWB/WBWBWBW/BWBWBWB/WB2WBW/
+   BWBWBWB/WBWBWBW/BWBWBWB b" (rows 1..N, digits are empty runs; runs
+   longer than 9 are split, "91" for 10) */
+#define BOARD_TEXT_MAX (TOTAL_CELLS + BOARD_SIZE + 3)
+void board_to_text(const Board *board, bool is_white_turn, char *buf);
+bool board_from_text(const char *text, Board *board, bool *is_white_turn);
+
+// Hash a position (stones plus side to move) into 64 bits
+uint64_t board_hash(const Board *board, bool is_white_turn);
+
+// Small per-caller PRNG (xorshift64*); state must be non-zero
+uint64_t random_next(uint64_t *state);
 
 // Initialize board
 void init_board(Board *board);
@@ -45,6 +219,18 @@ void set_white(Board *board, int row, int col);
 void set_black(Board *board, int row, int col);
 void remove_stone(Board *board, int row, int col);
 
+/* Board symmetries: bit 0 transposes, bit 1 mirrors rows, bit 2 mirrors
+   columns (applied in that order). Only symmetries that map the initial
+   checkerboard onto itself are usable on a game position. */
+#define NUM_SYMMETRIES 8
+
+int transform_index(int index, int sym);
+Bitboard transform_bitboard(Bitboard bitboard, int sym);
+int inverse_symmetry(int sym);
+bool symmetry_preserves_colors(int sym);
+// Symmetry that maps a position to its canonical (smallest) form
+int canonical_symmetry(const Board *board);
+
 // Get bitmask for a position (row, col)
 Bitboard get_bitmask(int row, int col);
 
@@ -0,0 +1,30 @@
+#ifndef __BOOK_H__
+#define __BOOK_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "board.h"
+#include "move.h"
+
+// Book loaded at startup, and the default build settings
+#define BOOK_DEF_PATH "konane.book"
+#define BOOK_DEF_DEPTH 7
+#define BOOK_DEF_PLIES 4
+
+// Map a book file into memory as the engine-wide book
+bool book_init(const char *path);
+void book_close(void);
+// Number of positions in the loaded book (0 if none)
+size_t book_size(void);
+
+// Book move for a position after the removals; false when out of book
+bool book_probe_move(const Board *board, bool is_white_turn,
+                     MoveSequence *seq, int *score);
+// Book choice for an initial removal; false when out of book
+bool book_probe_removal(const Board *board, bool is_black,
+                        int *row, int *col);
+
+// Search every removal pair and the first plies, and write a book file
+bool book_build(const char *path, int depth, int plies);
+
+#endif
@@ -0,0 +1,53 @@
+#ifndef __CPU_H__
+#define __CPU_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "board.h"
+#include "move.h"
+#include "nnue.h"
+
+/* Hot board kernels in several instruction-set variants. The best variant
+   the processor supports is picked once at startup (cpuid), and the rest of
+   the program calls through cpu_kernels. Setting KONANE_CPU=baseline, bmi2
+   or avx2 in the environment caps the choice, to compare hosts. */
+
+typedef enum {
+  CPU_BASELINE,   // x86-64 / generic
+  CPU_BMI2,       // POPCNT + BMI1 + BMI2
+  CPU_AVX2,       // the above plus AVX2
+  CPU_NUM_LEVELS
+} CpuLevel;
+
+typedef struct {
+  CpuLevel level;
+  const char *name;
+  int (*popcount)(Bitboard bitboard);
+  int (*count_all_moves)(const Board *board, bool is_white_turn);
+  bool (*sample_random_move)(const Board *board, bool is_white_turn,
+                             uint64_t *rng, MoveSequence *out);
+  int (*eval_position)(const Board *board, bool player_is_white);
+  bool (*eval_terms)(const Board *board, int *terms);
+  void (*jump_origins_batch)(const Board *boards, const bool *is_white_turn,
+                             int n, Bitboard *origins);
+  void (*count_all_moves_batch)(const Board *boards, const bool *is_white_turn,
+                                int n, int *counts);
+  void (*eval_batch)(const Board *boards, int n, const bool *player_is_white, int *scores);
+  void (*nnue_update)(const Nnue *net, const NnueAccumulator *in, NnueAccumulator *out,
+                      const MoveSequence *seq, bool white_moved);
+  int (*nnue_output)(const Nnue *net, const NnueAccumulator *acc, bool white_to_move);
+} CpuKernels;
+
+// Active variant (the baseline until cpu_init has run)
+extern const CpuKernels *cpu_kernels;
+
+// Best variant this processor supports and this build has (BMI2 on four-word boards)
+CpuLevel cpu_detect(void);
+// Select the best supported variant (runs automatically at startup)
+void cpu_init(void);
+// Switch variant, e.g. for a benchmark; false if unsupported. Not while searching.
+bool cpu_select(CpuLevel level);
+// Kernels of one variant, NULL if not built (they may only be called if supported)
+const CpuKernels *cpu_kernels_for(CpuLevel level);
+
+#endif
@@ -5,7 +5,9 @@
 #include <ctype.h>
 #include "ai.h"
 #include "board.h"
+#include "book.h"
 #include "move.h"
+#include "record.h"
 
 typedef enum {
   GAME_MODE_HUMAN_VS_HUMAN,
@@ -15,12 +17,19 @@ typedef enum {
 
 typedef enum {
   PLAYER_TYPE_HUMAN,
-  PLAYER_TYPE_AI_RANDOM
+  PLAYER_TYPE_AI_RANDOM,
+  PLAYER_TYPE_AI_NEGAMAX,
+  PLAYER_TYPE_AI_MCTS
 } PlayerType;
 
 
-// Main game loop
+// Main game loop (negamax for every AI player)
 void run_game(GameMode mode);
+// Main game loop with a chosen engine for each AI side
+void run_game_players(GameMode mode, PlayerType black_ai, PlayerType white_ai);
+
+// Offer to append a finished game to the game archive
+void save_game_record(const GameRecord *record);
 
 // Read coordinate from user
 bool read_coord(int *row, int *col);
@@ -0,0 +1,585 @@
+/* Board kernels, compiled once per instruction-set variant: cpu.c includes
+   this file several times under different "#pragma GCC target" settings,
+   with KERNEL(name) giving every copy its own suffix. There is no include
+   guard on purpose. Hot paths only call helpers defined here, which get
+   the variant's instructions too; the tables they share live in cpu.c. */
+
+#ifndef KERNEL
+#error "define KERNEL(name) before including kernel_impl.h"
+#endif
+
+/* Boards over 8x8 take two or four words; the 64-bit build compiles to
+   the plain instructions */
+static inline int KERNEL(bb_count)(Bitboard bitboard) {
+#if BITBOARD_WIDE
+  int count = 0;
+  for (int w = 0; w < BITBOARD_WORDS; w++) count += __builtin_popcountll(bb_word(bitboard, w));
+  return count;
+#else
+  return __builtin_popcountll(bitboard);
+#endif
+}
+
+static inline int KERNEL(pop_lsb)(Bitboard *bitboard) {
+  int idx = bb_ctz(*bitboard);
+  *bitboard = bb_clear_lsb(*bitboard);
+  return idx;
+}
+
+static int KERNEL(popcount)(Bitboard bitboard) {
+  return KERNEL(bb_count)(bitboard);
+}
+
+// Landing square of a jump from idx in dir, or -1 off the board
+static inline int KERNEL(jump_landing)(int idx, int dir) {
+  return bb_test(dir_from[dir], idx) ? idx + 2 * dir_step[dir] : -1;
+}
+
+// Stones of `own` that have at least one jump
+static inline Bitboard KERNEL(jumping_stones)(Bitboard own, Bitboard opp, Bitboard empty) {
+  Bitboard jumpers = bb_shl(opp, BOARD_SIZE) & bb_shl(empty, 2 * BOARD_SIZE);
+  jumpers |= bb_shr(opp, BOARD_SIZE) & bb_shr(empty, 2 * BOARD_SIZE);
+  jumpers |= bb_shr(opp, 1) & bb_shr(empty, 2) & JUMP_RIGHT_FROM;
+  jumpers |= bb_shl(opp, 1) & bb_shl(empty, 2) & JUMP_LEFT_FROM;
+
+  return own & jumpers;
+}
+
+// Number of maximal chains from a stone on `from` (matches dfs_jumps)
+static int KERNEL(count_chains)(int from, Bitboard opp, Bitboard empty, int depth) {
+  int total = 0;
+  bool found_jump = false;
+
+  for (int dir = 0; dir < 4; dir++) {
+    int land = KERNEL(jump_landing)(from, dir);
+    if (land < 0) continue;
+
+    int over = (from + land) / 2;
+    if (!bb_test(opp, over) || !bb_test(empty, land)) continue;
+
+    found_jump = true;
+    Bitboard freed = BB_BIT(from) | BB_BIT(over);
+    total += KERNEL(count_chains)(land, opp & ~BB_BIT(over),
+                                  (empty | freed) & ~BB_BIT(land), depth + 1);
+  }
+
+  return (!found_jump && depth > 0) ? 1 : total;
+}
+
+// Walk the chains from `from` in dfs_jumps order and stop at the target-th one
+static bool KERNEL(pick_chain)(int from, Bitboard opp, Bitboard empty,
+                               MoveSequence *seq, int *target) {
+  bool found_jump = false;
+
+  for (int dir = 0; dir < 4; dir++) {
+    int land = KERNEL(jump_landing)(from, dir);
+    if (land < 0) continue;
+
+    int over = (from + land) / 2;
+    if (!bb_test(opp, over) || !bb_test(empty, land)) continue;
+
+    found_jump = true;
+    seq->jumps[seq->count++] = MOVE_ENCODE(from, land, over, 1, dir);
+
+    Bitboard freed = BB_BIT(from) | BB_BIT(over);
+    if (KERNEL(pick_chain)(land, opp & ~BB_BIT(over),
+                           (empty | freed) & ~BB_BIT(land), seq, target))
+      return true;
+
+    seq->count--;
+  }
+
+  return !found_jump && seq->count > 0 && (*target)-- == 0;
+}
+
+static int KERNEL(count_all_moves)(const Board *board, bool is_white_turn) {
+  Bitboard own = is_white_turn ? board->white : board->black;
+  Bitboard opp = is_white_turn ? board->black : board->white;
+  Bitboard empty = board_empty(board);
+  Bitboard pieces = KERNEL(jumping_stones)(own, opp, empty);
+  int total = 0;
+
+  while (bb_any(pieces)) {
+    int idx = KERNEL(pop_lsb)(&pieces);
+    total += KERNEL(count_chains)(idx, opp, empty, 0);
+  }
+
+  return total;
+}
+
+static bool KERNEL(sample_random_move)(const Board *board, bool is_white_turn,
+                                       uint64_t *rng, MoveSequence *out) {
+  Bitboard own = is_white_turn ? board->white : board->black;
+  Bitboard opp = is_white_turn ? board->black : board->white;
+  Bitboard empty = board_empty(board);
+  Bitboard pieces = KERNEL(jumping_stones)(own, opp, empty);
+  int stones[TOTAL_CELLS], counts[TOTAL_CELLS];
+  int num_stones = 0, total = 0;
+
+  while (bb_any(pieces)) {
+    int idx = KERNEL(pop_lsb)(&pieces);
+    stones[num_stones] = idx;
+    counts[num_stones] = KERNEL(count_chains)(idx, opp, empty, 0);
+    total += counts[num_stones++];
+  }
+
+  if (total == 0) return false;
+
+  int target = (int)(random_next(rng) % (uint64_t)total);
+  int i = 0;
+  while (target >= counts[i]) target -= counts[i++];
+
+  out->count = 0;
+  return KERNEL(pick_chain)(stones[i], opp, empty, out, &target);
+}
+
+/* First jumps of `own` by direction, split into jumps that end the move
+   (one sequence each) and jumps that can go on. A second jump from the
+   landing square could only see the squares the first jump changed by
+   going straight back, so both sets come from the board before the move
+   and cost a few shifts instead of a walk down every chain. */
+static inline void KERNEL(first_jumps)(Bitboard own, Bitboard opp, Bitboard empty,
+                                       Bitboard *final, Bitboard *cont) {
+  // Squares a jump in each direction could start from, whatever is on them
+  Bitboard can[4] = {
+    bb_shl(opp, BOARD_SIZE) & bb_shl(empty, 2 * BOARD_SIZE),
+    bb_shr(opp, 1) & bb_shr(empty, 2) & JUMP_RIGHT_FROM,
+    bb_shr(opp, BOARD_SIZE) & bb_shr(empty, 2 * BOARD_SIZE),
+    bb_shl(opp, 1) & bb_shl(empty, 2) & JUMP_LEFT_FROM,
+  };
+  // Origins whose landing square starts another jump, moved back to the origin
+  Bitboard go_on[4] = {
+    bb_shl(can[0] | can[1] | can[3], 2 * BOARD_SIZE),
+    bb_shr(can[0] | can[1] | can[2], 2),
+    bb_shr(can[1] | can[2] | can[3], 2 * BOARD_SIZE),
+    bb_shl(can[0] | can[2] | can[3], 2),
+  };
+
+  for (int dir = 0; dir < 4; dir++) {
+    Bitboard jumps = own & can[dir];
+    final[dir] = jumps & ~go_on[dir];
+    cont[dir] = jumps & go_on[dir];
+  }
+}
+
+// Sequences starting with the first jumps in cont[dir] (count_chains from each landing)
+static int KERNEL(count_continuations)(const Bitboard *cont, Bitboard opp, Bitboard empty) {
+  int total = 0;
+
+  for (int dir = 0; dir < 4; dir++) {
+    Bitboard from = cont[dir];
+    while (bb_any(from)) {
+      int idx = KERNEL(pop_lsb)(&from);
+      int over = idx + dir_step[dir], land = idx + 2 * dir_step[dir];
+      total += KERNEL(count_chains)(land, opp & ~BB_BIT(over),
+                                    (empty | BB_BIT(idx) | BB_BIT(over)) & ~BB_BIT(land), 1);
+    }
+  }
+
+  return total;
+}
+
+/* Batches over arrays of boards, each with its own side to move. The AVX2
+   copy works on four boards per step, one per 64-bit lane (boards up to
+   8x8): jump origins, first jumps and the count of moves that are a single
+   jump all stay in registers, and only jumps that can go on are counted
+   board by board. The other variants, and wider boards, use the same
+   split one board at a time. */
+#if defined(__AVX2__) && !BITBOARD_WIDE
+// Colours of boards[0..3], one board per lane, and the side to move's view of them
+static inline void KERNEL(load4)(const Board *boards, const bool *is_white_turn,
+                                 __m256i *own, __m256i *opp, __m256i *empty) {
+  /* Two loads give w0 b0 w1 b1 / w2 b2 w3 b3; unpack and reorder them
+     into one register per colour */
+  __m256i lo = _mm256_loadu_si256((const __m256i *)&boards[0]);
+  __m256i hi = _mm256_loadu_si256((const __m256i *)&boards[2]);
+  __m256i white = _mm256_permute4x64_epi64(_mm256_unpacklo_epi64(lo, hi), 0xD8);
+  __m256i black = _mm256_permute4x64_epi64(_mm256_unpackhi_epi64(lo, hi), 0xD8);
+  __m256i side = _mm256_set_epi64x(-(long long)is_white_turn[3], -(long long)is_white_turn[2],
+                                   -(long long)is_white_turn[1], -(long long)is_white_turn[0]);
+
+  *own = _mm256_blendv_epi8(black, white, side);
+  *opp = _mm256_blendv_epi8(white, black, side);
+  *empty = _mm256_andnot_si256(_mm256_or_si256(white, black),
+                               _mm256_set1_epi64x((long long)VALID_MASK));
+}
+
+// can[] of first_jumps for four boards
+static inline void KERNEL(can_jump4)(__m256i opp, __m256i empty, __m256i *can) {
+  can[0] = _mm256_and_si256(_mm256_slli_epi64(opp, BOARD_SIZE),
+                            _mm256_slli_epi64(empty, 2 * BOARD_SIZE));
+  can[1] = _mm256_and_si256(_mm256_and_si256(_mm256_srli_epi64(opp, 1), _mm256_srli_epi64(empty, 2)),
+                            _mm256_set1_epi64x((long long)JUMP_RIGHT_FROM));
+  can[2] = _mm256_and_si256(_mm256_srli_epi64(opp, BOARD_SIZE),
+                            _mm256_srli_epi64(empty, 2 * BOARD_SIZE));
+  can[3] = _mm256_and_si256(_mm256_and_si256(_mm256_slli_epi64(opp, 1), _mm256_slli_epi64(empty, 2)),
+                            _mm256_set1_epi64x((long long)JUMP_LEFT_FROM));
+}
+
+// Bits set per byte (nibble table lookup; AVX2 has no vector popcount)
+static inline __m256i KERNEL(byte_counts)(__m256i v) {
+  const __m256i table = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                         0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+  const __m256i nibble = _mm256_set1_epi8(0x0F);
+  return _mm256_add_epi8(_mm256_shuffle_epi8(table, _mm256_and_si256(v, nibble)),
+                         _mm256_shuffle_epi8(table, _mm256_and_si256(_mm256_srli_epi16(v, 4), nibble)));
+}
+#endif
+
+static void KERNEL(jump_origins_batch)(const Board *boards, const bool *is_white_turn,
+                                       int n, Bitboard *origins) {
+  int i = 0;
+
+#if defined(__AVX2__) && !BITBOARD_WIDE
+  for (; i + 4 <= n; i += 4) {
+    __m256i own, opp, empty, can[4];
+    KERNEL(load4)(&boards[i], &is_white_turn[i], &own, &opp, &empty);
+    KERNEL(can_jump4)(opp, empty, can);
+
+    __m256i any = _mm256_or_si256(_mm256_or_si256(can[0], can[1]), _mm256_or_si256(can[2], can[3]));
+    _mm256_storeu_si256((__m256i *)&origins[i], _mm256_and_si256(own, any));
+  }
+#endif
+
+  for (; i < n; i++) {
+    Bitboard own = is_white_turn[i] ? boards[i].white : boards[i].black;
+    Bitboard opp = is_white_turn[i] ? boards[i].black : boards[i].white;
+    origins[i] = KERNEL(jumping_stones)(own, opp, board_empty(&boards[i]));
+  }
+}
+
+static void KERNEL(count_all_moves_batch)(const Board *boards, const bool *is_white_turn,
+                                          int n, int *counts) {
+  int i = 0;
+
+#if defined(__AVX2__) && !BITBOARD_WIDE
+  for (; i + 4 <= n; i += 4) {
+    __m256i own, opp, empty, can[4];
+    KERNEL(load4)(&boards[i], &is_white_turn[i], &own, &opp, &empty);
+    KERNEL(can_jump4)(opp, empty, can);
+
+    __m256i go_on[4] = {
+      _mm256_slli_epi64(_mm256_or_si256(_mm256_or_si256(can[0], can[1]), can[3]), 2 * BOARD_SIZE),
+      _mm256_srli_epi64(_mm256_or_si256(_mm256_or_si256(can[0], can[1]), can[2]), 2),
+      _mm256_srli_epi64(_mm256_or_si256(_mm256_or_si256(can[1], can[2]), can[3]), 2 * BOARD_SIZE),
+      _mm256_slli_epi64(_mm256_or_si256(_mm256_or_si256(can[0], can[2]), can[3]), 2),
+    };
+
+    /* Single-jump moves: per-byte counts of the four final sets (at most
+       32 per byte), summed per lane */
+    __m256i bytes = _mm256_setzero_si256();
+    Bitboard cont[4][4];
+    for (int dir = 0; dir < 4; dir++) {
+      __m256i jumps = _mm256_and_si256(own, can[dir]);
+      bytes = _mm256_add_epi8(bytes, KERNEL(byte_counts)(_mm256_andnot_si256(go_on[dir], jumps)));
+      _mm256_storeu_si256((__m256i *)cont[dir], _mm256_and_si256(jumps, go_on[dir]));
+    }
+
+    Bitboard singles[4];
+    _mm256_storeu_si256((__m256i *)singles, _mm256_sad_epu8(bytes, _mm256_setzero_si256()));
+
+    for (int lane = 0; lane < 4; lane++) {
+      const Board *b = &boards[i + lane];
+      Bitboard lane_cont[4] = { cont[0][lane], cont[1][lane], cont[2][lane], cont[3][lane] };
+      counts[i + lane] = (int)singles[lane];
+      if (lane_cont[0] | lane_cont[1] | lane_cont[2] | lane_cont[3]) {
+        counts[i + lane] += KERNEL(count_continuations)(
+          lane_cont, is_white_turn[i + lane] ? b->black : b->white, board_empty(b));
+      }
+    }
+  }
+#endif
+
+  for (; i < n; i++) {
+    Bitboard own = is_white_turn[i] ? boards[i].white : boards[i].black;
+    Bitboard opp = is_white_turn[i] ? boards[i].black : boards[i].white;
+    Bitboard empty = board_empty(&boards[i]);
+    Bitboard final[4], cont[4];
+
+    KERNEL(first_jumps)(own, opp, empty, final, cont);
+    counts[i] = KERNEL(bb_count)(final[0]) + KERNEL(bb_count)(final[1]) +
+                KERNEL(bb_count)(final[2]) + KERNEL(bb_count)(final[3]) +
+                KERNEL(count_continuations)(cont, opp, empty);
+  }
+}
+
+/* Single jumps available to `own` (one per stone and direction), and own
+   stones with no own stone orthogonally next to them */
+static inline int KERNEL(jump_potential)(Bitboard own, Bitboard opp, Bitboard empty) {
+  return KERNEL(bb_count)(own & bb_shl(opp, BOARD_SIZE) & bb_shl(empty, 2 * BOARD_SIZE)) +
+         KERNEL(bb_count)(own & bb_shr(opp, BOARD_SIZE) & bb_shr(empty, 2 * BOARD_SIZE)) +
+         KERNEL(bb_count)(own & bb_shr(opp, 1) & bb_shr(empty, 2) & JUMP_RIGHT_FROM) +
+         KERNEL(bb_count)(own & bb_shl(opp, 1) & bb_shl(empty, 2) & JUMP_LEFT_FROM);
+}
+
+static inline int KERNEL(isolated)(Bitboard own) {
+  Bitboard neighbours = bb_shl(own, BOARD_SIZE) | bb_shr(own, BOARD_SIZE) |
+                        bb_shl(own & ~COL_LAST, 1) | bb_shr(own & ~COL_FIRST, 1);
+  return KERNEL(bb_count)(own & ~neighbours);
+}
+
+/* The terms of the original square-by-square evaluation, computed with
+   shifts and population counts; false when a side has no move left */
+static bool KERNEL(eval_terms)(const Board *board, int *terms) {
+  int white_mob = KERNEL(count_all_moves)(board, true);
+  int black_mob = KERNEL(count_all_moves)(board, false);
+  Bitboard white = board->white, black = board->black;
+  Bitboard empty = board_empty(board);
+
+  terms[EVAL_MOBILITY] = white_mob - black_mob;
+  terms[EVAL_MATERIAL] = KERNEL(bb_count)(white) - KERNEL(bb_count)(black);
+  terms[EVAL_CORNER] = KERNEL(bb_count)(white & CORNER_MASK) - KERNEL(bb_count)(black & CORNER_MASK);
+  terms[EVAL_EDGE] = KERNEL(bb_count)(white & EDGE_MASK) - KERNEL(bb_count)(black & EDGE_MASK);
+  terms[EVAL_JUMP_POTENTIAL] = KERNEL(jump_potential)(white, black, empty) -
+                               KERNEL(jump_potential)(black, white, empty);
+  terms[EVAL_ISOLATION] = KERNEL(isolated)(white) - KERNEL(isolated)(black);
+
+  return !((white_mob == 0 && black_mob > 0) || (black_mob == 0 && white_mob > 0));
+}
+
+// Weighted sum of the terms, with the endgame scores
+static int KERNEL(eval_position)(const Board *board, bool player_is_white) {
+  int terms[EVAL_NUM_TERMS];
+
+  // Endgame
+  if (!KERNEL(eval_terms)(board, terms)) {
+    bool white_stuck = terms[EVAL_MOBILITY] < 0;
+    return player_is_white == white_stuck ? -SCORE_STUCK : SCORE_STUCK;
+  }
+
+  int score = 0;
+  for (int t = 0; t < EVAL_NUM_TERMS; t++) score += terms[t] * eval_weights[t];
+  return player_is_white ? score : -score;
+}
+
+// eval_position's score from its terms, with the side counts already known
+static inline int KERNEL(eval_score)(int white_mob, int black_mob, int rest, bool player_is_white) {
+  if (white_mob == 0 && black_mob > 0) return player_is_white ? -SCORE_STUCK : SCORE_STUCK;
+  if (black_mob == 0 && white_mob > 0) return player_is_white ? SCORE_STUCK : -SCORE_STUCK;
+
+  int score = (white_mob - black_mob) * eval_weights[EVAL_MOBILITY] + rest;
+  return player_is_white ? score : -score;
+}
+
+/* eval_position over an array of boards, with identical scores. Both
+   sides' first jumps give the jump potential and, with the split from
+   first_jumps, most of the mobility; the AVX2 copy computes them and every
+   other term for four boards at once, as one register per colour (a
+   structure-of-arrays view of the four boards), leaving only continuing
+   jumps and the final sums to each board. */
+static void KERNEL(eval_batch)(const Board *boards, int n, const bool *player_is_white,
+                               int *scores) {
+  int i = 0;
+
+#if defined(__AVX2__) && !BITBOARD_WIDE
+  const bool white_side[4] = { true, true, true, true };
+  const __m256i zero = _mm256_setzero_si256();
+  __m256i weight[EVAL_NUM_TERMS];
+  for (int t = 0; t < EVAL_NUM_TERMS; t++) weight[t] = _mm256_set1_epi64x(eval_weights[t]);
+
+  for (; i + 4 <= n; i += 4) {
+    __m256i colour[2], opp[2], empty;   // [0] white, [1] black
+    KERNEL(load4)(&boards[i], white_side, &colour[0], &colour[1], &empty);
+    opp[0] = colour[1];
+    opp[1] = colour[0];
+
+    __m256i singles[2], potential[2];
+    Bitboard cont[2][4][4];
+
+    for (int side = 0; side < 2; side++) {
+      __m256i can[4];
+      KERNEL(can_jump4)(opp[side], empty, can);
+
+      __m256i go_on[4] = {
+        _mm256_slli_epi64(_mm256_or_si256(_mm256_or_si256(can[0], can[1]), can[3]), 2 * BOARD_SIZE),
+        _mm256_srli_epi64(_mm256_or_si256(_mm256_or_si256(can[0], can[1]), can[2]), 2),
+        _mm256_srli_epi64(_mm256_or_si256(_mm256_or_si256(can[1], can[2]), can[3]), 2 * BOARD_SIZE),
+        _mm256_slli_epi64(_mm256_or_si256(_mm256_or_si256(can[0], can[2]), can[3]), 2),
+      };
+
+      __m256i final_bytes = zero, cont_bytes = zero;
+      for (int dir = 0; dir < 4; dir++) {
+        __m256i jumps = _mm256_and_si256(colour[side], can[dir]);
+        __m256i going = _mm256_and_si256(jumps, go_on[dir]);
+        final_bytes = _mm256_add_epi8(final_bytes, KERNEL(byte_counts)(_mm256_andnot_si256(go_on[dir], jumps)));
+        cont_bytes = _mm256_add_epi8(cont_bytes, KERNEL(byte_counts)(going));
+        _mm256_storeu_si256((__m256i *)cont[side][dir], going);
+      }
+
+      singles[side] = _mm256_sad_epu8(final_bytes, zero);
+      potential[side] = _mm256_add_epi64(singles[side], _mm256_sad_epu8(cont_bytes, zero));
+    }
+
+    /* Material, corners, edges and isolated stones, per colour */
+    __m256i terms[2];
+    for (int side = 0; side < 2; side++) {
+      __m256i own = colour[side];
+      __m256i neighbours = _mm256_or_si256(
+        _mm256_or_si256(_mm256_slli_epi64(own, BOARD_SIZE), _mm256_srli_epi64(own, BOARD_SIZE)),
+        _mm256_or_si256(
+          _mm256_slli_epi64(_mm256_andnot_si256(_mm256_set1_epi64x((long long)COL_LAST), own), 1),
+          _mm256_srli_epi64(_mm256_andnot_si256(_mm256_set1_epi64x((long long)COL_FIRST), own), 1)));
+
+      __m256i material = _mm256_sad_epu8(KERNEL(byte_counts)(own), zero);
+      __m256i corners = _mm256_sad_epu8(KERNEL(byte_counts)(
+        _mm256_and_si256(own, _mm256_set1_epi64x((long long)CORNER_MASK))), zero);
+      __m256i edges = _mm256_sad_epu8(KERNEL(byte_counts)(
+        _mm256_and_si256(own, _mm256_set1_epi64x((long long)EDGE_MASK))), zero);
+      __m256i isolated = _mm256_sad_epu8(KERNEL(byte_counts)(_mm256_andnot_si256(neighbours, own)), zero);
+
+      /* Counts are small, so the 32-bit multiply of each lane's low half is exact */
+      __m256i sum = _mm256_mul_epi32(material, weight[EVAL_MATERIAL]);
+      sum = _mm256_add_epi64(sum, _mm256_mul_epi32(corners, weight[EVAL_CORNER]));
+      sum = _mm256_add_epi64(sum, _mm256_mul_epi32(edges, weight[EVAL_EDGE]));
+      sum = _mm256_add_epi64(sum, _mm256_mul_epi32(potential[side], weight[EVAL_JUMP_POTENTIAL]));
+      terms[side] = _mm256_add_epi64(sum, _mm256_mul_epi32(isolated, weight[EVAL_ISOLATION]));
+    }
+
+    int64_t rest[4];
+    uint64_t white_singles[4], black_singles[4];
+    _mm256_storeu_si256((__m256i *)rest, _mm256_sub_epi64(terms[0], terms[1]));
+    _mm256_storeu_si256((__m256i *)white_singles, singles[0]);
+    _mm256_storeu_si256((__m256i *)black_singles, singles[1]);
+
+    for (int lane = 0; lane < 4; lane++) {
+      const Board *b = &boards[i + lane];
+      Bitboard lane_empty = board_empty(b);
+      Bitboard white_cont[4] = { cont[0][0][lane], cont[0][1][lane], cont[0][2][lane], cont[0][3][lane] };
+      Bitboard black_cont[4] = { cont[1][0][lane], cont[1][1][lane], cont[1][2][lane], cont[1][3][lane] };
+
+      int white_mob = (int)white_singles[lane] + KERNEL(count_continuations)(white_cont, b->black, lane_empty);
+      int black_mob = (int)black_singles[lane] + KERNEL(count_continuations)(black_cont, b->white, lane_empty);
+      scores[i + lane] = KERNEL(eval_score)(white_mob, black_mob, (int)rest[lane],
+                                            player_is_white[i + lane]);
+    }
+  }
+#endif
+
+  for (; i < n; i++) {
+    Bitboard white = boards[i].white, black = boards[i].black;
+    Bitboard empty = board_empty(&boards[i]);
+    Bitboard final[2][4], cont[2][4];
+    int mob[2], potential[2];
+
+    KERNEL(first_jumps)(white, black, empty, final[0], cont[0]);
+    KERNEL(first_jumps)(black, white, empty, final[1], cont[1]);
+
+    for (int side = 0; side < 2; side++) {
+      int singles = 0, going = 0;
+      for (int dir = 0; dir < 4; dir++) {
+        singles += KERNEL(bb_count)(final[side][dir]);
+        going += KERNEL(bb_count)(cont[side][dir]);
+      }
+      potential[side] = singles + going;
+      mob[side] = singles + KERNEL(count_continuations)(cont[side], side ? white : black, empty);
+    }
+
+    int rest = (KERNEL(bb_count)(white) - KERNEL(bb_count)(black)) * eval_weights[EVAL_MATERIAL];
+    rest += (KERNEL(bb_count)(white & CORNER_MASK) -
+             KERNEL(bb_count)(black & CORNER_MASK)) * eval_weights[EVAL_CORNER];
+    rest += (KERNEL(bb_count)(white & EDGE_MASK) -
+             KERNEL(bb_count)(black & EDGE_MASK)) * eval_weights[EVAL_EDGE];
+    rest += (potential[0] - potential[1]) * eval_weights[EVAL_JUMP_POTENTIAL];
+    rest += (KERNEL(isolated)(white) - KERNEL(isolated)(black)) * eval_weights[EVAL_ISOLATION];
+
+    scores[i] = KERNEL(eval_score)(mob[0], mob[1], rest, player_is_white[i]);
+  }
+}
+
+/* NNUE accumulator after a move: per perspective, the moving stone's
+   feature leaves its first square and enters its last, and every captured
+   stone's feature leaves. The AVX2 copy keeps each perspective's 64
+   entries in four registers while it adds the rows. */
+static void KERNEL(nnue_update)(const Nnue *net, const NnueAccumulator *in, NnueAccumulator *out,
+                                const MoveSequence *seq, bool white_moved) {
+  for (int p = 0; p < 2; p++) {
+    int mover = (p == 0) == white_moved ? 0 : TOTAL_CELLS;   // feature base of each colour
+    int other = TOTAL_CELLS - mover;
+    const int16_t *sub[MAX_MOVES + 1];
+    const int16_t *add = NULL;
+    int num_sub = 0;
+
+    if (seq->count > 0 && IS_INITIAL_REMOVAL(seq->jumps[0])) {
+      sub[num_sub++] = net->ft_weights[mover + INITIAL_REMOVAL_POS(seq->jumps[0])];
+    } else if (seq->count > 0) {
+      sub[num_sub++] = net->ft_weights[mover + MOVE_FROM(seq->jumps[0])];
+      add = net->ft_weights[mover + MOVE_TO(seq->jumps[seq->count - 1])];
+      for (int j = 0; j < seq->count; j++)
+        sub[num_sub++] = net->ft_weights[other + MOVE_CAPTURED(seq->jumps[j])];
+    }
+
+#ifdef __AVX2__
+    __m256i v[NNUE_HIDDEN / 16];
+    for (int k = 0; k < NNUE_HIDDEN / 16; k++) {
+      v[k] = _mm256_loadu_si256((const __m256i *)&in->v[p][16 * k]);
+      if (add) v[k] = _mm256_add_epi16(v[k], _mm256_loadu_si256((const __m256i *)&add[16 * k]));
+      for (int s = 0; s < num_sub; s++)
+        v[k] = _mm256_sub_epi16(v[k], _mm256_loadu_si256((const __m256i *)&sub[s][16 * k]));
+    }
+    for (int k = 0; k < NNUE_HIDDEN / 16; k++)
+      _mm256_storeu_si256((__m256i *)&out->v[p][16 * k], v[k]);
+#else
+    int16_t v[NNUE_HIDDEN];
+    for (int k = 0; k < NNUE_HIDDEN; k++) {
+      v[k] = in->v[p][k] + (add ? add[k] : 0);
+      for (int s = 0; s < num_sub; s++) v[k] -= sub[s][k];
+    }
+    memcpy(out->v[p], v, sizeof(v));
+#endif
+  }
+}
+
+/* NNUE layers after the accumulator, from the side to move: both views
+   clipped to 0..127 as bytes (side to move first), layer 1 as byte
+   products (maddubs) summed in 32 bits, the small output layer in scalar
+   code. */
+static int KERNEL(nnue_output)(const Nnue *net, const NnueAccumulator *acc, bool white_to_move) {
+  const int16_t *views[2] = { acc->v[!white_to_move], acc->v[white_to_move] };
+  int32_t hidden[NNUE_L1];
+
+#ifdef __AVX2__
+  __m256i in[NNUE_HIDDEN / 16];   // 32 clipped entries per register
+  for (int h = 0; h < 2; h++) {
+    for (int k = 0; k < NNUE_HIDDEN / 32; k++) {
+      __m256i lo = _mm256_loadu_si256((const __m256i *)&views[h][32 * k]);
+      __m256i hi = _mm256_loadu_si256((const __m256i *)&views[h][32 * k + 16]);
+      /* packs works per 128-bit lane; the permute restores the order */
+      __m256i bytes = _mm256_permute4x64_epi64(_mm256_packs_epi16(lo, hi), 0xD8);
+      in[h * (NNUE_HIDDEN / 32) + k] = _mm256_max_epi8(bytes, _mm256_setzero_si256());
+    }
+  }
+
+  const __m256i ones = _mm256_set1_epi16(1);
+  for (int j = 0; j < NNUE_L1; j++) {
+    __m256i sum = _mm256_setzero_si256();
+    for (int k = 0; k < NNUE_HIDDEN / 16; k++) {
+      __m256i w = _mm256_loadu_si256((const __m256i *)&net->l1_weights[j][32 * k]);
+      sum = _mm256_add_epi32(sum, _mm256_madd_epi16(_mm256_maddubs_epi16(in[k], w), ones));
+    }
+    __m128i s = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0x4E));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0xB1));
+    hidden[j] = _mm_cvtsi128_si32(s);
+  }
+#else
+  uint8_t in[2 * NNUE_HIDDEN];
+  for (int h = 0; h < 2; h++)
+    for (int k = 0; k < NNUE_HIDDEN; k++) {
+      int x = views[h][k];
+      in[h * NNUE_HIDDEN + k] = (uint8_t)(x < 0 ? 0 : x > 127 ? 127 : x);
+    }
+
+  for (int j = 0; j < NNUE_L1; j++) {
+    int32_t sum = 0;
+    for (int k = 0; k < 2 * NNUE_HIDDEN; k++) sum += in[k] * net->l1_weights[j][k];
+    hidden[j] = sum;
+  }
+#endif
+
+  int32_t out = net->out_bias;
+  for (int j = 0; j < NNUE_L1; j++) {
+    int32_t x = (hidden[j] + net->l1_bias[j]) >> NNUE_L1_SHIFT;
+    out += (x < 0 ? 0 : x > 127 ? 127 : x) * net->out_weights[j];
+  }
+  return out >> NNUE_OUT_SHIFT;
+}
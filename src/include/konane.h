@@ -0,0 +1,109 @@
+#ifndef __KONANE_H__
+#define __KONANE_H__
+
+/*
+  libkonane: the Konane engine as a library (libkonane.a / libkonane.so).
+  Nothing here prints or touches global state: everything lives in the
+  positions and engines the caller creates, so separate engines can be
+  used from separate threads at the same time. Squares are numbered
+  row * KONANE_BOARD_SIZE + col with A1 = 0. The library is built for one
+  board size: define KONANE_BOARD_SIZE to match a build made with
+  -DBOARD_SIZE=N (7 by default).
+*/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define KONANE_VERSION "1.0"
+
+#ifndef KONANE_BOARD_SIZE
+#define KONANE_BOARD_SIZE 7
+#endif
+#define KONANE_SQUARES (KONANE_BOARD_SIZE * KONANE_BOARD_SIZE)
+#define KONANE_MAX_JUMPS (KONANE_SQUARES / 2 > 32 ? KONANE_SQUARES / 2 : 32)   // per move
+#define KONANE_MAX_MOVES (KONANE_SQUARES <= 64 ? 256 : KONANE_SQUARES <= 128 ? 1024 : 4096)  // legal moves in one position
+#define KONANE_TEXT_MAX (KONANE_SQUARES + 2 * KONANE_BOARD_SIZE + 1)  // position text, with the terminator
+#define KONANE_MOVE_TEXT_MAX (4 * (KONANE_MAX_JUMPS + 1))
+
+// One bit per square: a 64-bit word up to 8x8, 128 bits up to 11x11
+#if KONANE_SQUARES <= 64
+typedef uint64_t KonaneBitboard;
+#elif KONANE_SQUARES <= 128
+typedef unsigned __int128 KonaneBitboard;
+#else
+typedef struct {
+  uint64_t words[4];    // squares 0-63 first
+} KonaneBitboard;
+#endif
+
+typedef struct {
+  KonaneBitboard white;
+  KonaneBitboard black;
+  bool white_to_move;   // during the removals: whose removal it is
+} KonanePosition;
+
+typedef struct {
+  int num_jumps;
+  uint8_t squares[KONANE_MAX_JUMPS + 1]; // start square, then each landing
+} KonaneMove;
+
+typedef struct {
+  int depth;            // 0 = no limit
+  int movetime_ms;      // 0 = no limit
+  uint64_t nodes;       // 0 = no limit
+} KonaneLimits;
+
+typedef struct {
+  KonaneMove best;
+  bool has_move;
+  int score;            // from the side to move
+  int depth;            // last completed iteration
+  uint64_t nodes;
+  double seconds;
+  uint64_t hash_probes;
+  uint64_t hash_hits;
+} KonaneResult;
+
+typedef struct KonaneEngine KonaneEngine;
+
+const char *konane_version(void);
+
+/* ---- Positions ---- */
+
+// Full board, Black to make the first removal
+void konane_start_position(KonanePosition *pos);
+// Opening removal by the side to move (Black: corner or centre, White: next to it)
+bool konane_remove_stone(KonanePosition *pos, int square);
+// One-line notation, e.g. "BWBWBWB/WBWBWBW/BWBWBWB/WB2WBW/BWBWBWB/WBWBWBW/BWBWBWB b"
+bool konane_position_from_text(const char *text, KonanePosition *pos);
+void konane_position_to_text(const KonanePosition *pos, char *buf);
+
+/* ---- Moves ---- */
+
+/* Legal moves (up to KONANE_MAX_MOVES); 0 means the side to move has
+   lost, -1 that it has more moves than that (moves is then unspecified) */
+int konane_generate_moves(const KonanePosition *pos, KonaneMove *moves);
+int konane_count_moves(const KonanePosition *pos);
+// Play a move; false (position unchanged) if it is not legal or the moves do not fit a list
+bool konane_play_move(KonanePosition *pos, const KonaneMove *move);
+// "B3-D3-D5" form; parsing checks the move against the legal moves
+void konane_move_to_text(const KonaneMove *move, char *buf);
+bool konane_move_from_text(const KonanePosition *pos, const char *text, KonaneMove *move);
+// Leaf count of the move tree to the given depth; 0 if a position on the way has too many moves
+uint64_t konane_perft(const KonanePosition *pos, int depth);
+
+/* ---- Search ---- */
+
+KonaneEngine *konane_engine_new(size_t hash_mb);
+void konane_engine_free(KonaneEngine *engine);
+// Forget the hash table and move ordering (before an unrelated position)
+void konane_engine_reset(KonaneEngine *engine);
+// Iterative deepening within limits; false if there is no legal move or too many to list
+bool konane_search(KonaneEngine *engine, const KonanePosition *pos,
+                   const KonaneLimits *limits, KonaneResult *result);
+/* Ask a running konane_search to return its best move so far (any thread);
+   a stop that arrives before the search starts ends that search at once */
+void konane_stop(KonaneEngine *engine);
+
+#endif
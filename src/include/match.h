@@ -0,0 +1,59 @@
+#ifndef __MATCH_H__
+#define __MATCH_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "game.h"
+
+/* Headless engine-vs-engine matches. Games are played concurrently on the
+   thread pool (pool.h), each worker with its own engines. Games come in
+   pairs that share a random opening (removals plus a few random plies)
+   with colours swapped, so neither player profits from a lopsided start. */
+
+#define MATCH_DEF_GAMES 1000
+#define MATCH_DEF_RANDOM_PLIES 4
+#define MATCH_DEF_HASH_MB 16
+
+typedef struct {
+  PlayerType type;      // PLAYER_TYPE_AI_NEGAMAX, _MCTS or _RANDOM
+  int depth;            // negamax depth limit (0 = none)
+  int movetime_ms;      // per move (0 = none)
+  uint64_t playouts;    // MCTS playouts per move (0 = until movetime)
+  size_t hash_mb;       // negamax hash table per worker
+} MatchPlayer;
+
+typedef struct {
+  MatchPlayer players[2];
+  int games;
+  int threads;          // 0 = one per online CPU
+  int random_plies;     // random moves after the random removals
+  uint64_t seed;
+  bool progress;        // print a line every 10% of the games
+  const char *record_path; // append every game to this archive (NULL = off)
+} MatchConfig;
+
+typedef struct {
+  int games;
+  int wins[2];          // per player
+  int wins_as_black[2];
+  uint64_t plies;
+  int recorded;         // games appended to the archive
+  double score;         // player 0's share of the points
+  double elo;           // player 0 relative to player 1
+  double elo_error;     // 95% confidence half-width
+  double seconds;
+} MatchResult;
+
+// Defaults: 1000 games, negamax depth 5 against itself
+MatchConfig match_default_config(void);
+
+// Parse "negamax[:depth=D][:ms=T]", "mcts[:playouts=N][:ms=T]" or "random"
+bool match_parse_player(const char *text, MatchPlayer *player);
+// Describe a player in the same syntax
+void match_player_name(const MatchPlayer *player, char *buf, size_t len);
+
+// Play the match; false if nothing could be played
+bool match_run(const MatchConfig *config, MatchResult *result);
+void print_match_result(const MatchConfig *config, const MatchResult *result);
+
+#endif
@@ -0,0 +1,68 @@
+#ifndef __MCTS_H__
+#define __MCTS_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "board.h"
+#include "move.h"
+#include "pool.h"
+
+/* Monte Carlo Tree Search (UCT) with random playouts. Several threads
+   share one tree (tree parallelism); a virtual loss on the path being
+   explored steers the other threads elsewhere; the searching thread is
+   joined by the workers of a pool kept for the tree's lifetime. The tree is
+   kept between moves and re-rooted at the new position when it is found in it. */
+
+#define MCTS_DEF_EXPLORATION 1.4
+#define MCTS_DEF_PLAYOUTS 20000
+#define MCTS_DEF_NODES (1u << 21)
+#define MCTS_VIRTUAL_LOSS 1
+
+typedef struct {
+  double exploration;  // UCT constant C
+  int threads;         // 0 = one per online CPU
+  uint64_t playouts;   // per move (0 = until movetime)
+  int movetime_ms;     // per move (0 = until playouts)
+  uint32_t max_nodes;  // tree capacity
+} MctsConfig;
+
+typedef struct {
+  MoveSequence best;
+  uint64_t playouts;   // this search
+  uint64_t reused;     // visits inherited from the previous tree
+  double win_rate;     // of the best move, for the side to move
+  double seconds;
+  bool has_move;
+} MctsResult;
+
+typedef struct MctsNode MctsNode;
+
+typedef struct {
+  MctsConfig config;
+  MctsNode *nodes;
+  uint64_t used;       // allocated nodes (atomic)
+  uint32_t root;
+  Board root_board;
+  bool root_white;
+  bool has_root;
+  uint64_t playouts;   // this search (atomic)
+  int stop;            // set to end the search early
+  double deadline;
+  Pool *pool;          // threads - 1 helpers (NULL with one thread)
+} Mcts;
+
+// Default configuration
+MctsConfig mcts_default_config(void);
+
+// Create / free a search tree
+Mcts *mcts_create(const MctsConfig *config);
+void mcts_free(Mcts *mcts);
+// Drop the tree so the next search starts from scratch
+void mcts_new_game(Mcts *mcts);
+
+// Search a position, reusing the tree when the position is found in it; false with
+// no move or more than MAX_SEQUENCES
+bool mcts_search(Mcts *mcts, const Board *board, bool is_white_turn, MctsResult *result);
+
+#endif
@@ -8,39 +8,59 @@
 
 /*
   Move encoding (single jump):
-  bits  0–6   : from position
-  bits  7–13  : to position
-  bits 14–20  : captured position
-  bits 21–22  : jump count (unused for sequences)
-  bits 23–24  : direction (0=up,1=right,2=down,3=left)
+  bits  0–7   : from position
+  bits  8–15  : to position
+  bits 16–23  : captured position
+  bits 24–25  : jump count (unused for sequences)
+  bits 26–27  : direction (0=up,1=right,2=down,3=left)
 */
 
 typedef uint32_t Move;
 
 // Encode a move
 #define MOVE_ENCODE(from, to, captured, jump_count, dir) \
-  ((Move)((from) | ((to) << 7) | ((captured) << 14) | \
-          ((jump_count) << 21) | ((dir) << 23)))
+  ((Move)((from) | ((to) << 8) | ((captured) << 16) | \
+          ((jump_count) << 24) | ((dir) << 26)))
 
 // Extract information from a move
-#define MOVE_FROM(move)       ((move) & 0x7F)
-#define MOVE_TO(move)         (((move) >> 7) & 0x7F)
-#define MOVE_CAPTURED(move)   (((move) >> 14) & 0x7F)
-#define MOVE_JUMP_COUNT(move) (((move) >> 21) & 0x3)
-#define MOVE_DIRECTION(move)  (((move) >> 23) & 0x3)
+#define MOVE_FROM(move)       ((move) & 0xFF)
+#define MOVE_TO(move)         (((move) >> 8) & 0xFF)
+#define MOVE_CAPTURED(move)   (((move) >> 16) & 0xFF)
+#define MOVE_JUMP_COUNT(move) (((move) >> 24) & 0x3)
+#define MOVE_DIRECTION(move)  (((move) >> 26) & 0x3)
 
 #define MOVE_INITIAL_REMOVAL_ENCODE(pos) (0x80000000 | (pos))
 #define IS_INITIAL_REMOVAL(move)         ((move) & 0x80000000)
-#define INITIAL_REMOVAL_POS(move)        ((move) & 0x7F)
+#define INITIAL_REMOVAL_POS(move)        ((move) & 0xFF)
 
-#define MAX_MOVES 32
-#define MAX_SEQUENCES 256
+/* Jumps in one move. Every jump takes a different enemy stone, and from
+   a given start only the squares one parity step off it can be jumped
+   (at most TOTAL_CELLS / 2 of them), so no chain is longer than this. */
+#define MAX_MOVES (TOTAL_CELLS / 2 > 32 ? TOTAL_CELLS / 2 : 32)
+/* Legal moves kept per position. Chains may turn, so lattices of stones
+   can have more, even on 7x7; generate_all_moves then returns -1 and the
+   caller has to treat the position as one it cannot list. */
+#define MAX_SEQUENCES (TOTAL_CELLS <= 64 ? 256 : TOTAL_CELLS <= 128 ? 1024 : 4096)
 
 typedef struct {
   int count;
   Move jumps[MAX_MOVES];
 } MoveSequence;
 
+/*
+  Packed sequence (MoveKey), a compact identity for a whole sequence:
+  bits  0–7   : from position
+  bits  8–12  : jump count (31 for 31 jumps or more)
+  bits 13–30  : direction of each of the first 9 jumps (2 bits each)
+  Longer chains keep only their first 9 directions and must be resolved
+  against the generated move list.
+*/
+typedef uint32_t MoveKey;
+
+#define MOVE_KEY_MAX_DIRS 9
+#define MOVE_KEY_FROM(key)  ((key) & 0xFF)
+#define MOVE_KEY_COUNT(key) (((key) >> 8) & 0x1F)
+
 // Encode and return simple move
 Move create_simple_jump(int from_row, int from_col,
                         int to_row, int to_col,
@@ -50,15 +70,35 @@ Move create_simple_jump(int from_row, int from_col,
 // Encode and return initial removal
 Move create_initial_removal(int row, int col);
 
-// Generate list of all valid moves for a player
+// Generate list of all valid moves for a player; -1 if there are more than MAX_SEQUENCES
 int generate_all_moves(const Board *board,
                        bool is_white_turn,
                        MoveSequence *out_moves);
 
+// Number of legal sequences, without generating them
+int count_all_moves(const Board *board, bool is_white_turn);
+
+/* Batches of independent boards, each with its own side to move: the
+   stones that can jump, and the legal sequence counts (AVX2 handles four
+   boards per step) */
+void jump_origins_batch(const Board *boards, const bool *is_white_turn,
+                        int n, Bitboard *origins);
+void count_all_moves_batch(const Board *boards, const bool *is_white_turn,
+                           int n, int *counts);
+
+// Uniformly random legal sequence (same distribution as picking from
+// generate_all_moves); false if there is none
+bool sample_random_move(const Board *board, bool is_white_turn,
+                        uint64_t *rng, MoveSequence *out);
+
+// Write a sequence as its squares joined by '-', e.g. "B3-D3-D5"
+#define MOVE_TEXT_MAX (4 * (MAX_MOVES + 1))
+void move_sequence_to_text(const MoveSequence *seq, char *buf);
+
 // Display MoveSequence struct
 void print_move_sequence(const MoveSequence *seq);
 
-// Recursively execute valid jumps
+// Recursively execute valid jumps (result_count goes past MAX_SEQUENCES on overflow)
 void dfs_jumps(const Board *board,
                int row, int col,
                bool is_white_turn,
@@ -76,6 +116,18 @@ bool execute_initial_removal(Board *board,
                              int row, int col,
                              bool is_black);
 
+// Pack a sequence into a MoveKey (0 for an empty sequence)
+MoveKey move_key_pack(const MoveSequence *seq);
+
+// Rebuild a sequence from its key; false if the key is truncated
+bool move_key_unpack(MoveKey key, MoveSequence *seq);
+
+// Index of the move matching key in a generated list, or -1
+int move_key_find(const MoveSequence *moves, int num_moves, MoveKey key);
+
+// Map every square of a sequence through a board symmetry
+void transform_sequence(MoveSequence *seq, int sym);
+
 // CHeck if a position is a valid initial removal
 bool is_valid_initial_removal(const Board *board,
                               int row, int col,
@@ -0,0 +1,60 @@
+#ifndef __NNUE_H__
+#define __NNUE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "board.h"
+#include "move.h"
+
+/* Small quantized network as an alternative to eval_position:
+
+     inputs   2 x TOTAL_CELLS  own stone on a square / opponent stone on it
+     layer 0  NNUE_HIDDEN int16 per perspective (White's and Black's view)
+     layer 1  int8 weights over both views, side to move first, clipped 0..127
+     output   int16 weights, one score from the side to move
+
+   Layer 0 is the accumulator: a jump moves one stone and removes one, so
+   the accumulator of a child is the parent's plus a few weight rows
+   (nnue_update) instead of a sum over every stone. The later layers run
+   on the CPU kernels (kernel_impl.h). */
+
+#define NNUE_INPUTS (2 * TOTAL_CELLS)
+#define NNUE_HIDDEN 64
+#define NNUE_L1 16
+#define NNUE_L1_SHIFT 6     // layer 1 sums to 0..127 activations
+#define NNUE_OUT_SHIFT 4    // output sum to eval_position units
+#define NNUE_DEF_PATH "konane.nnue"
+
+typedef struct {
+  int16_t ft_weights[NNUE_INPUTS][NNUE_HIDDEN];
+  int16_t ft_bias[NNUE_HIDDEN];
+  int8_t l1_weights[NNUE_L1][2 * NNUE_HIDDEN];
+  int32_t l1_bias[NNUE_L1];
+  int16_t out_weights[NNUE_L1];
+  int32_t out_bias;
+} Nnue;
+
+// Layer 0 from White's [0] and Black's [1] point of view
+typedef struct {
+  int16_t v[2][NNUE_HIDDEN];
+} NnueAccumulator;
+
+// Load / save a network file (for this board size); NULL if missing or malformed
+Nnue *nnue_load(const char *path);
+bool nnue_save(const Nnue *net, const char *path);
+void nnue_free(Nnue *net);
+/* Starting network that reproduces the material, corner and edge terms of
+   eval_position to within a point (mobility needs training), for nnue init */
+Nnue *nnue_bootstrap(void);
+
+// Accumulator from scratch
+void nnue_refresh(const Nnue *net, const Board *board, NnueAccumulator *acc);
+// Accumulator after a move by white_moved (out may be in)
+void nnue_update(const Nnue *net, const NnueAccumulator *in, NnueAccumulator *out,
+                 const MoveSequence *seq, bool white_moved);
+// Score from the side to move's point of view
+int nnue_evaluate(const Nnue *net, const NnueAccumulator *acc, bool white_to_move);
+// Refresh and evaluate in one go
+int nnue_eval_position(const Nnue *net, const Board *board, bool white_to_move);
+
+#endif
@@ -2,16 +2,34 @@
 #define PERFT_H
 
 #include "board.h"
+#include "nnue.h"
+#include "pool.h"
+#include "stats.h"
 #include <stdint.h>
 #include <stdbool.h>
 
-// Node counting
+// Position after the standard removals: the centre stone, then the one left of it
+void perft_start_position(Board *board);
+
+// Node counting; 0 when a position on the way has more moves than MAX_SEQUENCES
 uint64_t perft_nodes(const Board *board, bool is_white_turn, int depth);
+// On a pool: nodes with more than serial_depth plies left are tasks
+uint64_t perft_nodes_parallel(Pool *pool, const Board *board, bool is_white_turn, int depth,
+                              int serial_depth);
 void perft_divide(const Board *board, bool is_white_turn, int depth);
 
 // Benchmarking
-double perft_benchmark_negamax(const Board *board, bool is_white_turn, 
-                              int depth, int iterations, uint64_t *nodes_out);
+double perft_benchmark_negamax(const Board *board, bool is_white_turn,
+                              int depth, int iterations, SearchStats *stats_out);
+void perft_benchmark_engine(const Board *board, bool is_white_turn, int depth, int plies);
+void perft_benchmark_latency(const Board *board, bool is_white_turn, int movetime_ms, int plies);
+void perft_benchmark_mcts(const Board *board, bool is_white_turn, int playouts);
+void perft_match_mcts(int games, int movetime_ms, int depth);
+void perft_benchmark_playouts(const Board *board, bool is_white_turn, int playouts);
+void perft_benchmark_kernels(const Board *board, bool is_white_turn, int rounds);
+void perft_benchmark_batch(const Board *board, bool is_white_turn, int rounds);
+void perft_benchmark_nnue(const Board *board, bool is_white_turn, const Nnue *net, int rounds);
+void perft_benchmark_pool(const Board *board, bool is_white_turn, int depth, int threads, bool pin);
 
 // Testing
 void perft_test_suite(void);
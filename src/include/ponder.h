@@ -0,0 +1,27 @@
+#ifndef __PONDER_H__
+#define __PONDER_H__
+
+#include <stdbool.h>
+#include "ai.h"
+
+/* Pondering: while the opponent thinks, a background thread searches the
+   position after the reply the engine expects. If that reply is played
+   (ponder hit) the running search is simply awaited; otherwise (ponder
+   miss) it is stopped and the engine searches the real position. */
+typedef struct {
+  Engine *engine;
+  bool active;
+  MoveSequence expected;  // the reply being pondered on
+} Ponder;
+
+// Start pondering from `board` (opponent to move); false if no prediction
+bool ponder_start(Ponder *ponder, Engine *engine, const Board *board,
+                  bool opponent_is_white, int depth);
+
+/* Finish pondering once the opponent has played `played` (NULL cancels).
+   On a hit the pondered result is returned; on a miss the search is
+   stopped and false is returned. */
+bool ponder_finish(Ponder *ponder, const MoveSequence *played,
+                   MoveSequence *best, int *score);
+
+#endif
@@ -0,0 +1,79 @@
+#ifndef __POOL_H__
+#define __POOL_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+/* Work-stealing thread pool. Every worker owns a deque of tasks: it pushes
+   and pops at the bottom (newest first, so a recursive task keeps working
+   on its own subtree) and idle workers steal from the top of a random
+   victim's deque (oldest first, so they take the largest pieces). Tasks
+   spawned from outside the pool go through a shared queue.
+
+   Fork/join: pool_spawn adds a task to a group and pool_wait returns once
+   every task of the group has finished. A worker that waits runs other
+   tasks meanwhile (its own, then stolen ones), so recursive tasks can wait
+   on their children without tying up a thread. Task structs belong to the
+   caller and only have to live until the task starts.
+
+   One pool serves the whole engine (pool_shared, a worker per online CPU);
+   commands given an explicit thread count make a pool of that size. */
+
+#define POOL_MAX_THREADS 256
+#define POOL_DEQUE_SIZE 4096   // per worker; spawning onto a full deque runs the task inline
+
+typedef void (*PoolFn)(void *arg);
+
+typedef struct {
+  int pending;                 // tasks spawned and not finished
+  int external;                // a thread outside the pool waits on it
+} PoolGroup;
+
+typedef struct PoolTask {
+  PoolFn fn;
+  void *arg;
+  PoolGroup *group;
+  struct PoolTask *next;       // shared queue link
+} PoolTask;
+
+typedef struct {
+  int threads;                 // 0 = one per online CPU
+  bool pin;                    // pin worker i to CPU i % CPUs
+} PoolConfig;
+
+// Counters of one worker
+typedef struct {
+  uint64_t tasks;              // run
+  uint64_t spawned;            // pushed onto its deque
+  uint64_t inlined;            // run at spawn time: the deque was full
+  uint64_t steals;             // taken from another worker or the shared queue
+  uint64_t failed_steals;      // attempts that found nothing
+  uint64_t sleeps;             // waits for work on the condition variable
+} PoolWorkerStats;
+
+typedef struct Pool Pool;
+
+Pool *pool_create(const PoolConfig *config);   // NULL config = defaults
+void pool_destroy(Pool *pool);
+// The engine-wide pool, started on first use and kept until exit
+Pool *pool_shared(void);
+// pool_shared when threads is 0, else a new pool of that size (free with pool_release)
+Pool *pool_acquire(int threads);
+void pool_release(Pool *pool);
+
+int pool_threads(const Pool *pool);
+// Index of the calling worker of pool (0..threads-1), or -1 outside it
+int pool_worker_id(const Pool *pool);
+
+void pool_spawn(Pool *pool, PoolGroup *group, PoolTask *task, PoolFn fn, void *arg);
+void pool_wait(Pool *pool, PoolGroup *group);
+// fn(arg, i) for every i in [0, count), in pieces of at most grain (0 = split evenly)
+void pool_parallel_for(Pool *pool, size_t count, size_t grain,
+                       void (*fn)(void *arg, size_t i), void *arg);
+
+void pool_worker_stats(const Pool *pool, int worker, PoolWorkerStats *out);
+void pool_reset_stats(Pool *pool);
+void print_pool_stats(const Pool *pool, FILE *out);
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef __PROFILE_H__
+#define __PROFILE_H__
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Sampling profiler by engine phase, built in with `make PROFILE=1`
+   (-DKONANE_PROFILE). Code marks the phase it is in with PROFILE_PHASE at
+   the top of a scope: the thread's current phase is set there and put back
+   when the scope ends. A SIGPROF timer counts, on every sample, the phase
+   of the interrupted thread. Without the flag PROFILE_PHASE compiles to
+   nothing and profile_start fails, so an ordinary build pays nothing. */
+
+typedef enum {
+  PROF_OTHER,     // outside any tagged phase (UI, I/O, setup)
+  PROF_SEARCH,    // negamax / engine search overhead: ordering, bookkeeping
+  PROF_MOVEGEN,   // generate_all_moves
+  PROF_EVAL,      // eval_position, eval_batch, network evaluation
+  PROF_HASH,      // hashing, hash table probes and stores
+  PROF_PERFT,     // perft recursion
+  PROF_NUM_PHASES
+} ProfPhase;
+
+#define PROFILE_DEF_HZ 1000
+
+#ifdef KONANE_PROFILE
+extern __thread volatile int profile_phase;
+
+static inline int profile_enter(int phase) {
+  int prev = profile_phase;
+  profile_phase = phase;
+  return prev;
+}
+
+static inline void profile_leave(int *prev) {
+  profile_phase = *prev;
+}
+
+#define PROFILE_PHASE(phase) \
+  int profile_prev_ __attribute__((cleanup(profile_leave), unused)) = profile_enter(phase)
+#else
+#define PROFILE_PHASE(phase) ((void)0)
+#endif
+
+// Start sampling hz times per second of CPU time; false when not built in
+bool profile_start(int hz);
+void profile_stop(void);
+// Sampling is running
+bool profile_active(void);
+// Clear the counts
+void profile_reset(void);
+// Samples and share per phase
+void profile_report(FILE *out);
+// Stop and report on stderr (for atexit), unless nothing was sampled since the last report
+void profile_exit_report(void);
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef __PROTOCOL_H__
+#define __PROTOCOL_H__
+
+#include <stdio.h>
+#include <stdbool.h>
+
+/*
+  Engine protocol: a UCI-style line protocol so that a match manager or GUI
+  can keep one engine process alive for many games. Commands (one per line):
+
+    uci                         identify, list options, answer "uciok"
+    isready                     answer "readyok"
+    setoption name Hash value N hash table size in MB
+    setoption name EvalFile value PATH
+                                evaluate with a network file (see nnue.h);
+                                "<empty>" goes back to eval_position
+    ucinewgame                  forget the hash table and move ordering
+    position startpos [moves M...]
+    position fen <position> [moves M...]
+                                the full board (Black removes first) or a
+                                position in notation; removals are single
+                                squares ("D4"), moves are paths ("B3-D3-D5")
+    go [depth D] [movetime MS] [nodes N] [infinite]
+                                search in the background; every finished
+                                depth prints "info depth D score cp S nodes N
+                                nps X time MS pv M...", then "bestmove M"
+                                ("bestmove none" when there is no move);
+                                a decided position shows "score mate N",
+                                N moves to the win (negative: to the loss)
+    stop                        end the search now and print its bestmove
+    quit
+
+  During the removals "go" answers at once with the removal to make.
+*/
+
+#define PROTOCOL_DEF_HASH_MB 64
+#define PROTOCOL_MAX_HASH_MB 4096
+
+// Serve commands from in until "quit" or end of input; false on setup failure
+bool protocol_run(FILE *in, FILE *out);
+
+#endif
@@ -0,0 +1,91 @@
+#ifndef __RECORD_H__
+#define __RECORD_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include "board.h"
+#include "move.h"
+
+/*
+  Game record archive. Layout of the file:
+    header  : magic "KGR1", board size, game count, index offset
+    games   : one variable-length record per game
+    index   : game count x uint64 file offsets (8-byte aligned)
+  A game record is its two removal squares, the winner and the number of
+  moves, followed by each move as from square, jump count and the jump
+  directions packed four per byte (three bytes for a single jump).
+  While a writer has the archive open the index offset is 0; a reader
+  that finds it so rebuilds the index by scanning the records.
+*/
+
+#define RECORD_DEF_PATH "konane.games"
+#define RECORD_MAX_PLIES TOTAL_CELLS // every move removes a stone
+
+enum { RECORD_BLACK_WINS = 0, RECORD_WHITE_WINS = 1, RECORD_UNFINISHED = 0xFF };
+
+typedef struct {
+  int black_removal;   // square index
+  int white_removal;
+  int winner;          // RECORD_BLACK_WINS / _WHITE_WINS / _UNFINISHED
+  int num_moves;       // Black moves first
+  MoveSequence moves[RECORD_MAX_PLIES];
+} GameRecord;
+
+typedef struct {
+  FILE *file;
+  uint64_t *index;
+  uint64_t count;
+  uint64_t capacity;
+  uint64_t data_end;
+} ArchiveWriter;
+
+typedef struct {
+  void *map;
+  size_t map_size;
+  const uint8_t *data;
+  const uint64_t *index;
+  uint64_t *owned_index;  // rebuilt index of an unfinished archive
+  uint64_t count;
+} Archive;
+
+/* Streaming cursor over every position of every game: the position, the
+   side to move, the move played from it and the game's winner */
+typedef struct {
+  const Archive *archive;
+  uint64_t game;
+  int ply;
+  int num_moves;
+  int winner;
+  const uint8_t *next;
+  Board board;
+  bool is_white_turn;
+} ArchivePositions;
+
+// Start a record from the position after both removals
+void record_begin(GameRecord *game, const Board *board);
+// Add a move to a record (ignored once the record is full)
+void record_move(GameRecord *game, const MoveSequence *seq);
+// Replay a record's removals into a fresh board
+bool record_start_board(const GameRecord *game, Board *board);
+
+// Open an archive for appending (created if missing)
+ArchiveWriter *archive_writer_open(const char *path);
+bool archive_append(ArchiveWriter *writer, const GameRecord *game);
+// Write the index and header; the writer is freed either way
+bool archive_writer_close(ArchiveWriter *writer);
+
+// Memory-map an archive for reading
+Archive *archive_open(const char *path);
+void archive_close(Archive *archive);
+uint64_t archive_count(const Archive *archive);
+// Decode game n (0-based)
+bool archive_game(const Archive *archive, uint64_t n, GameRecord *game);
+
+// Iterate over all positions of all games
+void archive_positions_begin(const Archive *archive, ArchivePositions *it);
+bool archive_positions_next(ArchivePositions *it, Board *board, bool *is_white_turn,
+                            MoveSequence *played, int *winner);
+
+#endif
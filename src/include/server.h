@@ -0,0 +1,92 @@
+#ifndef __SERVER_H__
+#define __SERVER_H__
+
+#include <signal.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "ai.h"
+
+/*
+  Analysis server on a Unix domain socket. Every client line is a request
+
+    <id> <position> [depth D] [movetime MS] [nodes N] [deadline MS]
+
+  (position in notation, e.g. "BWBWBWB/.../BWBWBWB b"). Requests from all
+  connections go into one bounded queue served by a fixed pool of workers,
+  each with its own engine and hash table. Replies come back on the same
+  connection as soon as they are ready, tagged with the request id, so a
+  client can pipeline as many requests as it likes:
+
+    <id> bestmove <move> score <s> depth <d> nodes <n> queue <ms> time <ms>
+    <id> bestmove none queue <ms> time <ms>
+    <id> expired queue <ms>       deadline passed while queued
+    <id> busy                     queue full
+    <id> error <reason>
+
+  The deadline counts from receipt and also caps the search time, so a
+  request that starts in time is answered by its deadline with the best
+  move found so far. "<id> stats" answers with the server counters.
+*/
+
+#define SERVER_DEF_SOCKET "/tmp/konane.sock"
+#define SERVER_DEF_HASH_MB 16
+#define SERVER_DEF_QUEUE 4096
+#define SERVER_LINE_MAX 256
+
+typedef struct {
+  const char *socket_path;
+  int threads;            // workers, 0 = one per online CPU
+  size_t hash_mb;         // per worker
+  int queue_max;          // requests waiting for a worker
+  SearchLimits limits;    // for requests that give no limit
+} ServerConfig;
+
+typedef struct {
+  uint64_t accepted;      // requests queued
+  uint64_t completed;     // searched and answered
+  uint64_t expired;       // deadline passed before a worker took them
+  uint64_t rejected;      // queue full
+  uint64_t invalid;       // unparsable requests
+  uint64_t dropped;       // client went away before the answer
+  uint64_t connections;
+  uint64_t nodes;
+  int queue_depth;        // now
+  int max_queue_depth;    // high-water mark
+  int running;            // requests being searched now
+  double queue_seconds;   // total time completed requests waited
+  double seconds;
+} ServerStats;
+
+ServerConfig server_default_config(void);
+// Serve until *quit becomes non-zero (e.g. from a signal handler)
+bool server_run(const ServerConfig *config, volatile sig_atomic_t *quit, ServerStats *stats);
+void print_server_stats(const ServerStats *stats);
+
+/* Load generator: connects to a running server, keeps `inflight` requests
+   outstanding on each connection and measures latency from send to reply. */
+typedef struct {
+  const char *socket_path;
+  const char *positions_path; // one position per line; NULL = random positions
+  int requests;
+  int connections;
+  int inflight;           // outstanding requests per connection
+  SearchLimits limits;
+  int deadline_ms;        // 0 = none
+  uint64_t seed;
+} LoadgenConfig;
+
+typedef struct {
+  int sent;
+  int answered;
+  int expired;
+  int busy;
+  int errors;
+  double seconds;
+  double p50_ms, p90_ms, p99_ms, max_ms;
+} LoadgenResult;
+
+LoadgenConfig loadgen_default_config(void);
+bool loadgen_run(const LoadgenConfig *config, LoadgenResult *result);
+void print_loadgen_result(const LoadgenConfig *config, const LoadgenResult *result);
+
+#endif
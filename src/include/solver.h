@@ -0,0 +1,41 @@
+#ifndef __SOLVER_H__
+#define __SOLVER_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "board.h"
+#include "move.h"
+
+// Default solver hash size (MB) and node budget (0 = unlimited)
+#define SOLVER_DEF_HASH_MB 256
+#define SOLVER_DEF_NODES 0
+
+typedef enum {
+  SOLVE_UNKNOWN = 0,
+  SOLVE_WIN,     // side to move wins
+  SOLVE_LOSS     // side to move loses
+} SolveOutcome;
+
+typedef struct {
+  SolveOutcome outcome;
+  MoveSequence pv[TOTAL_CELLS]; // winning line (both sides), root first
+  int pv_length;
+  bool pv_truncated;            // proven, but the line hit the node limit or a move overflow
+  bool move_overflow;           // unknown: a position has more than MAX_SEQUENCES moves
+  uint64_t nodes;               // df-pn node expansions
+  double seconds;
+  size_t hash_entries;          // table capacity
+  size_t hash_used;             // slots filled when the search ended
+} SolveResult;
+
+// Prove the position won or lost for the side to move using df-pn.
+// hash_mb sizes the solver's private table; node_limit 0 means no limit.
+bool solve_position(const Board *board, bool is_white_turn,
+                    size_t hash_mb, uint64_t node_limit,
+                    SolveResult *result);
+
+// Print a SolveResult
+void print_solve_result(const SolveResult *result, bool is_white_turn);
+
+#endif
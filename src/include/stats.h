@@ -0,0 +1,41 @@
+#ifndef __STATS_H__
+#define __STATS_H__
+
+#include <stdio.h>
+#include <stdint.h>
+#include "board.h"
+
+/* Counters filled in by the search itself: one increment per event on a
+   structure the searching thread owns, so they are always compiled in.
+   The engine keeps one per search (Engine.stats); negamax_with_stats
+   fills one for the plain alpha-beta search. */
+
+#define STATS_MAX_DEPTH TOTAL_CELLS
+
+typedef struct {
+  uint64_t nodes;               // search calls, leaves included
+  uint64_t leaf_evals;          // static evaluations at the horizon
+  uint64_t terminal_nodes;      // side to move had no move
+  uint64_t beta_cutoffs;
+  uint64_t first_move_cutoffs;  // cutoffs by the first move tried
+  uint64_t hash_probes;         // engine searches only
+  uint64_t hash_hits;
+  uint64_t hash_cutoffs;        // nodes answered by the hash table
+  int max_sequence;             // longest jump chain generated
+  int depth;                    // last completed iteration
+  uint64_t depth_nodes[STATS_MAX_DEPTH + 1];   // nodes of iteration d
+  double depth_seconds[STATS_MAX_DEPTH + 1];   // time of iteration d
+  double seconds;
+} SearchStats;
+
+void search_stats_reset(SearchStats *stats);
+// Share of cutoffs made by the first move (move ordering quality)
+double search_stats_first_cutoff_rate(const SearchStats *stats);
+// Nodes of iteration d over nodes of iteration d - 1 (0 if unknown)
+double search_stats_ebf(const SearchStats *stats, int depth);
+
+void print_search_stats(const SearchStats *stats);
+// One JSON object on a single line
+void search_stats_json(const SearchStats *stats, FILE *out);
+
+#endif
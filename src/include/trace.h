@@ -0,0 +1,91 @@
+#ifndef __TRACE_H__
+#define __TRACE_H__
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "board.h"
+#include "move.h"
+
+/* Search trace: an engine with a trace buffer attached (engine_set_trace)
+   records one 16-byte event as each node returns, and one per finished
+   iteration, into a preallocated ring that keeps the latest events. As
+   every engine belongs to one thread, so does its ring, and recording is a
+   store into it. Node events come in post-order (children before their
+   parent), which is enough to rebuild the tree.
+
+   Dump file: header (magic "KTR1", board size, event size, events written
+   in all, events kept), then the kept events, oldest first. */
+
+#define TRACE_DEF_EVENTS (1 << 20)
+#define TRACE_SCORE_INF 32767    // alpha/beta beyond the int16 range
+
+enum { TRACE_NODE = 1, TRACE_ITERATION = 2 };
+
+// Node flags
+#define TRACE_CUTOFF   0x01   // beta cutoff
+#define TRACE_HASH     0x02   // answered by the hash table
+#define TRACE_LEAF     0x04   // evaluated at the horizon
+#define TRACE_TERMINAL 0x08   // no legal move
+
+typedef struct {
+  uint8_t kind;      // TRACE_NODE / TRACE_ITERATION
+  uint8_t ply;
+  uint8_t depth;     // remaining depth (iteration: its depth)
+  uint8_t flags;
+  MoveKey move;      // move into the node (iteration: best move)
+  int16_t alpha;     // window on entry, from the side to move
+  int16_t beta;
+  int16_t score;
+  uint16_t moves;    // children searched
+} TraceEvent;
+
+typedef struct {
+  TraceEvent *events;
+  uint64_t mask;                  // capacity - 1 (a power of two)
+  uint64_t written;               // in all; the ring keeps the last capacity
+  MoveKey path[TOTAL_CELLS + 1];  // move into each ply of the current line
+} TraceBuffer;
+
+// Ring of at least `events` events (rounded up to a power of two)
+TraceBuffer *trace_create(uint64_t events);
+void trace_free(TraceBuffer *trace);
+void trace_clear(TraceBuffer *trace);
+
+static inline int16_t trace_clamp(int score) {
+  return (int16_t)(score > TRACE_SCORE_INF ? TRACE_SCORE_INF :
+                   score < -TRACE_SCORE_INF ? -TRACE_SCORE_INF : score);
+}
+
+static inline void trace_record(TraceBuffer *trace, int kind, int ply, int depth, int flags,
+                                MoveKey move, int alpha, int beta, int score, int moves) {
+  TraceEvent *e = &trace->events[trace->written++ & trace->mask];
+  e->kind = (uint8_t)kind;
+  e->ply = (uint8_t)ply;
+  e->depth = (uint8_t)depth;
+  e->flags = (uint8_t)flags;
+  e->move = move;
+  e->alpha = trace_clamp(alpha);
+  e->beta = trace_clamp(beta);
+  e->score = trace_clamp(score);
+  e->moves = (uint16_t)moves;
+}
+
+// Write the kept events to a file
+bool trace_dump(const TraceBuffer *trace, const char *path);
+
+/* Decoder: a dump read back into memory */
+typedef struct {
+  TraceEvent *events;
+  uint64_t count;     // kept
+  uint64_t written;   // in all (count < written: the oldest were overwritten)
+} TraceLog;
+
+TraceLog *trace_load(const char *path);
+void trace_log_free(TraceLog *log);
+// Nodes per ply with their kinds, and the iterations
+void trace_print_stats(const TraceLog *log, FILE *out);
+// The tree, indented by ply, down to max_ply (< 0 = all)
+void trace_print_tree(const TraceLog *log, int max_ply, FILE *out);
+
+#endif
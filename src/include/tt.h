@@ -0,0 +1,75 @@
+#ifndef __TT_H__
+#define __TT_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "board.h"
+#include "move.h"
+
+/*
+  Transposition table partitioned by stone count ("layer").
+  Every Konane move removes at least one stone, so a position with more
+  stones than the current root can never be reached again. Entries are
+  tagged with their layer and the table keeps a root watermark: moving the
+  root down releases every layer above it at once, and released slots are
+  the first to be recycled by the replacement policy. Moving it back up
+  (a new game) revives whatever released slots were not recycled; they
+  still describe the same positions.
+*/
+
+#define TT_DEF_MB 64
+#define TT_BUCKET_SIZE 4
+
+typedef enum {
+  TT_EXACT,
+  TT_LOWER,  // score is a lower bound (fail high)
+  TT_UPPER   // score is an upper bound (fail low)
+} TTBound;
+
+/* The last word packs score, draft, bound and layer so an entry stays 16
+   bytes: 15 bits hold the mate band (+-10000) and 7 bits a draft up to
+   MAX_PLY or a stone count. Boards over 11x11 need 9 bits for those two,
+   and their entries grow to 24 bytes. */
+#define TT_SCORE_MAX 16383
+#if TOTAL_CELLS < 128
+#define TT_PLY_BITS 7
+#else
+#define TT_PLY_BITS 9
+#endif
+
+typedef struct {
+  uint64_t key;   // 0 = empty slot
+  MoveKey move;
+  int32_t score : 15;
+  uint32_t depth : TT_PLY_BITS;
+  uint32_t bound : 2;
+  uint32_t layer : TT_PLY_BITS; // stones on the board
+} TTEntry;
+
+_Static_assert(TOTAL_CELLS < (1 << TT_PLY_BITS), "TTEntry depth and layer fields too narrow for this board");
+_Static_assert(TOTAL_CELLS >= 128 || sizeof(TTEntry) == 16, "TTEntry must stay 16 bytes");
+
+typedef struct {
+  TTEntry *entries;
+  size_t bucket_mask;
+  int root_layer;                     // stones at the current root
+  uint64_t probes;
+  uint64_t hits;
+  uint64_t stores;
+} TransTable;
+
+// Allocate / free a table of roughly size_mb megabytes
+TransTable *tt_create(size_t size_mb);
+void tt_free(TransTable *tt);
+void tt_clear(TransTable *tt);
+
+// Move the root to a position with `stones` stones, releasing higher layers
+void tt_set_root(TransTable *tt, int stones);
+
+// Probe for a position; NULL on miss
+const TTEntry *tt_probe(TransTable *tt, uint64_t key, int layer);
+void tt_store(TransTable *tt, uint64_t key, int layer, int depth,
+              int score, TTBound bound, MoveKey move);
+
+#endif
@@ -0,0 +1,48 @@
+#ifndef __TUNE_H__
+#define __TUNE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ai.h"
+
+/* Evaluation weight tuning (the Texel method). Every position of the
+   finished games in a game archive is reduced to its eval terms (see
+   eval_terms) and the game's result from the side to move. The weights
+   are then fitted by gradient descent on the logistic loss of
+   sigmoid(k * score) against the result, with k first fitted to the
+   current weights so the tuned ones keep the same scale. Decided
+   positions (eval_position's fixed scores) are left out. Term extraction
+   and every gradient pass are split over worker threads. */
+
+#define TUNE_DEF_ITERATIONS 2000
+#define TUNE_DEF_RATE 0.5      // Adam step, in weight units
+
+typedef struct {
+  const char *archive_path;
+  const char *out_path;  // weights file to write (NULL = none)
+  int threads;           // 0 = one per online CPU
+  int iterations;        // at most; stops early once the loss settles
+  double rate;
+  bool progress;         // print the loss every 10% of the iterations
+} TuneConfig;
+
+typedef struct {
+  uint64_t games;
+  uint64_t positions;    // used for tuning
+  uint64_t skipped;      // decided positions and unfinished games
+  double k;
+  double loss_before;    // mean logistic loss with the starting weights
+  double loss_after;     // with the rounded tuned weights
+  int iterations;        // run
+  int weights[EVAL_NUM_TERMS];
+  double extract_seconds;
+  double seconds;
+} TuneResult;
+
+TuneConfig tune_default_config(void);
+
+// Tune the weights on an archive; false if it cannot be read or holds no usable position
+bool tune_run(const TuneConfig *config, TuneResult *result);
+void print_tune_result(const TuneResult *result);
+
+#endif
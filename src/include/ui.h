@@ -6,5 +6,7 @@
 
 // Display main menu
 void main_menu(void);
+// Interactive solver (asks for the opening removals)
+void solver_menu(void);
 
 #endif
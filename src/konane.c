@@ -0,0 +1,226 @@
+/* Public library API (konane.h) on top of the engine modules. Positions
+   cross the boundary as plain bitboards and moves as square paths, so the
+   internal Board / MoveSequence layouts stay private. */
+#include "ai.h"
+#define KONANE_BOARD_SIZE BOARD_SIZE
+#include "konane.h"
+#include "perft.h"
+#include <string.h>
+#include <strings.h>
+
+_Static_assert(KONANE_SQUARES == TOTAL_CELLS, "board size mismatch");
+_Static_assert(sizeof(KonaneBitboard) == sizeof(Bitboard), "bitboard width mismatch");
+_Static_assert(KONANE_MAX_JUMPS == MAX_MOVES, "jump limit mismatch");
+_Static_assert(KONANE_MAX_MOVES == MAX_SEQUENCES, "move list size mismatch");
+_Static_assert(KONANE_TEXT_MAX >= BOARD_TEXT_MAX, "position text too short");
+_Static_assert(KONANE_MOVE_TEXT_MAX >= MOVE_TEXT_MAX, "move text too short");
+
+struct KonaneEngine {
+  Engine *engine;
+};
+
+const char *konane_version(void) {
+  return KONANE_VERSION;
+}
+
+/* Same bits, word for word: copied rather than assigned since four-word
+   boards are a plain struct on the public side */
+static void to_board(const KonanePosition *pos, Board *board) {
+  memcpy(&board->white, &pos->white, sizeof(Bitboard));
+  memcpy(&board->black, &pos->black, sizeof(Bitboard));
+  board->white &= VALID_MASK;
+  board->black &= VALID_MASK & ~board->white;
+}
+
+static void from_board(const Board *board, bool white_to_move, KonanePosition *pos) {
+  memcpy(&pos->white, &board->white, sizeof(Bitboard));
+  memcpy(&pos->black, &board->black, sizeof(Bitboard));
+  pos->white_to_move = white_to_move;
+}
+
+static void to_move(const MoveSequence *seq, KonaneMove *move) {
+  move->num_jumps = seq->count;
+  move->squares[0] = (uint8_t)MOVE_FROM(seq->jumps[0]);
+  for (int i = 0; i < seq->count; i++) move->squares[i + 1] = (uint8_t)MOVE_TO(seq->jumps[i]);
+}
+
+static bool same_move(const MoveSequence *seq, const KonaneMove *move) {
+  if (seq->count != move->num_jumps || MOVE_FROM(seq->jumps[0]) != move->squares[0]) return false;
+  for (int i = 0; i < seq->count; i++) {
+    if (MOVE_TO(seq->jumps[i]) != move->squares[i + 1]) return false;
+  }
+  return true;
+}
+
+/* ---- Positions ---- */
+
+// Full board, Black to make the first removal
+void konane_start_position(KonanePosition *pos) {
+  Board board;
+  init_board(&board);
+  from_board(&board, false, pos);
+}
+
+// Opening removal by the side to move (Black: corner or centre, White: next to it)
+bool konane_remove_stone(KonanePosition *pos, int square) {
+  if (square < 0 || square >= TOTAL_CELLS) return false;
+
+  Board board;
+  int row, col;
+  to_board(pos, &board);
+  index_to_coord(square, &row, &col);
+
+  if (!execute_initial_removal(&board, row, col, !pos->white_to_move)) return false;
+
+  /* Black removes, White removes, then Black makes the first move */
+  from_board(&board, !pos->white_to_move, pos);
+  return true;
+}
+
+bool konane_position_from_text(const char *text, KonanePosition *pos) {
+  Board board;
+  bool white;
+
+  if (!board_from_text(text, &board, &white)) return false;
+  from_board(&board, white, pos);
+  return true;
+}
+
+void konane_position_to_text(const KonanePosition *pos, char *buf) {
+  Board board;
+  to_board(pos, &board);
+  board_to_text(&board, pos->white_to_move, buf);
+}
+
+/* ---- Moves ---- */
+
+int konane_generate_moves(const KonanePosition *pos, KonaneMove *moves) {
+  Board board;
+  MoveSequence seqs[MAX_SEQUENCES];
+  to_board(pos, &board);
+
+  int count = generate_all_moves(&board, pos->white_to_move, seqs);
+  for (int i = 0; i < count; i++) to_move(&seqs[i], &moves[i]);
+  return count;
+}
+
+int konane_count_moves(const KonanePosition *pos) {
+  Board board;
+  to_board(pos, &board);
+  return count_all_moves(&board, pos->white_to_move);
+}
+
+// Play a move; false (position unchanged) if it is not legal or the moves do not fit a list
+bool konane_play_move(KonanePosition *pos, const KonaneMove *move) {
+  if (!move || move->num_jumps <= 0 || move->num_jumps > MAX_MOVES) return false;
+
+  Board board;
+  MoveSequence seqs[MAX_SEQUENCES];
+  to_board(pos, &board);
+
+  int count = generate_all_moves(&board, pos->white_to_move, seqs);
+  for (int i = 0; i < count; i++) {
+    if (same_move(&seqs[i], move)) {
+      execute_sequence(&board, &seqs[i], pos->white_to_move);
+      from_board(&board, !pos->white_to_move, pos);
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void konane_move_to_text(const KonaneMove *move, char *buf) {
+  char *p = buf;
+  *p = '\0';
+
+  for (int i = 0; i <= move->num_jumps && move->num_jumps > 0; i++) {
+    int row, col;
+    index_to_coord(move->squares[i], &row, &col);
+    p += sprintf(p, i ? "-%c%d" : "%c%d", 'A' + col, row + 1);
+  }
+}
+
+bool konane_move_from_text(const KonanePosition *pos, const char *text, KonaneMove *move) {
+  KonaneMove moves[MAX_SEQUENCES];
+  char buf[KONANE_MOVE_TEXT_MAX];
+  int count = konane_generate_moves(pos, moves);
+
+  for (int i = 0; i < count; i++) {
+    konane_move_to_text(&moves[i], buf);
+    if (!strcasecmp(buf, text)) {
+      *move = moves[i];
+      return true;
+    }
+  }
+
+  return false;
+}
+
+uint64_t konane_perft(const KonanePosition *pos, int depth) {
+  Board board;
+  to_board(pos, &board);
+  return perft_nodes(&board, pos->white_to_move, depth);
+}
+
+/* ---- Search ---- */
+
+KonaneEngine *konane_engine_new(size_t hash_mb) {
+  KonaneEngine *engine = malloc(sizeof(KonaneEngine));
+  if (!engine) return NULL;
+
+  engine->engine = engine_create(hash_mb ? hash_mb : TT_DEF_MB);
+  if (!engine->engine) {
+    free(engine);
+    return NULL;
+  }
+
+  return engine;
+}
+
+void konane_engine_free(KonaneEngine *engine) {
+  if (!engine) return;
+  engine_free(engine->engine);
+  free(engine);
+}
+
+void konane_engine_reset(KonaneEngine *engine) {
+  engine_new_game(engine->engine);
+}
+
+bool konane_search(KonaneEngine *engine, const KonanePosition *pos,
+                   const KonaneLimits *limits, KonaneResult *result) {
+  Board board;
+  SearchLimits search_limits = { 0 };
+  SearchResult search;
+  TransTable *tt = engine->engine->tt;
+  uint64_t probes = tt->probes, hits = tt->hits;
+
+  to_board(pos, &board);
+  if (limits) {
+    search_limits.depth = limits->depth;
+    search_limits.movetime_ms = limits->movetime_ms;
+    search_limits.nodes = limits->nodes;
+  }
+
+  /* The stop flag is cleared once a search is over, not before the next
+     one starts, so a konane_stop racing ahead of the search still counts */
+  bool ok = engine_search(engine->engine, &board, pos->white_to_move, &search_limits, &search);
+  engine_clear_stop(engine->engine);
+
+  memset(result, 0, sizeof(*result));
+  result->has_move = search.has_move;
+  if (search.has_move) to_move(&search.best, &result->best);
+  result->score = search.score;
+  result->depth = search.depth;
+  result->nodes = search.nodes;
+  result->seconds = search.seconds;
+  result->hash_probes = tt->probes - probes;
+  result->hash_hits = tt->hits - hits;
+  return ok;
+}
+
+// Ask a running or starting konane_search to return its best move so far (any thread)
+void konane_stop(KonaneEngine *engine) {
+  engine_stop(engine->engine);
+}
@@ -1,11 +1,756 @@
 /* Simple Konane entry point.
-   Calls the UI main menu which drives the rest of the program. */
+   Without arguments the UI main menu drives the rest of the program;
+   otherwise the first argument selects a non-interactive command. */
+#include <signal.h>
+#include <string.h>
+#include <unistd.h>
+#include "analyze.h"
+#include "book.h"
 #include "game.h"
+#include "match.h"
+#include "perft.h"
+#include "pool.h"
+#include "profile.h"
+#include "protocol.h"
+#include "record.h"
+#include "server.h"
+#include "solver.h"
+#include "trace.h"
+#include "tune.h"
 #include "ui.h"
 
-int main(void) {
-  /* Start the user interface / game menus */
-  main_menu();
-  
+static void usage(const char *prog) {
+  printf("Usage: %s [--size N] [command]          (this build plays %dx%d)\n", prog,
+         BOARD_SIZE, BOARD_SIZE);
+  printf("  --size N                             run the build for an NxN board (konaneN)\n");
+  printf("  (no command)                         interactive menu\n");
+  printf("  solve [B W | POSITION] [--hash MB] [--nodes N]\n");
+  printf("                                       prove the position after removals B, W (default centre,\n");
+  printf("                                       then the stone below it: D4 D3 on 7x7)\n");
+  printf("                                       or a position such as \"BWBWBWB/.../BWBWBWB b\"\n");
+  printf("  book build [FILE] [--depth D] [--plies P]\n");
+  printf("                                       precompute the opening book (default %s)\n", BOOK_DEF_PATH);
+  printf("  match [A B] [--games N] [--threads T] [--plies P] [--seed S] [--record FILE]\n");
+  printf("                                       headless match between two players, e.g.\n");
+  printf("                                       negamax:depth=5, negamax:ms=50, mcts:playouts=5000, random\n");
+  printf("  analyze [FILE] [--depth D] [--movetime MS] [--threads T] [--hash MB] [--eval] [--nnue NET]\n");
+  printf("                                       best move for each position line of FILE (or stdin),\n");
+  printf("                                       or with --eval its static evaluation only\n");
+  printf("  search [POSITION] [--depth D] [--movetime MS] [--hash MB] [--json] [--nnue NET]\n");
+  printf("         [--trace FILE] [--trace-events N]\n");
+  printf("                                       one search with its statistics (default after D4 C4),\n");
+  printf("                                       optionally recording its last N nodes (default %d)\n",
+         TRACE_DEF_EVENTS);
+  printf("  trace stats FILE | trace show FILE [--ply P]\n");
+  printf("                                       summarize / print the tree of a search trace\n");
+  printf("  nnue init [NET] | nnue bench [NET]   write the starting network (default %s) /\n", NNUE_DEF_PATH);
+  printf("                                       compare evaluations per second\n");
+  printf("  tune [FILE] [--out WEIGHTS] [--threads T] [--iterations N] [--rate R]\n");
+  printf("                                       fit the eval weights to the games of an archive\n");
+  printf("                                       (default %s, writes %s)\n", RECORD_DEF_PATH,
+         EVAL_WEIGHTS_DEF_PATH);
+  printf("  perft [DEPTH] [--divide] [--threads T] [--pin] [--serial S]\n");
+  printf("                                       count move paths from the standard opening, with\n");
+  printf("                                       --threads on the work-stealing pool (S plies serial)\n");
+  printf("  protocol                             UCI-style engine protocol on stdin/stdout\n");
+  printf("  serve [--socket PATH] [--threads T] [--hash MB] [--queue N] [--depth D] [--movetime MS]\n");
+  printf("                                       analysis server on a Unix socket (default %s)\n", SERVER_DEF_SOCKET);
+  printf("  loadgen [FILE] [--socket PATH] [--requests N] [--connections C] [--inflight K]\n");
+  printf("          [--depth D] [--movetime MS] [--nodes N] [--deadline MS] [--seed S]\n");
+  printf("                                       load a running server and report throughput and latency\n");
+  printf("  record info|scan [FILE]              summarize / scan every position of a game archive\n");
+  printf("  record show N [FILE]                 replay game N (default %s)\n", RECORD_DEF_PATH);
+}
+
+// konane solve [black_removal white_removal | position] [--hash MB] [--nodes N]
+static int cmd_solve(int argc, char **argv) {
+  char centre[8], below[8];
+  snprintf(centre, sizeof(centre), "%c%d", 'A' + BOARD_CENTER, BOARD_CENTER + 1);
+  snprintf(below, sizeof(below), "%c%d", 'A' + BOARD_CENTER, BOARD_CENTER);
+  const char *removals[2] = { centre, below };
+  int num_removals = 0;
+  size_t hash_mb = SOLVER_DEF_HASH_MB;
+  uint64_t node_limit = SOLVER_DEF_NODES;
+  char position[BOARD_TEXT_MAX + 8] = "";
+
+  for (int i = 0; i < argc; i++) {
+    if (!strcmp(argv[i], "--hash") && i + 1 < argc) {
+      hash_mb = strtoul(argv[++i], NULL, 10);
+    } else if (!strcmp(argv[i], "--nodes") && i + 1 < argc) {
+      node_limit = strtoull(argv[++i], NULL, 10);
+    } else if (strchr(argv[i], '/') && !position[0] && !num_removals) {
+      /* The side to move may come as a separate argument when unquoted */
+      if (i + 1 < argc && (!strcmp(argv[i + 1], "b") || !strcmp(argv[i + 1], "w"))) {
+        snprintf(position, sizeof(position), "%s %s", argv[i], argv[i + 1]);
+        i++;
+      } else {
+        snprintf(position, sizeof(position), "%s", argv[i]);
+      }
+    } else if (num_removals < 2 && !position[0]) {
+      removals[num_removals++] = argv[i];
+    } else {
+      printf("Unexpected argument: %s\n", argv[i]);
+      return 1;
+    }
+  }
+
+  Board board;
+  bool white = false;
+  init_board(&board);
+
+  if (position[0]) {
+    if (!board_from_text(position, &board, &white)) {
+      printf("Invalid position: %s\n", position);
+      return 1;
+    }
+  } else {
+    for (int i = 0; i < 2; i++) {
+      int row, col;
+      if (!parse_coord(removals[i], &row, &col) ||
+          !execute_initial_removal(&board, row, col, i == 0)) {
+        printf("Invalid %s removal: %s\n", i == 0 ? "Black" : "White", removals[i]);
+        return 1;
+      }
+    }
+  }
+
+  print_board(&board);
+
+  SolveResult result;
+  solve_position(&board, white, hash_mb, node_limit, &result);
+  print_solve_result(&result, white);
+
+  return result.outcome == SOLVE_UNKNOWN ? 2 : 0;
+}
+
+// konane book build [file] [--depth D] [--plies P]
+static int cmd_book(int argc, char **argv) {
+  if (argc < 1 || strcmp(argv[0], "build")) {
+    printf("Usage: book build [FILE] [--depth D] [--plies P]\n");
+    return 1;
+  }
+
+  const char *path = BOOK_DEF_PATH;
+  int depth = BOOK_DEF_DEPTH;
+  int plies = BOOK_DEF_PLIES;
+
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--depth") && i + 1 < argc) depth = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--plies") && i + 1 < argc) plies = atoi(argv[++i]);
+    else path = argv[i];
+  }
+
+  if (depth <= 0 || plies < 0) {
+    printf("Invalid depth/plies\n");
+    return 1;
+  }
+
+  return book_build(path, depth, plies) ? 0 : 1;
+}
+
+// konane match [A B] [--games N] [--threads T] [--plies P] [--seed S] [--record FILE]
+static int cmd_match(int argc, char **argv) {
+  MatchConfig config = match_default_config();
+  int num_players = 0;
+
+  for (int i = 0; i < argc; i++) {
+    if (!strcmp(argv[i], "--games") && i + 1 < argc) {
+      config.games = atoi(argv[++i]);
+    } else if (!strcmp(argv[i], "--threads") && i + 1 < argc) {
+      config.threads = atoi(argv[++i]);
+    } else if (!strcmp(argv[i], "--plies") && i + 1 < argc) {
+      config.random_plies = atoi(argv[++i]);
+    } else if (!strcmp(argv[i], "--seed") && i + 1 < argc) {
+      config.seed = strtoull(argv[++i], NULL, 10);
+    } else if (!strcmp(argv[i], "--record") && i + 1 < argc) {
+      config.record_path = argv[++i];
+    } else if (num_players < 2 && match_parse_player(argv[i], &config.players[num_players])) {
+      num_players++;
+    } else {
+      printf("Unexpected argument: %s\n", argv[i]);
+      return 1;
+    }
+  }
+
+  if (config.games <= 0 || config.random_plies < 0) {
+    printf("Invalid games/plies\n");
+    return 1;
+  }
+
+  MatchResult result;
+  if (!match_run(&config, &result)) {
+    printf("No games were played\n");
+    return 1;
+  }
+
+  print_match_result(&config, &result);
+  return 0;
+}
+
+// konane analyze [file] [--depth D] [--movetime MS] [--threads T] [--hash MB] [--eval] [--nnue NET]
+static int cmd_analyze(int argc, char **argv) {
+  AnalyzeConfig config = analyze_default_config();
+  const char *path = NULL, *net_path = NULL;
+  bool depth_set = false;
+
+  for (int i = 0; i < argc; i++) {
+    if (!strcmp(argv[i], "--depth") && i + 1 < argc) {
+      config.limits.depth = atoi(argv[++i]);
+      depth_set = true;
+    } else if (!strcmp(argv[i], "--movetime") && i + 1 < argc) {
+      config.limits.movetime_ms = atoi(argv[++i]);
+    } else if (!strcmp(argv[i], "--threads") && i + 1 < argc) {
+      config.threads = atoi(argv[++i]);
+    } else if (!strcmp(argv[i], "--hash") && i + 1 < argc) {
+      config.hash_mb = strtoul(argv[++i], NULL, 10);
+    } else if (!strcmp(argv[i], "--eval")) {
+      config.static_eval = true;
+    } else if (!strcmp(argv[i], "--nnue") && i + 1 < argc) {
+      net_path = argv[++i];
+    } else if (!path) {
+      path = argv[i];
+    } else {
+      printf("Unexpected argument: %s\n", argv[i]);
+      return 1;
+    }
+  }
+
+  /* A time limit alone searches as deep as the time allows */
+  if (config.limits.movetime_ms > 0 && !depth_set) config.limits.depth = 0;
+  if (config.limits.depth < 0 || config.limits.movetime_ms < 0) {
+    printf("Invalid depth/movetime\n");
+    return 1;
+  }
+
+  Nnue *net = NULL;
+  if (net_path && !(net = nnue_load(net_path))) {
+    printf("Cannot load network %s\n", net_path);
+    return 1;
+  }
+  config.nnue = net;
+
+  FILE *in = (!path || !strcmp(path, "-")) ? stdin : fopen(path, "r");
+  if (!in) {
+    printf("Cannot open %s\n", path);
+    nnue_free(net);
+    return 1;
+  }
+
+  AnalyzeStats stats;
+  bool ok = analyze_stream(in, stdout, &config, &stats);
+  if (in != stdin) fclose(in);
+  nnue_free(net);
+
+  /* Summary on stderr keeps stdout to one line per position */
+  fprintf(stderr, "%llu positions (%llu invalid), %llu nodes in %.2fs\n",
+          (unsigned long long)stats.positions, (unsigned long long)stats.invalid,
+          (unsigned long long)stats.nodes, stats.seconds);
+  return ok && stats.invalid == 0 ? 0 : 1;
+}
+
+// konane search [position] [--depth D] [--movetime MS] [--hash MB] [--json] [--nnue NET]
+//                [--trace FILE] [--trace-events N]
+static int cmd_search(int argc, char **argv) {
+  SearchLimits limits = { .depth = DEF_DEPTH };
+  size_t hash_mb = TT_DEF_MB;
+  bool json = false, depth_set = false;
+  const char *net_path = NULL, *trace_path = NULL;
+  long long trace_events = TRACE_DEF_EVENTS;
+  char position[BOARD_TEXT_MAX + 8] = "";
+
+  for (int i = 0; i < argc; i++) {
+    if (!strcmp(argv[i], "--depth") && i + 1 < argc) {
+      limits.depth = atoi(argv[++i]);
+      depth_set = true;
+    } else if (!strcmp(argv[i], "--movetime") && i + 1 < argc) {
+      limits.movetime_ms = atoi(argv[++i]);
+    } else if (!strcmp(argv[i], "--hash") && i + 1 < argc) {
+      hash_mb = strtoul(argv[++i], NULL, 10);
+    } else if (!strcmp(argv[i], "--json")) {
+      json = true;
+    } else if (!strcmp(argv[i], "--nnue") && i + 1 < argc) {
+      net_path = argv[++i];
+    } else if (!strcmp(argv[i], "--trace") && i + 1 < argc) {
+      trace_path = argv[++i];
+    } else if (!strcmp(argv[i], "--trace-events") && i + 1 < argc) {
+      trace_events = atoll(argv[++i]);
+    } else if (strchr(argv[i], '/')) {
+      if (i + 1 < argc && (!strcmp(argv[i + 1], "b") || !strcmp(argv[i + 1], "w"))) {
+        snprintf(position, sizeof(position), "%s %s", argv[i], argv[i + 1]);
+        i++;
+      } else {
+        snprintf(position, sizeof(position), "%s", argv[i]);
+      }
+    } else {
+      printf("Unexpected argument: %s\n", argv[i]);
+      return 1;
+    }
+  }
+
+  if (limits.movetime_ms > 0 && !depth_set) limits.depth = 0;
+  if (trace_events <= 0) {
+    printf("Invalid trace events\n");
+    return 1;
+  }
+
+  Board board;
+  bool white = false;
+  if (!position[0]) {
+    perft_start_position(&board);
+  } else if (!board_from_text(position, &board, &white)) {
+    printf("Invalid position: %s\n", position);
+    return 1;
+  }
+
+  Nnue *net = NULL;
+  if (net_path && !(net = nnue_load(net_path))) {
+    printf("Cannot load network %s\n", net_path);
+    return 1;
+  }
+
+  Engine *eng = engine_create(hash_mb);
+  if (!eng) {
+    printf("Cannot allocate %zu MB hash\n", hash_mb);
+    nnue_free(net);
+    return 1;
+  }
+  engine_set_nnue(eng, net);
+
+  TraceBuffer *trace = NULL;
+  if (trace_path) {
+    if (!(trace = trace_create((uint64_t)trace_events))) {
+      printf("Cannot allocate %lld trace events\n", trace_events);
+      engine_free(eng);
+      nnue_free(net);
+      return 1;
+    }
+    engine_set_trace(eng, trace);
+  }
+
+  SearchResult result;
+  bool found = engine_search(eng, &board, white, &limits, &result);
+
+  if (json) {
+    search_stats_json(&eng->stats, stdout);
+  } else {
+    char move[MOVE_TEXT_MAX] = "none";
+    if (found) move_sequence_to_text(&result.best, move);
+    printf("bestmove %s score %d depth %d\n", move, result.score, result.depth);
+    print_search_stats(&eng->stats);
+  }
+
+  bool traced = true;
+  if (trace) {
+    if (!(traced = trace_dump(trace, trace_path))) printf("Cannot write %s\n", trace_path);
+    else if (!json) printf("Wrote %s (%llu events, %llu kept)\n", trace_path,
+                           (unsigned long long)trace->written,
+                           (unsigned long long)(trace->written < trace->mask + 1 ? trace->written
+                                                                                 : trace->mask + 1));
+  }
+
+  engine_free(eng);
+  trace_free(trace);
+  nnue_free(net);
+  return found && traced ? 0 : 1;
+}
+
+// konane trace stats FILE | trace show FILE [--ply P]
+static int cmd_trace(int argc, char **argv) {
+  if (argc < 2 || (strcmp(argv[0], "stats") && strcmp(argv[0], "show"))) {
+    printf("Usage: trace stats FILE | trace show FILE [--ply P]\n");
+    return 1;
+  }
+
+  int max_ply = -1;
+  for (int i = 2; i < argc; i++) {
+    if (!strcmp(argv[i], "--ply") && i + 1 < argc) {
+      max_ply = atoi(argv[++i]);
+    } else {
+      printf("Unexpected argument: %s\n", argv[i]);
+      return 1;
+    }
+  }
+
+  TraceLog *log = trace_load(argv[1]);
+  if (!log) {
+    printf("Cannot read trace %s (or it is for another board size)\n", argv[1]);
+    return 1;
+  }
+
+  if (!strcmp(argv[0], "stats")) trace_print_stats(log, stdout);
+  else trace_print_tree(log, max_ply, stdout);
+  trace_log_free(log);
+  return 0;
+}
+
+// konane tune [file] [--out weights] [--threads T] [--iterations N] [--rate R]
+static int cmd_tune(int argc, char **argv) {
+  TuneConfig config = tune_default_config();
+  bool path_set = false;
+
+  for (int i = 0; i < argc; i++) {
+    if (!strcmp(argv[i], "--out") && i + 1 < argc) {
+      config.out_path = argv[++i];
+    } else if (!strcmp(argv[i], "--threads") && i + 1 < argc) {
+      config.threads = atoi(argv[++i]);
+    } else if (!strcmp(argv[i], "--iterations") && i + 1 < argc) {
+      config.iterations = atoi(argv[++i]);
+    } else if (!strcmp(argv[i], "--rate") && i + 1 < argc) {
+      config.rate = atof(argv[++i]);
+    } else if (!path_set) {
+      config.archive_path = argv[i];
+      path_set = true;
+    } else {
+      printf("Unexpected argument: %s\n", argv[i]);
+      return 1;
+    }
+  }
+
+  if (config.iterations < 0 || config.rate <= 0) {
+    printf("Invalid iterations/rate\n");
+    return 1;
+  }
+
+  TuneResult result;
+  if (!tune_run(&config, &result)) {
+    if (result.positions) printf("Cannot write %s\n", config.out_path);
+    else printf("No finished games in %s\n", config.archive_path);
+    return 1;
+  }
+
+  print_tune_result(&result);
+  printf("Wrote %s\n", config.out_path);
+  return 0;
+}
+
+// konane nnue init [net] | nnue bench [net]
+static int cmd_nnue(int argc, char **argv) {
+  if (argc < 1 || (strcmp(argv[0], "init") && strcmp(argv[0], "bench"))) {
+    printf("Usage: nnue init [NET] | nnue bench [NET]\n");
+    return 1;
+  }
+
+  const char *path = argc > 1 ? argv[1] : NNUE_DEF_PATH;
+
+  if (!strcmp(argv[0], "init")) {
+    Nnue *net = nnue_bootstrap();
+    bool ok = net && nnue_save(net, path);
+    nnue_free(net);
+    if (!ok) {
+      printf("Cannot write %s\n", path);
+      return 1;
+    }
+    printf("Wrote %s (%dx%d, %zu bytes of weights)\n", path, BOARD_SIZE, BOARD_SIZE, sizeof(Nnue));
+    return 0;
+  }
+
+  /* Without a file the bench runs on the starting network */
+  Nnue *net = argc > 1 ? nnue_load(path) : nnue_bootstrap();
+  if (!net) {
+    printf("Cannot load network %s\n", path);
+    return 1;
+  }
+
+  Board board;
+  perft_start_position(&board);
+  printf("%dx%d, kernels: %s\n", BOARD_SIZE, BOARD_SIZE, cpu_kernels->name);
+  perft_benchmark_nnue(&board, false, net, 50);
+  nnue_free(net);
+  return 0;
+}
+
+// konane perft [depth] [--divide] [--threads T] [--pin] [--serial S]
+static int cmd_perft(int argc, char **argv) {
+  int depth = 5;
+  int serial_depth = 2;
+  bool divide = false, parallel = false;
+  PoolConfig pool_config = { 0 };
+
+  for (int i = 0; i < argc; i++) {
+    if (!strcmp(argv[i], "--divide")) divide = true;
+    else if (!strcmp(argv[i], "--threads") && i + 1 < argc) {
+      pool_config.threads = atoi(argv[++i]);
+      parallel = true;
+    } else if (!strcmp(argv[i], "--pin")) {
+      pool_config.pin = parallel = true;
+    } else if (!strcmp(argv[i], "--serial") && i + 1 < argc) {
+      serial_depth = atoi(argv[++i]);
+    } else if (atoi(argv[i]) > 0) depth = atoi(argv[i]);
+    else {
+      printf("Unexpected argument: %s\n", argv[i]);
+      return 1;
+    }
+  }
+
+  Board board;
+  perft_start_position(&board);
+
+  if (divide) {
+    perft_divide(&board, false, depth);
+    return 0;
+  }
+
+  Pool *pool = NULL;
+  if (parallel && !(pool = pool_create(&pool_config))) {
+    printf("Cannot start the thread pool\n");
+    return 1;
+  }
+
+  printf("%dx%d, kernels: %s", BOARD_SIZE, BOARD_SIZE, cpu_kernels->name);
+  if (pool) printf(", %d workers, %d plies serial", pool_threads(pool), serial_depth);
+  printf("\n");
+
+  for (int d = 1; d <= depth; d++) {
+    double start = wall_seconds();
+    uint64_t nodes = pool ? perft_nodes_parallel(pool, &board, false, d, serial_depth)
+                          : perft_nodes(&board, false, d);
+    double secs = wall_seconds() - start;
+    if (nodes == 0) {
+      printf("depth %2d: a position has more than %d moves, cannot count\n", d, MAX_SEQUENCES);
+      break;
+    }
+    printf("depth %2d: %12llu nodes %9.3fs %12.0f nodes/s\n", d, (unsigned long long)nodes, secs,
+           secs > 0 ? nodes / secs : 0.0);
+  }
+
+  if (pool) {
+    print_pool_stats(pool, stdout);
+    pool_destroy(pool);
+  }
   return 0;
-} 
+}
+
+/* Each board size is its own build (konane6, konane8, ...) with the
+   geometry compiled in; --size N hands the command line to the build for
+   N, found next to this program or else on the PATH. */
+static int run_size(int size, char **argv) {
+  char prog[4096] = "konane";
+  const char *slash = strrchr(argv[0], '/');
+
+  if (slash) snprintf(prog, sizeof(prog), "%.*s", (int)(slash - argv[0] + 1), argv[0]);
+  size_t len = slash ? strlen(prog) : 0;
+  if (size == BOARD_DEFAULT_SIZE) snprintf(prog + len, sizeof(prog) - len, "konane");
+  else snprintf(prog + len, sizeof(prog) - len, "konane%d", size);
+
+  argv[0] = prog;
+  execvp(prog, argv);
+  printf("No %dx%d build (%s): make sizes SIZES=%d builds one (4 to 16)\n", size, size, prog, size);
+  return 1;
+}
+
+static volatile sig_atomic_t server_quit;
+
+static void on_quit_signal(int sig) {
+  server_quit = 1;
+}
+
+// konane serve [--socket PATH] [--threads T] [--hash MB] [--queue N] [--depth D] [--movetime MS]
+static int cmd_serve(int argc, char **argv) {
+  ServerConfig config = server_default_config();
+  bool depth_set = false;
+
+  for (int i = 0; i < argc; i++) {
+    if (!strcmp(argv[i], "--socket") && i + 1 < argc) {
+      config.socket_path = argv[++i];
+    } else if (!strcmp(argv[i], "--threads") && i + 1 < argc) {
+      config.threads = atoi(argv[++i]);
+    } else if (!strcmp(argv[i], "--hash") && i + 1 < argc) {
+      config.hash_mb = strtoul(argv[++i], NULL, 10);
+    } else if (!strcmp(argv[i], "--queue") && i + 1 < argc) {
+      config.queue_max = atoi(argv[++i]);
+    } else if (!strcmp(argv[i], "--depth") && i + 1 < argc) {
+      config.limits.depth = atoi(argv[++i]);
+      depth_set = true;
+    } else if (!strcmp(argv[i], "--movetime") && i + 1 < argc) {
+      config.limits.movetime_ms = atoi(argv[++i]);
+    } else {
+      printf("Unexpected argument: %s\n", argv[i]);
+      return 1;
+    }
+  }
+
+  if (config.limits.movetime_ms > 0 && !depth_set) config.limits.depth = 0;
+  if (config.queue_max <= 0 || config.limits.depth < 0 || config.limits.movetime_ms < 0) {
+    printf("Invalid queue/depth/movetime\n");
+    return 1;
+  }
+
+  /* Ctrl-C / SIGTERM end the accept loop; poll() is interrupted, not restarted */
+  struct sigaction sa = { .sa_handler = on_quit_signal };
+  sigemptyset(&sa.sa_mask);
+  sigaction(SIGINT, &sa, NULL);
+  sigaction(SIGTERM, &sa, NULL);
+
+  ServerStats stats;
+  if (!server_run(&config, &server_quit, &stats)) return 1;
+
+  print_server_stats(&stats);
+  return 0;
+}
+
+// konane loadgen [file] [--socket PATH] [--requests N] [--connections C] [--inflight K] ...
+static int cmd_loadgen(int argc, char **argv) {
+  LoadgenConfig config = loadgen_default_config();
+  bool limit_set = false;
+
+  for (int i = 0; i < argc; i++) {
+    if (!strcmp(argv[i], "--socket") && i + 1 < argc) {
+      config.socket_path = argv[++i];
+    } else if (!strcmp(argv[i], "--requests") && i + 1 < argc) {
+      config.requests = atoi(argv[++i]);
+    } else if (!strcmp(argv[i], "--connections") && i + 1 < argc) {
+      config.connections = atoi(argv[++i]);
+    } else if (!strcmp(argv[i], "--inflight") && i + 1 < argc) {
+      config.inflight = atoi(argv[++i]);
+    } else if (!strcmp(argv[i], "--depth") && i + 1 < argc) {
+      config.limits.depth = atoi(argv[++i]);
+      limit_set = true;
+    } else if (!strcmp(argv[i], "--movetime") && i + 1 < argc) {
+      config.limits.movetime_ms = atoi(argv[++i]);
+      if (!limit_set) config.limits.depth = 0;
+    } else if (!strcmp(argv[i], "--nodes") && i + 1 < argc) {
+      config.limits.nodes = strtoull(argv[++i], NULL, 10);
+      if (!limit_set) config.limits.depth = 0;
+    } else if (!strcmp(argv[i], "--deadline") && i + 1 < argc) {
+      config.deadline_ms = atoi(argv[++i]);
+    } else if (!strcmp(argv[i], "--seed") && i + 1 < argc) {
+      config.seed = strtoull(argv[++i], NULL, 10);
+    } else if (!config.positions_path) {
+      config.positions_path = argv[i];
+    } else {
+      printf("Unexpected argument: %s\n", argv[i]);
+      return 1;
+    }
+  }
+
+  if (config.requests <= 0 || config.connections <= 0 || config.inflight <= 0) {
+    printf("Invalid requests/connections/inflight\n");
+    return 1;
+  }
+
+  LoadgenResult result;
+  if (!loadgen_run(&config, &result)) {
+    printf("No replies from %s\n", config.socket_path);
+    return 1;
+  }
+
+  print_loadgen_result(&config, &result);
+  return result.errors ? 1 : 0;
+}
+
+// konane record info|scan [file] | record show N [file]
+static int cmd_record(int argc, char **argv) {
+  bool show = argc >= 2 && !strcmp(argv[0], "show");
+  if (argc < 1 || (!show && strcmp(argv[0], "info") && strcmp(argv[0], "scan"))) {
+    printf("Usage: record info|scan [FILE] | record show N [FILE]\n");
+    return 1;
+  }
+
+  int path_arg = show ? 2 : 1;
+  const char *path = argc > path_arg ? argv[path_arg] : RECORD_DEF_PATH;
+
+  Archive *archive = archive_open(path);
+  if (!archive) {
+    printf("Cannot open game archive %s\n", path);
+    return 1;
+  }
+
+  int status = 0;
+
+  if (show) {
+    uint64_t n = strtoull(argv[1], NULL, 10);
+    GameRecord *game = malloc(sizeof(GameRecord));
+    Board board;
+
+    if (!game || n < 1 || !archive_game(archive, n - 1, game) || !record_start_board(game, &board)) {
+      printf("No game %llu in %s\n", (unsigned long long)n, path);
+      status = 1;
+    } else {
+      int br, bc, wr, wc;
+      index_to_coord(game->black_removal, &br, &bc);
+      index_to_coord(game->white_removal, &wr, &wc);
+      printf("Removals: Black %c%d, White %c%d\n", 'A' + bc, br + 1, 'A' + wc, wr + 1);
+
+      for (int i = 0; i < game->num_moves; i++) {
+        printf("%3d. %s ", i + 1, i % 2 ? "White" : "Black");
+        print_move_sequence(&game->moves[i]);
+        execute_sequence(&board, &game->moves[i], i % 2);
+      }
+
+      print_board(&board);
+      printf("Winner: %s\n", game->winner == RECORD_BLACK_WINS ? "Black" :
+                              game->winner == RECORD_WHITE_WINS ? "White" : "unfinished");
+    }
+    free(game);
+  } else if (!strcmp(argv[0], "scan")) {
+    /* Replays every move of every game: a measure of archive throughput */
+    ArchivePositions it;
+    uint64_t positions = 0, mover_wins = 0;
+    bool white;
+    int winner;
+    double start = wall_seconds();
+
+    archive_positions_begin(archive, &it);
+    while (archive_positions_next(&it, NULL, &white, NULL, &winner)) {
+      positions++;
+      if (winner == (white ? RECORD_WHITE_WINS : RECORD_BLACK_WINS)) mover_wins++;
+    }
+
+    double secs = wall_seconds() - start;
+    printf("%llu positions from %llu games in %.3fs (%.1fM positions/s, %.1f MB/s)\n",
+           (unsigned long long)positions, (unsigned long long)archive_count(archive), secs,
+           secs > 0 ? positions / secs / 1e6 : 0.0,
+           secs > 0 ? archive->map_size / secs / 1e6 : 0.0);
+    printf("Side to move went on to win from %.1f%% of them\n",
+           positions ? 100.0 * mover_wins / positions : 0.0);
+  } else {
+    uint64_t count = archive_count(archive);
+    printf("%s: %llu games, %zu bytes (%.1f bytes/game)\n", path, (unsigned long long)count,
+           archive->map_size, count ? (double)archive->map_size / count : 0.0);
+  }
+
+  archive_close(archive);
+  return status;
+}
+
+int main(int argc, char **argv) {
+  if (argc >= 3 && !strcmp(argv[1], "--size")) {
+    int size = atoi(argv[2]);
+    argv[2] = argv[0];
+    if (size != BOARD_SIZE) return run_size(size, argv + 2);
+    argc -= 2;
+    argv += 2;
+  }
+
+  /* The opening book is optional: without the file the AI just searches */
+  book_init(BOOK_DEF_PATH);
+  /* So are tuned weights: without the file the defaults from ai.h apply,
+     but a file that is there and does not load should not go unnoticed */
+  if (!eval_weights_load(EVAL_WEIGHTS_DEF_PATH) && access(EVAL_WEIGHTS_DEF_PATH, F_OK) == 0)
+    fprintf(stderr, "Warning: could not load %s, using the default weights\n", EVAL_WEIGHTS_DEF_PATH);
+  /* PROFILE=1 builds sample the whole run and report at exit */
+  if (profile_start(PROFILE_DEF_HZ)) atexit(profile_exit_report);
+
+  if (argc < 2) {
+    /* Start the user interface / game menus */
+    main_menu();
+    return 0;
+  }
+
+  if (!strcmp(argv[1], "solve")) return cmd_solve(argc - 2, argv + 2);
+  if (!strcmp(argv[1], "book")) return cmd_book(argc - 2, argv + 2);
+  if (!strcmp(argv[1], "match")) return cmd_match(argc - 2, argv + 2);
+  if (!strcmp(argv[1], "record")) return cmd_record(argc - 2, argv + 2);
+  if (!strcmp(argv[1], "analyze")) return cmd_analyze(argc - 2, argv + 2);
+  if (!strcmp(argv[1], "search")) return cmd_search(argc - 2, argv + 2);
+  if (!strcmp(argv[1], "trace")) return cmd_trace(argc - 2, argv + 2);
+  if (!strcmp(argv[1], "perft")) return cmd_perft(argc - 2, argv + 2);
+  if (!strcmp(argv[1], "nnue")) return cmd_nnue(argc - 2, argv + 2);
+  if (!strcmp(argv[1], "tune")) return cmd_tune(argc - 2, argv + 2);
+  if (!strcmp(argv[1], "serve")) return cmd_serve(argc - 2, argv + 2);
+  if (!strcmp(argv[1], "loadgen")) return cmd_loadgen(argc - 2, argv + 2);
+  if (!strcmp(argv[1], "protocol")) return protocol_run(stdin, stdout) ? 0 : 1;
+
+  usage(argv[0]);
+  return strcmp(argv[1], "help") && strcmp(argv[1], "--help") ? 1 : 0;
+}
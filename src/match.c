@@ -0,0 +1,384 @@
+/* Headless match runner. Every game is a task on the thread pool, played
+   with the engines of a match worker it takes for the game (never more of
+   them than games or pool threads); game 2k and 2k+1 start from the same
+   random opening with the players' colours swapped. */
+#include "match.h"
+#include "mcts.h"
+#include "pool.h"
+#include "record.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+typedef struct MatchWorker MatchWorker;
+
+typedef struct {
+  const MatchConfig *config;
+  MatchResult *result;
+  ArchiveWriter *archive;  // NULL unless games are recorded
+  Pool *pool;
+  MatchWorker **idle;      // workers no game is using
+  int num_idle;
+  int finished;
+  pthread_mutex_t lock;
+  pthread_cond_t idle_cond;
+} Match;
+
+struct MatchWorker {
+  Match *match;
+  Engine *engines[2];
+  Mcts *mcts[2];
+  uint64_t rng;
+  GameRecord record;
+};
+
+// Defaults: 1000 games, negamax depth 5 against itself
+MatchConfig match_default_config(void) {
+  MatchPlayer negamax = {
+    .type = PLAYER_TYPE_AI_NEGAMAX,
+    .depth = DEF_DEPTH,
+    .hash_mb = MATCH_DEF_HASH_MB
+  };
+  MatchConfig config = {
+    .players = { negamax, negamax },
+    .games = MATCH_DEF_GAMES,
+    .threads = 0,
+    .random_plies = MATCH_DEF_RANDOM_PLIES,
+    .seed = 1,
+    .progress = true
+  };
+  return config;
+}
+
+// Parse "negamax[:depth=D][:ms=T]", "mcts[:playouts=N][:ms=T]" or "random"
+bool match_parse_player(const char *text, MatchPlayer *player) {
+  char buf[128];
+  if (!text || strlen(text) >= sizeof(buf)) return false;
+  strcpy(buf, text);
+
+  memset(player, 0, sizeof(*player));
+  player->hash_mb = MATCH_DEF_HASH_MB;
+
+  char *save = NULL;
+  char *name = strtok_r(buf, ":", &save);
+  if (!name) return false;
+
+  if (!strcmp(name, "negamax")) player->type = PLAYER_TYPE_AI_NEGAMAX;
+  else if (!strcmp(name, "mcts")) player->type = PLAYER_TYPE_AI_MCTS;
+  else if (!strcmp(name, "random")) player->type = PLAYER_TYPE_AI_RANDOM;
+  else return false;
+
+  for (char *opt = strtok_r(NULL, ":", &save); opt; opt = strtok_r(NULL, ":", &save)) {
+    char *value = strchr(opt, '=');
+    if (!value) return false;
+    *value++ = '\0';
+
+    if (!strcmp(opt, "depth")) player->depth = atoi(value);
+    else if (!strcmp(opt, "ms")) player->movetime_ms = atoi(value);
+    else if (!strcmp(opt, "playouts")) player->playouts = strtoull(value, NULL, 10);
+    else if (!strcmp(opt, "hash")) player->hash_mb = strtoul(value, NULL, 10);
+    else return false;
+  }
+
+  /* Without any limit fall back to the interactive defaults */
+  if (player->type == PLAYER_TYPE_AI_NEGAMAX && !player->depth && !player->movetime_ms)
+    player->depth = DEF_DEPTH;
+  if (player->type == PLAYER_TYPE_AI_MCTS && !player->playouts && !player->movetime_ms)
+    player->playouts = MCTS_DEF_PLAYOUTS;
+
+  return true;
+}
+
+// Describe a player in the same syntax
+void match_player_name(const MatchPlayer *player, char *buf, size_t len) {
+  int n;
+
+  switch (player->type) {
+    case PLAYER_TYPE_AI_NEGAMAX:
+      n = snprintf(buf, len, "negamax");
+      if (player->depth) n += snprintf(buf + n, len - n, ":depth=%d", player->depth);
+      break;
+    case PLAYER_TYPE_AI_MCTS:
+      n = snprintf(buf, len, "mcts");
+      if (player->playouts)
+        n += snprintf(buf + n, len - n, ":playouts=%llu", (unsigned long long)player->playouts);
+      break;
+    default:
+      snprintf(buf, len, "random");
+      return;
+  }
+
+  if (player->movetime_ms) snprintf(buf + n, len - n, ":ms=%d", player->movetime_ms);
+}
+
+/* Random removals followed by random plies; draws again if the game would
+   already be over. Depends only on the seed and the pair number. */
+static void random_opening(const MatchConfig *config, int pair, Board *board, bool *is_white_turn,
+                           GameRecord *record) {
+  static const int corners[5][2] = { {0, 0}, {0, BOARD_SIZE - 1}, {BOARD_SIZE - 1, 0},
+                                     {BOARD_SIZE - 1, BOARD_SIZE - 1}, {BOARD_SIZE / 2, BOARD_SIZE / 2} };
+  static const int adjacent[4][2] = { {-1, 0}, {0, 1}, {1, 0}, {0, -1} };
+  uint64_t rng = (config->seed + 0x9E3779B97F4A7C15ULL * (uint64_t)(pair + 1)) | 1;
+
+  /* On even boards two corners hold White stones: keep Black's squares only */
+  Board start;
+  int removals[5][2], num_removals = 0;
+  init_board(&start);
+  for (int i = 0; i < 5; i++) {
+    if (!is_valid_initial_removal(&start, corners[i][0], corners[i][1], true)) continue;
+    removals[num_removals][0] = corners[i][0];
+    removals[num_removals][1] = corners[i][1];
+    num_removals++;
+  }
+
+  while (true) {
+    init_board(board);
+
+    const int *r = removals[random_next(&rng) % num_removals];
+    if (!execute_initial_removal(board, r[0], r[1], true)) continue;
+
+    /* White takes a random stone next to the hole */
+    int options[4][2], num_options = 0;
+    for (int d = 0; d < 4; d++) {
+      int row = r[0] + adjacent[d][0], col = r[1] + adjacent[d][1];
+      if (is_valid_initial_removal(board, row, col, false)) {
+        options[num_options][0] = row;
+        options[num_options][1] = col;
+        num_options++;
+      }
+    }
+    if (num_options == 0) continue;
+    const int *w = options[random_next(&rng) % num_options];
+    if (!execute_initial_removal(board, w[0], w[1], false)) continue;
+
+    bool white = false;
+    int plies = 0;
+    MoveSequence seq;
+
+    record_begin(record, board);
+    while (plies < config->random_plies && sample_random_move(board, white, &rng, &seq)) {
+      record_move(record, &seq);
+      execute_sequence(board, &seq, white);
+      white = !white;
+      plies++;
+    }
+
+    if (plies == config->random_plies && count_all_moves(board, white) > 0) {
+      *is_white_turn = white;
+      return;
+    }
+  }
+}
+
+// Move for one player; false if it has none
+static bool player_move(MatchWorker *w, int p, const Board *board, bool is_white_turn,
+                        MoveSequence *seq) {
+  const MatchPlayer *player = &w->match->config->players[p];
+
+  if (player->type == PLAYER_TYPE_AI_NEGAMAX) {
+    SearchLimits limits = { .depth = player->depth, .movetime_ms = player->movetime_ms };
+    SearchResult result;
+    if (engine_search(w->engines[p], board, is_white_turn, &limits, &result)) {
+      *seq = result.best;
+      return true;
+    }
+  } else if (player->type == PLAYER_TYPE_AI_MCTS) {
+    MctsResult result;
+    if (mcts_search(w->mcts[p], board, is_white_turn, &result)) {
+      *seq = result.best;
+      return true;
+    }
+  }
+
+  /* Random players, and engines that found no move: there is none, or
+     more than they can list (see MAX_SEQUENCES), and then any will do */
+  return sample_random_move(board, is_white_turn, &w->rng, seq);
+}
+
+// Play one game; returns the winning player's index
+static int play_game(MatchWorker *w, int game, int *plies) {
+  const MatchConfig *config = w->match->config;
+  Board board;
+  bool white;
+
+  random_opening(config, game / 2, &board, &white, &w->record);
+
+  /* Player 0 is Black in even games; the opening leaves `white` to move */
+  int black_player = game % 2;
+
+  for (int p = 0; p < 2; p++) {
+    if (w->engines[p]) engine_new_game(w->engines[p]);
+    if (w->mcts[p]) mcts_new_game(w->mcts[p]);
+  }
+
+  *plies = 0;
+  while (true) {
+    int p = white ? 1 - black_player : black_player;
+    MoveSequence seq;
+
+    /* The side without a move loses */
+    if (!player_move(w, p, &board, white, &seq)) {
+      w->record.winner = white ? RECORD_BLACK_WINS : RECORD_WHITE_WINS;
+      return 1 - p;
+    }
+
+    record_move(&w->record, &seq);
+    execute_sequence(&board, &seq, white);
+    white = !white;
+    (*plies)++;
+  }
+}
+
+// Pool task: one game on the engines of an idle worker
+static void match_game(void *arg, size_t index) {
+  Match *match = arg;
+  const MatchConfig *config = match->config;
+  int report = config->games >= 10 ? config->games / 10 : 1;
+  int game = (int)index;
+
+  /* A game never waits on the pool, so no more games run at once than
+     there are threads and a worker is always free; the wait is a guard */
+  pthread_mutex_lock(&match->lock);
+  while (match->num_idle == 0) pthread_cond_wait(&match->idle_cond, &match->lock);
+  MatchWorker *w = match->idle[--match->num_idle];
+  pthread_mutex_unlock(&match->lock);
+
+  int plies;
+  int winner = play_game(w, game, &plies);
+
+  pthread_mutex_lock(&match->lock);
+  match->idle[match->num_idle++] = w;
+  pthread_cond_signal(&match->idle_cond);
+  MatchResult *result = match->result;
+  result->games++;
+  result->wins[winner]++;
+  if (winner == game % 2) result->wins_as_black[winner]++;
+  result->plies += (uint64_t)plies;
+  if (match->archive && archive_append(match->archive, &w->record)) result->recorded++;
+  match->finished++;
+  if (config->progress && match->finished % report == 0) {
+    printf("  %d/%d games, %d-%d\n", match->finished, config->games,
+           result->wins[0], result->wins[1]);
+    fflush(stdout);
+  }
+  pthread_mutex_unlock(&match->lock);
+}
+
+static double elo_from_score(double score) {
+  if (score < 1e-6) score = 1e-6;
+  if (score > 1 - 1e-6) score = 1 - 1e-6;
+  return -400.0 * log10(1.0 / score - 1.0);
+}
+
+static bool worker_init(MatchWorker *w, Match *match, int index) {
+  memset(w, 0, sizeof(*w));
+  w->match = match;
+  w->rng = (match->config->seed ^ (0xD1B54A32D192ED03ULL * (uint64_t)(index + 1))) | 1;
+
+  for (int p = 0; p < 2; p++) {
+    const MatchPlayer *player = &match->config->players[p];
+
+    if (player->type == PLAYER_TYPE_AI_NEGAMAX) {
+      w->engines[p] = engine_create(player->hash_mb);
+      if (!w->engines[p]) return false;
+    } else if (player->type == PLAYER_TYPE_AI_MCTS) {
+      /* Games already run in parallel, so each tree gets one thread */
+      MctsConfig mc = mcts_default_config();
+      mc.threads = 1;
+      mc.playouts = player->playouts;
+      mc.movetime_ms = player->movetime_ms;
+      w->mcts[p] = mcts_create(&mc);
+      if (!w->mcts[p]) return false;
+    }
+  }
+
+  return true;
+}
+
+static void worker_free(MatchWorker *w) {
+  for (int p = 0; p < 2; p++) {
+    engine_free(w->engines[p]);
+    mcts_free(w->mcts[p]);
+  }
+}
+
+// Play the match; false if nothing could be played
+bool match_run(const MatchConfig *config, MatchResult *result) {
+  if (!config || !result || config->games <= 0) return false;
+
+  memset(result, 0, sizeof(*result));
+
+  Pool *pool = pool_acquire(config->threads > config->games ? config->games : config->threads);
+  if (!pool) return false;
+  /* The shared pool may have more threads than there are games */
+  int threads = pool_threads(pool) < config->games ? pool_threads(pool) : config->games;
+
+  Match match = { .config = config, .result = result, .pool = pool };
+  pthread_mutex_init(&match.lock, NULL);
+  pthread_cond_init(&match.idle_cond, NULL);
+
+  if (config->record_path) {
+    match.archive = archive_writer_open(config->record_path);
+    if (!match.archive) printf("Cannot open game archive %s; games are not recorded\n", config->record_path);
+  }
+
+  MatchWorker *workers = calloc((size_t)threads, sizeof(MatchWorker));
+  MatchWorker **idle = calloc((size_t)threads, sizeof(MatchWorker *));
+  int ready = 0;
+  double start = wall_seconds();
+
+  if (workers && idle) {
+    for (; ready < threads; ready++) {
+      if (!worker_init(&workers[ready], &match, ready)) {
+        worker_free(&workers[ready]);
+        break;
+      }
+    }
+  }
+
+  if (ready == threads) {
+    for (int t = 0; t < threads; t++) idle[t] = &workers[t];
+    match.idle = idle;
+    match.num_idle = threads;
+    pool_parallel_for(pool, (size_t)config->games, 1, match_game, &match);
+  }
+
+  for (int t = 0; t < ready; t++) worker_free(&workers[t]);
+  free(workers);
+  free(idle);
+  pool_release(pool);
+  pthread_cond_destroy(&match.idle_cond);
+  pthread_mutex_destroy(&match.lock);
+  if (match.archive && !archive_writer_close(match.archive))
+    printf("Error writing game archive %s\n", config->record_path);
+
+  result->seconds = wall_seconds() - start;
+  if (result->games == 0) return false;
+
+  /* No draws in Konane: each game is a Bernoulli trial */
+  int n = result->games;
+  double score = (double)result->wins[0] / n;
+  double margin = 1.96 * sqrt(score * (1.0 - score) / n);
+
+  result->score = score;
+  result->elo = elo_from_score(score);
+  result->elo_error = (elo_from_score(score + margin) - elo_from_score(score - margin)) / 2.0;
+  return true;
+}
+
+void print_match_result(const MatchConfig *config, const MatchResult *result) {
+  char names[2][64];
+  for (int p = 0; p < 2; p++) match_player_name(&config->players[p], names[p], sizeof(names[p]));
+
+  printf("%s vs %s: %d games in %.1fs (%.1f plies/game, %s kernels)\n", names[0], names[1],
+         result->games, result->seconds,
+         result->games ? (double)result->plies / result->games : 0.0, cpu_kernels->name);
+  for (int p = 0; p < 2; p++) {
+    printf("  %-28s %5d wins (%d as Black, %d as White)\n", names[p], result->wins[p],
+           result->wins_as_black[p], result->wins[p] - result->wins_as_black[p]);
+  }
+  printf("  score %.1f%%, Elo %+.1f +/- %.1f (95%%)\n",
+         result->score * 100.0, result->elo, result->elo_error);
+  if (config->record_path && result->recorded)
+    printf("  %d games appended to %s\n", result->recorded, config->record_path);
+}
@@ -0,0 +1,354 @@
+/* UCT search with tree parallelism. Nodes live in one preallocated pool;
+   a node's children are allocated contiguously when it is expanded. Node
+   statistics are updated with atomics, and an expansion is claimed with a
+   compare-and-swap so only one thread builds a node's children. */
+#include "mcts.h"
+#include "ai.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+enum { NODE_LEAF, NODE_EXPANDING, NODE_EXPANDED };
+
+struct MctsNode {
+  MoveKey move;          // move that led here (0 at the root)
+  uint32_t parent;
+  uint32_t first_child;
+  uint16_t num_children;
+  uint8_t state;
+  uint8_t mover_white;   // side that played `move`
+  int32_t visits;
+  int32_t wins;          // playouts won by the side that played `move`
+  int32_t virtual_loss;
+};
+
+#define LOAD(x) __atomic_load_n(&(x), __ATOMIC_RELAXED)
+#define ADD(x, v) __atomic_fetch_add(&(x), (v), __ATOMIC_RELAXED)
+
+// Default configuration
+MctsConfig mcts_default_config(void) {
+  MctsConfig config = {
+    .exploration = MCTS_DEF_EXPLORATION,
+    .threads = 0,
+    .playouts = MCTS_DEF_PLAYOUTS,
+    .movetime_ms = 0,
+    .max_nodes = MCTS_DEF_NODES
+  };
+  return config;
+}
+
+// Create / free a search tree
+Mcts *mcts_create(const MctsConfig *config) {
+  Mcts *mcts = calloc(1, sizeof(Mcts));
+  if (!mcts) return NULL;
+
+  mcts->config = config ? *config : mcts_default_config();
+  if (mcts->config.max_nodes < 1024) mcts->config.max_nodes = 1024;
+  if (mcts->config.threads <= 0) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    mcts->config.threads = cpus > 0 ? (int)cpus : 1;
+  }
+
+  mcts->nodes = malloc((size_t)mcts->config.max_nodes * sizeof(MctsNode));
+  if (!mcts->nodes) {
+    free(mcts);
+    return NULL;
+  }
+
+  /* Without helpers the search still runs, on the calling thread alone */
+  if (mcts->config.threads > 1 && !(mcts->pool = pool_acquire(mcts->config.threads - 1)))
+    mcts->config.threads = 1;
+
+  return mcts;
+}
+
+void mcts_free(Mcts *mcts) {
+  if (!mcts) return;
+  pool_release(mcts->pool);
+  free(mcts->nodes);
+  free(mcts);
+}
+
+// Drop the tree so the next search starts from scratch
+void mcts_new_game(Mcts *mcts) {
+  mcts->has_root = false;
+}
+
+// Play a packed move, falling back to the move list for long chains
+static void apply_key(Board *board, MoveKey key, bool is_white_turn) {
+  MoveSequence seq;
+
+  if (!move_key_unpack(key, &seq)) {
+    MoveSequence moves[MAX_SEQUENCES];
+    int num_moves = generate_all_moves(board, is_white_turn, moves);
+    int idx = move_key_find(moves, num_moves, key);
+    if (idx < 0) return;
+    seq = moves[idx];
+  }
+
+  execute_sequence(board, &seq, is_white_turn);
+}
+
+static void reset_tree(Mcts *mcts, const Board *board, bool is_white_turn) {
+  MctsNode *root = &mcts->nodes[0];
+  memset(root, 0, sizeof(*root));
+  root->mover_white = !is_white_turn;
+
+  mcts->used = 1;
+  mcts->root = 0;
+  mcts->root_board = *board;
+  mcts->root_white = is_white_turn;
+  mcts->has_root = true;
+}
+
+/* Look for the new position up to two plies below the old root (our move
+   and the opponent's reply) and make it the root. The rest of the old tree
+   stays allocated until the pool runs low, when the tree starts over. */
+static bool reroot(Mcts *mcts, const Board *board, bool is_white_turn) {
+  if (!mcts->has_root || mcts->used > (uint64_t)mcts->config.max_nodes * 3 / 4) return false;
+
+  uint64_t target = board_hash(board, is_white_turn);
+  if (board_hash(&mcts->root_board, mcts->root_white) == target) return true;
+
+  MctsNode *root = &mcts->nodes[mcts->root];
+  if (root->state != NODE_EXPANDED) return false;
+
+  for (int i = 0; i < root->num_children; i++) {
+    uint32_t c = root->first_child + i;
+    Board b1 = mcts->root_board;
+    apply_key(&b1, mcts->nodes[c].move, mcts->root_white);
+
+    if (board_hash(&b1, !mcts->root_white) == target) {
+      mcts->root = c;
+      mcts->root_board = b1;
+      mcts->root_white = !mcts->root_white;
+      return true;
+    }
+
+    MctsNode *child = &mcts->nodes[c];
+    if (child->state != NODE_EXPANDED) continue;
+
+    for (int j = 0; j < child->num_children; j++) {
+      uint32_t g = child->first_child + j;
+      Board b2 = b1;
+      apply_key(&b2, mcts->nodes[g].move, !mcts->root_white);
+
+      if (board_hash(&b2, mcts->root_white) == target) {
+        mcts->root = g;
+        mcts->root_board = b2;
+        return true;
+      }
+    }
+  }
+
+  return false;
+}
+
+// Claim and build a leaf's children; false if another thread has it
+static bool expand(Mcts *mcts, uint32_t idx, const Board *board, bool is_white_turn) {
+  MctsNode *node = &mcts->nodes[idx];
+  uint8_t expected = NODE_LEAF;
+
+  if (!__atomic_compare_exchange_n(&node->state, &expected, NODE_EXPANDING, false,
+                                   __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+    return false;
+
+  MoveSequence moves[MAX_SEQUENCES];
+  int num_moves = generate_all_moves(board, is_white_turn, moves);
+
+  /* Too many moves to list (see MAX_SEQUENCES): playouts only */
+  if (num_moves < 0) {
+    __atomic_store_n(&node->state, NODE_LEAF, __ATOMIC_RELEASE);
+    return false;
+  }
+
+  uint64_t first = ADD(mcts->used, (uint64_t)num_moves);
+  if (first + num_moves > mcts->config.max_nodes) {
+    /* Pool exhausted: leave it a leaf and keep doing playouts */
+    __atomic_store_n(&node->state, NODE_LEAF, __ATOMIC_RELEASE);
+    return false;
+  }
+
+  for (int i = 0; i < num_moves; i++) {
+    MctsNode *child = &mcts->nodes[first + i];
+    memset(child, 0, sizeof(*child));
+    child->move = move_key_pack(&moves[i]);
+    child->parent = idx;
+    child->mover_white = is_white_turn;
+  }
+
+  node->first_child = (uint32_t)first;
+  node->num_children = (uint16_t)num_moves;
+  __atomic_store_n(&node->state, NODE_EXPANDED, __ATOMIC_RELEASE);
+  return true;
+}
+
+// UCT child selection; virtual losses count as visits that were lost
+static uint32_t select_child(const Mcts *mcts, const MctsNode *node, uint64_t *rng) {
+  double parent_visits = LOAD(node->visits) + LOAD(node->virtual_loss);
+  double log_parent = log(parent_visits + 1.0);
+  double best_value = -1.0;
+  uint32_t best = node->first_child;
+
+  /* Start at a random child so unvisited ties spread across threads */
+  int n = node->num_children;
+  int offset = (int)(random_next(rng) % (uint64_t)n);
+
+  for (int k = 0; k < n; k++) {
+    uint32_t c = node->first_child + (uint32_t)((k + offset) % n);
+    const MctsNode *child = &mcts->nodes[c];
+    double visits = LOAD(child->visits) + LOAD(child->virtual_loss);
+
+    if (visits == 0) return c;
+
+    double value = LOAD(child->wins) / visits +
+                   mcts->config.exploration * sqrt(log_parent / visits);
+    if (value > best_value) {
+      best_value = value;
+      best = c;
+    }
+  }
+
+  return best;
+}
+
+// Random playout; returns true if White wins
+static bool playout(Board board, bool is_white_turn, uint64_t *rng) {
+  MoveSequence seq;
+
+  while (sample_random_move(&board, is_white_turn, rng, &seq)) {
+    execute_sequence(&board, &seq, is_white_turn);
+    is_white_turn = !is_white_turn;
+  }
+
+  return !is_white_turn;
+}
+
+// One selection / expansion / playout / backpropagation pass
+static void iterate(Mcts *mcts, uint64_t *rng) {
+  uint32_t path[MAX_SEQUENCES];
+  int length = 0;
+
+  Board board = mcts->root_board;
+  bool side = mcts->root_white;
+  uint32_t idx = mcts->root;
+
+  path[length++] = idx;
+  ADD(mcts->nodes[idx].virtual_loss, MCTS_VIRTUAL_LOSS);
+
+  while (true) {
+    MctsNode *node = &mcts->nodes[idx];
+    uint8_t state = __atomic_load_n(&node->state, __ATOMIC_ACQUIRE);
+
+    if (state == NODE_LEAF) {
+      /* Expand on the second visit (the root always) */
+      if ((idx != mcts->root && LOAD(node->visits) == 0) ||
+          !expand(mcts, idx, &board, side))
+        break;
+    } else if (state == NODE_EXPANDING) {
+      break;
+    }
+
+    if (node->num_children == 0) break;
+
+    idx = select_child(mcts, node, rng);
+    apply_key(&board, mcts->nodes[idx].move, side);
+    side = !side;
+    path[length++] = idx;
+    ADD(mcts->nodes[idx].virtual_loss, MCTS_VIRTUAL_LOSS);
+
+    if (length >= MAX_SEQUENCES) break;
+  }
+
+  bool white_wins = playout(board, side, rng);
+
+  for (int i = 0; i < length; i++) {
+    MctsNode *node = &mcts->nodes[path[i]];
+    ADD(node->visits, 1);
+    ADD(node->virtual_loss, -MCTS_VIRTUAL_LOSS);
+    if ((bool)node->mover_white == white_wins) ADD(node->wins, 1);
+  }
+
+  ADD(mcts->playouts, 1);
+}
+
+static bool search_done(Mcts *mcts) {
+  if (LOAD(mcts->stop)) return true;
+  if (mcts->config.playouts && LOAD(mcts->playouts) >= mcts->config.playouts) return true;
+  if (mcts->deadline > 0 && wall_seconds() >= mcts->deadline) return true;
+  return false;
+}
+
+typedef struct {
+  Mcts *mcts;
+  uint64_t seed;
+  PoolTask task;
+} Worker;
+
+static void worker_main(void *arg) {
+  Worker *w = arg;
+  uint64_t rng = w->seed;
+
+  while (!search_done(w->mcts)) {
+    for (int i = 0; i < 16; i++) iterate(w->mcts, &rng);
+  }
+}
+
+// Search a position, reusing the tree when the position is found in it
+bool mcts_search(Mcts *mcts, const Board *board, bool is_white_turn, MctsResult *result) {
+  if (!mcts || !board || !result) return false;
+
+  memset(result, 0, sizeof(*result));
+
+  MoveSequence moves[MAX_SEQUENCES];
+  int num_moves = generate_all_moves(board, is_white_turn, moves);
+  if (num_moves <= 0) return false;
+
+  if (!reroot(mcts, board, is_white_turn)) reset_tree(mcts, board, is_white_turn);
+  result->reused = (uint64_t)mcts->nodes[mcts->root].visits;
+
+  double start = wall_seconds();
+  mcts->playouts = 0;
+  mcts->stop = 0;
+  mcts->deadline = mcts->config.movetime_ms > 0 ? start + mcts->config.movetime_ms / 1000.0 : 0.0;
+  if (!mcts->config.playouts && mcts->deadline == 0) mcts->config.playouts = MCTS_DEF_PLAYOUTS;
+
+  int threads = mcts->config.threads;
+  Worker workers[threads];
+  uint64_t seed = board_hash(board, is_white_turn) ^ (uint64_t)(start * 1e6);
+
+  for (int t = 0; t < threads; t++) {
+    workers[t].mcts = mcts;
+    workers[t].seed = (seed + 0x9E3779B97F4A7C15ULL * (t + 1)) | 1;
+  }
+
+  /* The calling thread is worker 0; a helper that starts once the budget
+     is spent returns at once */
+  PoolGroup group = { 0 };
+  for (int t = 1; t < threads; t++)
+    pool_spawn(mcts->pool, &group, &workers[t].task, worker_main, &workers[t]);
+  worker_main(&workers[0]);
+  if (threads > 1) pool_wait(mcts->pool, &group);
+
+  /* Most visited child is the most robust choice */
+  const MctsNode *root = &mcts->nodes[mcts->root];
+  if (root->state != NODE_EXPANDED || root->num_children == 0) {
+    result->best = moves[0];
+  } else {
+    const MctsNode *best = NULL;
+    for (int i = 0; i < root->num_children; i++) {
+      const MctsNode *child = &mcts->nodes[root->first_child + i];
+      if (!best || child->visits > best->visits) best = child;
+    }
+
+    int idx = move_key_find(moves, num_moves, best->move);
+    result->best = moves[idx >= 0 ? idx : 0];
+    result->win_rate = best->visits ? (double)best->wins / best->visits : 0.0;
+  }
+
+  result->has_move = true;
+  result->playouts = mcts->playouts;
+  result->seconds = wall_seconds() - start;
+  return true;
+}
@@ -2,6 +2,8 @@
    Jumps are encoded in a compact Move type; sequences are collections
    of jumps performed by a single piece. */
 #include "move.h"
+#include "cpu.h"
+#include "profile.h"
 
 /* Direction vectors: up, right, down, left */
 static const int dir_row[4] = {-1, 0, 1, 0};
@@ -49,6 +51,22 @@ void print_move_sequence(const MoveSequence *seq) {
   printf("\n");
 }
 
+// Write a sequence as its squares joined by '-', e.g. "B3-D3-D5"
+void move_sequence_to_text(const MoveSequence *seq, char *buf) {
+  char *p = buf;
+  *p = '\0';
+  if (!seq || seq->count == 0) return;
+
+  int row, col;
+  index_to_coord(MOVE_FROM(seq->jumps[0]), &row, &col);
+  p += sprintf(p, "%c%d", 'A' + col, row + 1);
+
+  for (int i = 0; i < seq->count; i++) {
+    index_to_coord(MOVE_TO(seq->jumps[i]), &row, &col);
+    p += sprintf(p, "-%c%d", 'A' + col, row + 1);
+  }
+}
+
 // Recursively execute jumps in a MoveSequence
 void dfs_jumps(const Board *board,
                int row, int col,
@@ -58,6 +76,9 @@ void dfs_jumps(const Board *board,
                int *result_count) {
   bool found_jump = false;
 
+  /* The list is already known not to fit: no need to find the rest */
+  if (*result_count > MAX_SEQUENCES) return;
+
   for (int dir = 0; dir < 4; dir++) {
     int over_row = row + dir_row[dir];
     int over_col = col + dir_col[dir];
@@ -94,9 +115,6 @@ void dfs_jumps(const Board *board,
       dir
     );
 
-    if (current->count >= MAX_MOVES)
-      continue;
-
     current->jumps[current->count++] = jump;
 
     dfs_jumps(&next,
@@ -110,19 +128,21 @@ void dfs_jumps(const Board *board,
   }
 
   if (!found_jump && current->count > 0) {
-    results[*result_count] = *current;
+    /* Moves past the end are counted, not kept, so the caller sees the overflow */
+    if (*result_count < MAX_SEQUENCES) results[*result_count] = *current;
     (*result_count)++;
   }
 }
 
-// Generate list of all valid moves for a player
+// Generate list of all valid moves for a player; -1 if there are more than MAX_SEQUENCES
 int generate_all_moves(const Board *board,
                        bool is_white_turn,
                        MoveSequence *out_moves) {
+  PROFILE_PHASE(PROF_MOVEGEN);
   int count = 0;
   Bitboard pieces = is_white_turn ? board->white : board->black;
 
-  while (pieces) {
+  while (bb_any(pieces) && count <= MAX_SEQUENCES) {
     int idx = pop_lsb(&pieces);
     int row, col;
     index_to_coord(idx, &row, &col);
@@ -138,7 +158,40 @@ int generate_all_moves(const Board *board,
               &count);
   }
 
-  return count;
+  /* A partial list would make the search and perft silently wrong */
+  return count > MAX_SEQUENCES ? -1 : count;
+}
+
+/* Random sampling. Counting the maximal chains below each stone is much
+   cheaper than building them, so a uniform pick over every legal sequence
+   only has to materialize the one chain that was chosen. Both run on the
+   CPU-specific kernels (kernel_impl.h). */
+
+// Number of legal sequences, without generating them
+int count_all_moves(const Board *board, bool is_white_turn) {
+  PROFILE_PHASE(PROF_MOVEGEN);
+  return cpu_kernels->count_all_moves(board, is_white_turn);
+}
+
+// Stones that can jump, for n boards
+void jump_origins_batch(const Board *boards, const bool *is_white_turn,
+                        int n, Bitboard *origins) {
+  PROFILE_PHASE(PROF_MOVEGEN);
+  cpu_kernels->jump_origins_batch(boards, is_white_turn, n, origins);
+}
+
+// Legal sequence counts for n boards
+void count_all_moves_batch(const Board *boards, const bool *is_white_turn,
+                           int n, int *counts) {
+  PROFILE_PHASE(PROF_MOVEGEN);
+  cpu_kernels->count_all_moves_batch(boards, is_white_turn, n, counts);
+}
+
+// Uniformly random legal sequence; false if there is none
+bool sample_random_move(const Board *board, bool is_white_turn,
+                        uint64_t *rng, MoveSequence *out) {
+  PROFILE_PHASE(PROF_MOVEGEN);
+  return cpu_kernels->sample_random_move(board, is_white_turn, rng, out);
 }
 
 // Execute a MoveSequence on a Board
@@ -164,6 +217,74 @@ bool execute_sequence(Board *board,
   return true;
 }
 
+// Pack a sequence into a MoveKey (0 for an empty sequence)
+MoveKey move_key_pack(const MoveSequence *seq) {
+  if (!seq || seq->count == 0) return 0;
+
+  int count = seq->count < 0x1F ? seq->count : 0x1F;
+  MoveKey key = MOVE_FROM(seq->jumps[0]) | ((MoveKey)count << 8);
+
+  for (int i = 0; i < seq->count && i < MOVE_KEY_MAX_DIRS; i++)
+    key |= (MoveKey)MOVE_DIRECTION(seq->jumps[i]) << (13 + 2 * i);
+
+  return key;
+}
+
+// Rebuild a sequence from its key; false if the key is truncated
+bool move_key_unpack(MoveKey key, MoveSequence *seq) {
+  int count = MOVE_KEY_COUNT(key);
+  if (count == 0 || count > MOVE_KEY_MAX_DIRS) return false;
+
+  int row, col;
+  index_to_coord(MOVE_KEY_FROM(key), &row, &col);
+
+  seq->count = 0;
+  for (int i = 0; i < count; i++) {
+    int dir = (key >> (13 + 2 * i)) & 0x3;
+    int over_row = row + dir_row[dir], over_col = col + dir_col[dir];
+    int land_row = row + 2 * dir_row[dir], land_col = col + 2 * dir_col[dir];
+
+    if (!is_valid_position(land_row, land_col)) return false;
+
+    seq->jumps[seq->count++] = create_simple_jump(row, col, land_row, land_col,
+                                                  over_row, over_col, dir);
+    row = land_row;
+    col = land_col;
+  }
+
+  return true;
+}
+
+// Index of the move matching key in a generated list, or -1
+int move_key_find(const MoveSequence *moves, int num_moves, MoveKey key) {
+  for (int i = 0; i < num_moves; i++) {
+    if (move_key_pack(&moves[i]) == key) return i;
+  }
+
+  return -1;
+}
+
+// Map every square of a sequence through a board symmetry
+void transform_sequence(MoveSequence *seq, int sym) {
+  for (int i = 0; i < seq->count; i++) {
+    Move m = seq->jumps[i];
+    int from = transform_index(MOVE_FROM(m), sym);
+    int to = transform_index(MOVE_TO(m), sym);
+    int captured = transform_index(MOVE_CAPTURED(m), sym);
+
+    int fr, fc, tr, tc;
+    index_to_coord(from, &fr, &fc);
+    index_to_coord(to, &tr, &tc);
+
+    int dir = 0;
+    for (int d = 0; d < 4; d++) {
+      if (tr - fr == 2 * dir_row[d] && tc - fc == 2 * dir_col[d]) dir = d;
+    }
+
+    seq->jumps[i] = MOVE_ENCODE(from, to, captured, MOVE_JUMP_COUNT(m), dir);
+  }
+}
+
 // Execute an initial removal on a Board
 bool execute_initial_removal(Board *board,
                              int row, int col,
@@ -178,9 +299,6 @@ bool execute_initial_removal(Board *board,
   else
     board->white &= ~mask;
 
-  board->occupied &= ~mask;
-  board->empty |= mask;
-
   return true;
 }
 
@@ -207,13 +325,14 @@ bool is_valid_initial_removal(const Board *board,
     if (!(corner || center))
       return false;
 
-    return (board->black & mask);
+    return bb_any(board->black & mask);
   }
 
-  if (popcount(board->empty) != 1)
+  Bitboard empty = board_empty(board);
+  if (popcount(empty) != 1)
     return false;
 
-  int idx = __builtin_ctzll(board->empty);
+  int idx = bb_ctz(empty);
   int br, bc;
   index_to_coord(idx, &br, &bc);
 
@@ -221,5 +340,5 @@ bool is_valid_initial_removal(const Board *board,
         (col == bc && abs(row - br) == 1)))
     return false;
 
-  return (board->white & mask);
+  return bb_any(board->white & mask);
 }
@@ -0,0 +1,126 @@
+/* NNUE evaluator: network files and the accumulator (see nnue.h). The
+   file is a header followed by the Nnue struct as stored in memory. */
+#include "nnue.h"
+#include "ai.h"
+#include "cpu.h"
+#include "profile.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NNUE_MAGIC "KNN1"
+
+typedef struct {
+  char magic[4];
+  uint32_t board_size;
+  uint32_t hidden;
+  uint32_t l1;
+} NnueHeader;
+
+static Nnue *nnue_alloc(void) {
+  return calloc(1, sizeof(Nnue));
+}
+
+// Load a network file (for this board size); NULL if missing or malformed
+Nnue *nnue_load(const char *path) {
+  FILE *f = fopen(path, "rb");
+  if (!f) return NULL;
+
+  NnueHeader header;
+  Nnue *net = nnue_alloc();
+  bool ok = net && fread(&header, sizeof(header), 1, f) == 1 &&
+            memcmp(header.magic, NNUE_MAGIC, 4) == 0 && header.board_size == BOARD_SIZE &&
+            header.hidden == NNUE_HIDDEN && header.l1 == NNUE_L1 &&
+            fread(net, sizeof(Nnue), 1, f) == 1;
+  fclose(f);
+
+  if (!ok) {
+    free(net);
+    return NULL;
+  }
+  return net;
+}
+
+bool nnue_save(const Nnue *net, const char *path) {
+  FILE *f = fopen(path, "wb");
+  if (!f) return false;
+
+  NnueHeader header = { .board_size = BOARD_SIZE, .hidden = NNUE_HIDDEN, .l1 = NNUE_L1 };
+  memcpy(header.magic, NNUE_MAGIC, 4);
+
+  bool ok = fwrite(&header, sizeof(header), 1, f) == 1 && fwrite(net, sizeof(Nnue), 1, f) == 1;
+  return fclose(f) == 0 && ok;
+}
+
+void nnue_free(Nnue *net) {
+  free(net);
+}
+
+/* Each own stone adds its square's value (material plus the corner or
+   edge bonus) to one accumulator entry, square % NNUE_HIDDEN, so no entry
+   leaves 0..127. Layer 1 takes half the difference of the two views'
+   sums, once as is and once negated so the clipping keeps either sign,
+   and the output doubles it back. */
+Nnue *nnue_bootstrap(void) {
+  Nnue *net = nnue_alloc();
+  if (!net) return NULL;
+
+  for (int sq = 0; sq < TOTAL_CELLS; sq++) {
+    Bitboard bit = BB_BIT(sq);
+    int value = eval_weights[EVAL_MATERIAL] + (bb_any(bit & CORNER_MASK) ? eval_weights[EVAL_CORNER] :
+                                               bb_any(bit & EDGE_MASK) ? eval_weights[EVAL_EDGE] : 0);
+    net->ft_weights[sq][sq % NNUE_HIDDEN] = (int16_t)value;
+  }
+
+  /* 32 * diff >> NNUE_L1_SHIFT is diff / 2; 32 * (diff / 2) >> NNUE_OUT_SHIFT is diff */
+  for (int i = 0; i < NNUE_HIDDEN; i++) {
+    net->l1_weights[0][i] = 32;
+    net->l1_weights[0][NNUE_HIDDEN + i] = -32;
+    net->l1_weights[1][i] = -32;
+    net->l1_weights[1][NNUE_HIDDEN + i] = 32;
+  }
+  net->out_weights[0] = 32;
+  net->out_weights[1] = -32;
+
+  return net;
+}
+
+// Accumulator from scratch
+void nnue_refresh(const Nnue *net, const Board *board, NnueAccumulator *acc) {
+  PROFILE_PHASE(PROF_EVAL);
+  for (int p = 0; p < 2; p++) {
+    Bitboard own = p == 0 ? board->white : board->black;
+    Bitboard opp = p == 0 ? board->black : board->white;
+    int16_t *v = acc->v[p];
+
+    memcpy(v, net->ft_bias, sizeof(net->ft_bias));
+    for (; bb_any(own); own = bb_clear_lsb(own)) {
+      const int16_t *row = net->ft_weights[bb_ctz(own)];
+      for (int k = 0; k < NNUE_HIDDEN; k++) v[k] += row[k];
+    }
+    for (; bb_any(opp); opp = bb_clear_lsb(opp)) {
+      const int16_t *row = net->ft_weights[TOTAL_CELLS + bb_ctz(opp)];
+      for (int k = 0; k < NNUE_HIDDEN; k++) v[k] += row[k];
+    }
+  }
+}
+
+// Accumulator after a move by white_moved (out may be in)
+void nnue_update(const Nnue *net, const NnueAccumulator *in, NnueAccumulator *out,
+                 const MoveSequence *seq, bool white_moved) {
+  PROFILE_PHASE(PROF_EVAL);
+  cpu_kernels->nnue_update(net, in, out, seq, white_moved);
+}
+
+// Score from the side to move's point of view
+int nnue_evaluate(const Nnue *net, const NnueAccumulator *acc, bool white_to_move) {
+  PROFILE_PHASE(PROF_EVAL);
+  return cpu_kernels->nnue_output(net, acc, white_to_move);
+}
+
+// Refresh and evaluate in one go
+int nnue_eval_position(const Nnue *net, const Board *board, bool white_to_move) {
+  NnueAccumulator acc;
+  nnue_refresh(net, board, &acc);
+  return nnue_evaluate(net, &acc, white_to_move);
+}
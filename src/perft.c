@@ -4,53 +4,162 @@
 #include "ai.h"
 #include "move.h"
 #include "board.h"
+#include "tt.h"
+#include "mcts.h"
+#include "pool.h"
+#include "profile.h"
 #include <stdio.h>
 #include <stdint.h>
 #include <time.h>
 #include <stdlib.h>
 #include <limits.h>
 
-// Recursive perft node counter
-static uint64_t perft_nodes_internal(Board *board, bool is_white_turn, int depth, int *ply) {
-  (*ply)++;
-  
-  if (depth == 0) {
-    (*ply)--;
-    return 1;  // Leaf node
-  }
+// Position after the standard removals: the centre stone, then the one left of it
+void perft_start_position(Board *board) {
+  init_board(board);
+  execute_initial_removal(board, BOARD_CENTER, BOARD_CENTER, true);
+  execute_initial_removal(board, BOARD_CENTER, BOARD_CENTER - 1, false);
+}
 
-  MoveSequence moves[MAX_SEQUENCES];
+/* Recursive perft node counter. `lists` holds `depth` move lists of
+   MAX_SEQUENCES, one per ply, so no frame keeps a list of its own. */
+static uint64_t perft_nodes_internal(Board *board, bool is_white_turn, int depth,
+                                     MoveSequence *lists) {
+  PROFILE_PHASE(PROF_PERFT);
+
+  if (depth == 0) return 1;  // Leaf node
+
+  MoveSequence *moves = lists;
   int num_moves = generate_all_moves(board, is_white_turn, moves);
   
-  if (num_moves == 0) {
-    (*ply)--;
-    return 1;
-  }
+  if (num_moves <= 0) return num_moves == 0;   // no move: a leaf; too many to list: no count
 
   uint64_t total = 0;
   for (int i = 0; i < num_moves; i++) {
     Board bcopy = *board;
     
     // Skip if move execution fails
-    if (!execute_sequence(&bcopy, &moves[i], is_white_turn)) {
-      printf("WARNING: Failed to execute valid move at ply %d\n", *ply);
-      continue;
-    }
+    if (!execute_sequence(&bcopy, &moves[i], is_white_turn)) continue;
     
-    total += perft_nodes_internal(&bcopy, !is_white_turn, depth - 1, ply);
+    uint64_t nodes = perft_nodes_internal(&bcopy, !is_white_turn, depth - 1,
+                                          lists + MAX_SEQUENCES);
+    if (nodes == 0) return 0;
+    total += nodes;
   }
   
-  (*ply)--;
   return total;
 }
 
+// 0 when a position on the way has more moves than MAX_SEQUENCES
 uint64_t perft_nodes(const Board *board, bool is_white_turn, int depth) {
   if (!board || depth < 0) return 0;
   
+  if (depth == 0) return 1;
+
+  MoveSequence *lists = malloc((size_t)depth * MAX_SEQUENCES * sizeof(MoveSequence));
+  if (!lists) return 0;
+
   // Create a mutable copy
   Board bcopy = *board;
-  int ply = 0;
-  return perft_nodes_internal(&bcopy, is_white_turn, depth, &ply);
+  uint64_t nodes = perft_nodes_internal(&bcopy, is_white_turn, depth, lists);
+  free(lists);
+  return nodes;
+}
+
+/* Parallel perft: a node with more than serial_depth plies left is a pool
+   task that spawns one task per child and waits for them; below that the
+   serial counter takes over.
+
+   Each worker owns serial_depth move lists (at least one). A task is
+   done with them before it can yield the worker: the serial counter
+   never waits, and a parallel node builds every child before the first
+   spawn, which may run the child inline. */
+typedef struct {
+  Pool *pool;
+  int serial_depth;
+  int lists_per_worker;
+  MoveSequence *lists;
+} PerftRun;
+
+typedef struct {
+  PerftRun *run;
+  Board board;
+  bool is_white_turn;
+  int depth;
+  uint64_t nodes;
+} PerftTask;
+
+static void perft_task(void *arg) {
+  PerftTask *t = arg;
+  PerftRun *run = t->run;
+  MoveSequence *moves = run->lists + (size_t)pool_worker_id(run->pool) *
+                                     run->lists_per_worker * MAX_SEQUENCES;
+
+  if (t->depth <= run->serial_depth) {
+    t->nodes = perft_nodes_internal(&t->board, t->is_white_turn, t->depth, moves);
+    return;
+  }
+
+  int num_moves = generate_all_moves(&t->board, t->is_white_turn, moves);
+  if (num_moves <= 0) {
+    t->nodes = num_moves == 0;   // a node with no move is a leaf; 0 = no count
+    return;
+  }
+
+  PerftTask *children = malloc(num_moves * sizeof(PerftTask));
+  PoolTask *tasks = malloc(num_moves * sizeof(PoolTask));
+  if (!children || !tasks) {
+    free(children);
+    free(tasks);
+    t->nodes = 0;
+    return;
+  }
+
+  int count = 0;
+  for (int i = 0; i < num_moves; i++) {
+    children[count] = (PerftTask){ run, t->board, !t->is_white_turn, t->depth - 1, 0 };
+    if (execute_sequence(&children[count].board, &moves[i], t->is_white_turn)) count++;
+  }
+
+  PoolGroup group = { 0 };
+  for (int i = 0; i < count; i++)
+    pool_spawn(run->pool, &group, &tasks[i], perft_task, &children[i]);
+  pool_wait(run->pool, &group);
+
+  t->nodes = 0;
+  for (int i = 0; i < count; i++) {
+    if (children[i].nodes == 0) {
+      t->nodes = 0;
+      break;
+    }
+    t->nodes += children[i].nodes;
+  }
+  free(children);
+  free(tasks);
+}
+
+uint64_t perft_nodes_parallel(Pool *pool, const Board *board, bool is_white_turn, int depth,
+                              int serial_depth) {
+  if (!pool || !board || depth < 0) return 0;
+
+  PerftRun run = { pool, serial_depth < 0 ? 0 : serial_depth, 0, NULL };
+  run.lists_per_worker = run.serial_depth > 1 ? run.serial_depth : 1;
+  run.lists = malloc((size_t)pool_threads(pool) * run.lists_per_worker *
+                     MAX_SEQUENCES * sizeof(MoveSequence));
+  if (!run.lists) return 0;
+
+  PerftTask root = { &run, *board, is_white_turn, depth, 0 };
+  PoolGroup group = { 0 };
+  PoolTask task;
+
+  if (pool_worker_id(pool) >= 0) {
+    perft_task(&root);
+  } else {
+    pool_spawn(pool, &group, &task, perft_task, &root);
+    pool_wait(pool, &group);
+  }
+  free(run.lists);
+  return root.nodes;
 }
 
 void perft_divide(const Board *board, bool is_white_turn, int depth) {
@@ -66,6 +175,10 @@ void perft_divide(const Board *board, bool is_white_turn, int depth) {
     printf("No legal moves from this position\n");
     return;
   }
+  if (num_moves < 0) {
+    printf("More than %d legal moves from this position\n", MAX_SEQUENCES);
+    return;
+  }
 
   printf("\nPerft Divide - Depth %d\n", depth);
   printf("========================\n");
@@ -110,12 +223,12 @@ void perft_test_suite(void) {
   Board board1;
   init_board(&board1);
   
-  // Do standard opening: Black D4, White D3
-  if (!execute_initial_removal(&board1, 3, 3, true)) {
+  // Do standard opening: Black D4, White C4 (on 7x7)
+  if (!execute_initial_removal(&board1, BOARD_CENTER, BOARD_CENTER, true)) {
     printf("Failed to setup test position\n");
     return;
   }
-  if (!execute_initial_removal(&board1, 3, 2, false)) {
+  if (!execute_initial_removal(&board1, BOARD_CENTER, BOARD_CENTER - 1, false)) {
     printf("Failed to setup test position\n");
     return;
   }
@@ -145,35 +258,22 @@ void perft_test_suite(void) {
   // Test 2: Simple forced jump position
   printf("\nTest 2: Forced jump position\n");
   Board board2;
-  init_board(&board2);
-  
-  // Create: White at B2, Black at B3, empty at B4
-  // Clear the board
-  board2.white = 0;
-  board2.black = 0;
-  board2.occupied = 0;
-  board2.empty = VALID_MASK;
   
-  // Setup forced jump
-  set_white(&board2, 1, 1);  // B2
-  set_black(&board2, 1, 2);  // B3
-  // B4 is already empty
+  // White at B2, Black at C2, D2 empty
+  board2 = (Board){ 0 };
+  set_white(&board2, 1, 1);
+  set_black(&board2, 1, 2);
   
   print_board(&board2);
   
   printf("Depth 1 (White to move): ");
   uint64_t nodes2 = perft_nodes(&board2, true, 1);
-  printf("%llu nodes (expected: 1 - forced jump B2->B4)\n", 
+  printf("%llu nodes (expected: 1 - forced jump B2->D2)\n", 
          (unsigned long long)nodes2);
   
   // Test 3: Empty board (no moves for anyone)
   printf("\nTest 3: Empty board\n");
-  Board board3;
-  init_board(&board3);
-  board3.white = 0;
-  board3.black = 0;
-  board3.occupied = 0;
-  board3.empty = VALID_MASK;
+  Board board3 = { 0 };
   
   printf("Depth 1 (White to move): ");
   uint64_t nodes3 = perft_nodes(&board3, true, 1);
@@ -205,12 +305,12 @@ void perft_diagnostic(void) {
   
   // Do opening removals
   printf("\n3. Performing opening removals...\n");
-  if (!execute_initial_removal(&board, 3, 3, true)) {
-    printf("   Failed to remove black stone at D4\n");
+  if (!execute_initial_removal(&board, BOARD_CENTER, BOARD_CENTER, true)) {
+    printf("   Failed to remove the centre black stone\n");
   }
   
-  if (!execute_initial_removal(&board, 3, 2, false)) {
-    printf("   Failed to remove white stone at D3\n");
+  if (!execute_initial_removal(&board, BOARD_CENTER, BOARD_CENTER - 1, false)) {
+    printf("   Failed to remove the white stone next to it\n");
   }
   
   printf("Board after opening:\n");
@@ -241,13 +341,22 @@ void perft_diagnostic(void) {
 
 void perft_menu(void) {
   while (1) {
-    printf("\n-- Perft / Performance Tests --\n");
+    printf("\n-- Perft / Performance Tests (%dx%d, kernels: %s) --\n", BOARD_SIZE, BOARD_SIZE,
+           cpu_kernels->name);
     printf("(1) Perft nodes (single depth)\n");
     printf("(2) Perft divide (show per-move counts)\n");
     printf("(3) Negamax benchmark\n");
     printf("(4) Run preset suite\n");
     printf("(5) Diagnostic tests\n");
     printf("(6) Test suite (known positions)\n");
+    printf("(7) Persistent engine benchmark\n");
+    printf("(8) Latency-bounded async search\n");
+    printf("(9) MCTS playout throughput\n");
+    printf("(10) MCTS vs Negamax match\n");
+    printf("(11) Random playouts: enumerate vs sampler\n");
+    printf("(12) Board kernels per CPU variant\n");
+    printf("(13) Batched move counting and evaluation (4 boards per AVX2 step)\n");
+    printf("(14) Work-stealing pool: parallel perft and task overhead\n");
     printf("(0) Back\n");
     printf("> ");
 
@@ -256,12 +365,9 @@ void perft_menu(void) {
 
     if (cmd == 0) break;
 
-    Board board;
-    init_board(&board);
-    
     // Do standard opening for most tests
-    execute_initial_removal(&board, 3, 3, true);
-    execute_initial_removal(&board, 3, 2, false);
+    Board board;
+    perft_start_position(&board);
 
     switch (cmd) {
       case 1: {
@@ -282,10 +388,11 @@ void perft_menu(void) {
         int iterations = 10;
         printf("Depth: "); scanf("%d", &depth);
         printf("Iterations: "); scanf("%d", &iterations);
-        uint64_t nodes = 0;
-        double t = perft_benchmark_negamax(&board, false, depth, iterations, &nodes);
+        SearchStats stats;
+        double t = perft_benchmark_negamax(&board, false, depth, iterations, &stats);
         printf("Negamax benchmark: iterations=%d, depth=%d, total_time=%.4fs, avg=%.6fs, nodes=%llu\n",
-               iterations, depth, t, t / iterations, (unsigned long long)nodes);
+               iterations, depth, t, t / iterations, (unsigned long long)stats.nodes);
+        print_search_stats(&stats);
         break;
       }
       case 4: {
@@ -305,65 +412,88 @@ void perft_menu(void) {
       case 6:
         perft_test_suite();
         break;
+      case 7: {
+        int depth = DEF_DEPTH;
+        int plies = 20;
+        printf("Depth: "); scanf("%d", &depth);
+        printf("Plies: "); scanf("%d", &plies);
+        perft_benchmark_engine(&board, false, depth, plies);
+        break;
+      }
+      case 8: {
+        int movetime = 50;
+        int plies = 20;
+        printf("Reply bound (ms): "); scanf("%d", &movetime);
+        printf("Plies: "); scanf("%d", &plies);
+        perft_benchmark_latency(&board, false, movetime, plies);
+        break;
+      }
+      case 9: {
+        int playouts = MCTS_DEF_PLAYOUTS;
+        printf("Playouts: "); scanf("%d", &playouts);
+        perft_benchmark_mcts(&board, false, playouts);
+        break;
+      }
+      case 10: {
+        int games = 10;
+        int movetime = 100;
+        int depth = DEF_DEPTH;
+        printf("Games: "); scanf("%d", &games);
+        printf("MCTS time per move (ms): "); scanf("%d", &movetime);
+        printf("Negamax depth: "); scanf("%d", &depth);
+        perft_match_mcts(games, movetime, depth);
+        break;
+      }
+      case 11: {
+        int playouts = 100000;
+        printf("Playouts: "); scanf("%d", &playouts);
+        perft_benchmark_playouts(&board, false, playouts);
+        break;
+      }
+      case 12: {
+        int rounds = 20;
+        printf("Rounds: "); scanf("%d", &rounds);
+        perft_benchmark_kernels(&board, false, rounds);
+        break;
+      }
+      case 13: {
+        int rounds = 20;
+        printf("Rounds: "); scanf("%d", &rounds);
+        perft_benchmark_batch(&board, false, rounds);
+        break;
+      }
+      case 14: {
+        int depth = 6;
+        int threads = 0;
+        printf("Depth: "); scanf("%d", &depth);
+        printf("Threads (0 = one per CPU): "); scanf("%d", &threads);
+        perft_benchmark_pool(&board, false, depth, threads, false);
+        break;
+      }
       default:
         printf("Unknown command\n");
     }
-  }
-}
 
-// Benchmark wrapper: runs negamax repeatedly and counts nodes
-double perft_benchmark_negamax(const Board *board, bool is_white_turn, 
-                              int depth, int iterations, uint64_t *nodes_out) {
-  if (!board || depth <= 0 || iterations <= 0) {
-    if (nodes_out) *nodes_out = 0;
-    return 0.0;
-  }
-  
-  uint64_t total_nodes = 0;
-  
-  // Modified negamax that counts nodes
-  int negamax_with_counter(Board *b, int d, bool is_white, 
-                          int alpha, int beta, uint64_t *counter) {
-    if (counter) (*counter)++;
-    
-    if (d == 0) {
-      return eval_position(b, is_white);
-    }
-    
-    MoveSequence moves[MAX_SEQUENCES];
-    int num_moves = generate_all_moves(b, is_white, moves);
-    
-    if (num_moves == 0) {
-      return -10000 + d;
-    }
-    
-    int best_score = INT_MIN;
-    
-    for (int i = 0; i < num_moves; i++) {
-      Board bcopy = *b;
-      if (!execute_sequence(&bcopy, &moves[i], is_white)) {
-        continue;
-      }
-      
-      int score = -negamax_with_counter(&bcopy, d - 1, !is_white, 
-                                      -beta, -alpha, counter);
-      
-      if (score > best_score) best_score = score;
-      if (score > alpha) alpha = score;
-      if (alpha >= beta) break;
+    /* PROFILE=1 builds: the phases of this test alone */
+    if (profile_active()) {
+      profile_report(stdout);
+      profile_reset();
     }
-    
-    return best_score;
   }
-  
-  // Count nodes for one search
-  Board bcopy = *board;
-  uint64_t nodes_per_search = 0;
-  (void)negamax_with_counter(&bcopy, depth, is_white_turn, 
-                            INT_MIN, INT_MAX, &nodes_per_search);
-  
-  if (nodes_out) {
-    *nodes_out = nodes_per_search;
+}
+
+// Benchmark wrapper: times repeated negamax searches; stats_out gets one search's counts
+double perft_benchmark_negamax(const Board *board, bool is_white_turn,
+                              int depth, int iterations, SearchStats *stats_out) {
+  if (stats_out) search_stats_reset(stats_out);
+  if (!board || depth <= 0 || iterations <= 0) return 0.0;
+
+  // Count one search
+  if (stats_out) {
+    Board bcopy = *board;
+    double start = wall_seconds();
+    negamax_with_stats(&bcopy, depth, is_white_turn, INT_MIN, INT_MAX, NULL, stats_out);
+    stats_out->seconds = wall_seconds() - start;
   }
   
   // Time multiple iterations
@@ -377,3 +507,549 @@ double perft_benchmark_negamax(const Board *board, bool is_white_turn,
   double elapsed_seconds = (double)(end - start) / (double)CLOCKS_PER_SEC;
   return elapsed_seconds;
 }
+
+/* Play a game against itself at a fixed depth, once with a fresh engine
+   for every move and once with one engine kept for the whole game, and
+   compare per-move latency. */
+void perft_benchmark_engine(const Board *board, bool is_white_turn, int depth, int plies) {
+  if (!board || depth <= 0 || plies <= 0) return;
+
+  for (int pass = 0; pass < 2; pass++) {
+    bool persistent = (pass == 1);
+    Engine *eng = engine_create(TT_DEF_MB);
+    if (!eng) return;
+
+    Board b = *board;
+    bool white = is_white_turn;
+    int played = 0;
+    double first_secs = 0.0, total_secs = 0.0;
+    uint64_t probes = 0, hits = 0;
+
+    for (; played < plies; played++) {
+      if (!persistent) {
+        probes += eng->tt->probes;
+        hits += eng->tt->hits;
+        engine_new_game(eng);
+      }
+
+      MoveSequence best;
+      clock_t start = clock();
+      bool ok = engine_best_move(eng, &b, white, depth, &best, NULL);
+      double secs = (double)(clock() - start) / CLOCKS_PER_SEC;
+      if (!ok) break;
+
+      if (played < 4) first_secs += secs;
+      total_secs += secs;
+
+      execute_sequence(&b, &best, white);
+      white = !white;
+    }
+
+    probes += eng->tt->probes;
+    hits += eng->tt->hits;
+
+    int later = played > 4 ? played - 4 : 0;
+    printf("%s: %d plies, total=%.4fs, first 4 avg=%.6fs, later avg=%.6fs, hash hits=%.1f%%, pv hits=%llu\n",
+           persistent ? "Persistent engine" : "Fresh per move   ",
+           played, total_secs, first_secs / (played < 4 ? (played ? played : 1) : 4),
+           later ? (total_secs - first_secs) / later : 0.0,
+           probes ? 100.0 * hits / probes : 0.0,
+           (unsigned long long)eng->pv_hits);
+
+    engine_free(eng);
+  }
+}
+
+/* Self-play where every move is an asynchronous search bounded by
+   movetime_ms; reports the reply latency the caller observes. */
+void perft_benchmark_latency(const Board *board, bool is_white_turn, int movetime_ms, int plies) {
+  if (!board || movetime_ms <= 0 || plies <= 0) return;
+
+  Engine *eng = engine_create(TT_DEF_MB);
+  if (!eng) return;
+
+  Board b = *board;
+  bool white = is_white_turn;
+  double worst = 0.0, total = 0.0;
+  int played = 0, depth_sum = 0;
+
+  for (; played < plies; played++) {
+    SearchResult result;
+    double start = wall_seconds();
+
+    /* The engine's own deadline stops it; the timed wait is the backstop */
+    SearchLimits limits = { .movetime_ms = movetime_ms };
+    if (!engine_start(eng, &b, white, &limits)) break;
+    bool ok = engine_wait(eng, &result, movetime_ms);
+    double latency = wall_seconds() - start;
+
+    if (!ok) break;
+
+    if (latency > worst) worst = latency;
+    total += latency;
+    depth_sum += result.depth;
+
+    execute_sequence(&b, &result.best, white);
+    white = !white;
+  }
+
+  printf("Async search: %d plies, bound=%dms, avg latency=%.2fms, worst=%.2fms, avg depth=%.1f\n",
+         played, movetime_ms, played ? total * 1000.0 / played : 0.0, worst * 1000.0,
+         played ? (double)depth_sum / played : 0.0);
+
+  engine_free(eng);
+}
+
+/* Playouts per second from one position for 1, 2, 4, ... threads up to
+   the number of online CPUs. */
+void perft_benchmark_mcts(const Board *board, bool is_white_turn, int playouts) {
+  if (!board || playouts <= 0) return;
+
+  MctsConfig config = mcts_default_config();
+  Mcts *probe = mcts_create(&config);
+  if (!probe) return;
+  int max_threads = probe->config.threads;
+  mcts_free(probe);
+
+  for (int threads = 1; ; threads *= 2) {
+    if (threads > max_threads) threads = max_threads;
+
+    config.threads = threads;
+    config.playouts = (uint64_t)playouts;
+    Mcts *mcts = mcts_create(&config);
+    if (!mcts) return;
+
+    MctsResult result;
+    if (mcts_search(mcts, board, is_white_turn, &result)) {
+      printf("MCTS: threads=%d, playouts=%llu, time=%.4fs, playouts/s=%.0f, best win rate=%.1f%%\n",
+             threads, (unsigned long long)result.playouts, result.seconds,
+             result.seconds > 0 ? result.playouts / result.seconds : 0.0,
+             result.win_rate * 100.0);
+    }
+    mcts_free(mcts);
+
+    if (threads == max_threads) break;
+  }
+}
+
+/* Headless games from the standard opening, MCTS (fixed time per move)
+   against the persistent negamax engine (fixed depth), colours alternating. */
+void perft_match_mcts(int games, int movetime_ms, int depth) {
+  if (games <= 0 || movetime_ms <= 0 || depth <= 0) return;
+
+  MctsConfig config = mcts_default_config();
+  config.movetime_ms = movetime_ms;
+  config.playouts = 0;
+
+  int mcts_wins = 0;
+  double mcts_secs = 0.0, negamax_secs = 0.0;
+
+  for (int g = 0; g < games; g++) {
+    bool mcts_white = (g % 2 == 1);
+    Mcts *mcts = mcts_create(&config);
+    Engine *eng = engine_create(TT_DEF_MB);
+    if (!mcts || !eng) {
+      mcts_free(mcts);
+      engine_free(eng);
+      return;
+    }
+
+    Board b;
+    perft_start_position(&b);
+
+    bool white = false;
+    int plies = 0;
+
+    while (true) {
+      MoveSequence best;
+      bool ok;
+      double start = wall_seconds();
+
+      if (white == mcts_white) {
+        MctsResult result;
+        ok = mcts_search(mcts, &b, white, &result);
+        best = result.best;
+        mcts_secs += wall_seconds() - start;
+      } else {
+        ok = engine_best_move(eng, &b, white, depth, &best, NULL);
+        negamax_secs += wall_seconds() - start;
+      }
+
+      /* Side to move with no moves loses */
+      if (!ok) {
+        if (white != mcts_white) mcts_wins++;
+        break;
+      }
+
+      execute_sequence(&b, &best, white);
+      white = !white;
+      plies++;
+    }
+
+    printf(" game %d: MCTS as %s %s after %d plies\n", g + 1,
+           mcts_white ? "White" : "Black", white != mcts_white ? "won" : "lost", plies);
+
+    mcts_free(mcts);
+    engine_free(eng);
+  }
+
+  printf("MCTS vs Negamax(depth %d): %d-%d, MCTS time=%.2fs, Negamax time=%.2fs\n",
+         depth, mcts_wins, games - mcts_wins, mcts_secs, negamax_secs);
+}
+
+/* Random games to the end, picking each move from the full generated list
+   and then with sample_random_move; both draw the same moves for the same
+   random stream, so the two passes play identical games. */
+void perft_benchmark_playouts(const Board *board, bool is_white_turn, int playouts) {
+  if (!board || playouts <= 0) return;
+
+  double secs[2];
+  uint64_t plies[2];
+
+  for (int pass = 0; pass < 2; pass++) {
+    uint64_t rng = 0x9E3779B97F4A7C15ULL;
+    plies[pass] = 0;
+    clock_t start = clock();
+
+    for (int i = 0; i < playouts; i++) {
+      Board b = *board;
+      bool white = is_white_turn;
+      MoveSequence seq;
+
+      while (true) {
+        if (pass == 0) {
+          MoveSequence moves[MAX_SEQUENCES];
+          int num_moves = generate_all_moves(&b, white, moves);
+          if (num_moves <= 0) break;
+          seq = moves[random_next(&rng) % (uint64_t)num_moves];
+        } else if (!sample_random_move(&b, white, &rng, &seq)) {
+          break;
+        }
+
+        execute_sequence(&b, &seq, white);
+        white = !white;
+        plies[pass]++;
+      }
+    }
+
+    secs[pass] = (double)(clock() - start) / CLOCKS_PER_SEC;
+    printf("%s: %d playouts, %llu plies, time=%.4fs, playouts/s=%.0f\n",
+           pass ? "Sampler  " : "Enumerate", playouts, (unsigned long long)plies[pass],
+           secs[pass], secs[pass] > 0 ? playouts / secs[pass] : 0.0);
+  }
+
+  if (plies[0] != plies[1]) printf("Warning: the two passes played different games\n");
+  if (secs[1] > 0) printf("Speedup: %.2fx\n", secs[0] / secs[1]);
+}
+
+/* Every position of random games from board until count are collected;
+   parents and moves (when given) get the position before and the move
+   that led to each one */
+static void random_game_positions(const Board *board, bool is_white_turn, int count,
+                                  Board *positions, bool *sides, Board *parents,
+                                  MoveSequence *moves) {
+  uint64_t rng = 0x9E3779B97F4A7C15ULL;
+  int n = 0;
+
+  while (n < count) {
+    Board b = *board;
+    bool white = is_white_turn;
+    MoveSequence seq;
+
+    while (n < count && sample_random_move(&b, white, &rng, &seq)) {
+      if (parents) parents[n] = b;
+      if (moves) moves[n] = seq;
+      execute_sequence(&b, &seq, white);
+      white = !white;
+      positions[n] = b;
+      sides[n++] = white;
+    }
+  }
+}
+
+/* Time the board kernels of every variant this processor supports on
+   the positions of a few random games, checking they agree */
+void perft_benchmark_kernels(const Board *board, bool is_white_turn, int rounds) {
+  if (!board || rounds <= 0) return;
+
+  enum { NUM_POSITIONS = 4096 };
+  Board *positions = malloc(NUM_POSITIONS * sizeof(Board));
+  bool *sides = malloc(NUM_POSITIONS * sizeof(bool));
+  if (!positions || !sides) {
+    free(positions);
+    free(sides);
+    return;
+  }
+
+  random_game_positions(board, is_white_turn, NUM_POSITIONS, positions, sides, NULL, NULL);
+
+  CpuLevel best = cpu_detect();
+  printf("Active kernels: %s (best supported: %s)\n", cpu_kernels->name, cpu_kernels_for(best)->name);
+
+  double base_secs = 0.0;
+  int64_t base_sum = 0;
+  for (CpuLevel level = CPU_BASELINE; level <= best; level++) {
+    const CpuKernels *k = cpu_kernels_for(level);
+    int64_t sum = 0;
+    clock_t start = clock();
+
+    for (int r = 0; r < rounds; r++) {
+      for (int i = 0; i < NUM_POSITIONS; i++) {
+        sum += k->eval_position(&positions[i], sides[i]);
+        sum += k->count_all_moves(&positions[i], sides[i]);
+        sum += k->popcount(board_occupied(&positions[i]));
+      }
+    }
+
+    double secs = (double)(clock() - start) / CLOCKS_PER_SEC;
+    double per_sec = secs > 0 ? (double)rounds * NUM_POSITIONS / secs : 0.0;
+    if (level == CPU_BASELINE) {
+      base_secs = secs;
+      base_sum = sum;
+    }
+
+    printf("  %-12s %d positions x %d, time=%.4fs, %.0f positions/s", k->name,
+           NUM_POSITIONS, rounds, secs, per_sec);
+    if (level != CPU_BASELINE && secs > 0) printf(", %.2fx baseline", base_secs / secs);
+    if (sum != base_sum) printf("  MISMATCH");
+    printf("\n");
+  }
+
+  free(positions);
+  free(sides);
+}
+
+/* Jump origins, move counts and evaluations over a batch of random game
+   positions: one call per board against the batch call, for every
+   supported variant, checking the results agree */
+void perft_benchmark_batch(const Board *board, bool is_white_turn, int rounds) {
+  if (!board || rounds <= 0) return;
+
+  enum { NUM_POSITIONS = 4096 };
+  Board *positions = malloc(NUM_POSITIONS * sizeof(Board));
+  bool *sides = malloc(NUM_POSITIONS * sizeof(bool));
+  Bitboard *origins = malloc(NUM_POSITIONS * sizeof(Bitboard));
+  int *counts = malloc(NUM_POSITIONS * sizeof(int));
+  int *scores = malloc(NUM_POSITIONS * sizeof(int));
+  if (!positions || !sides || !origins || !counts || !scores) {
+    free(positions);
+    free(sides);
+    free(origins);
+    free(counts);
+    free(scores);
+    return;
+  }
+
+  random_game_positions(board, is_white_turn, NUM_POSITIONS, positions, sides, NULL, NULL);
+
+  int64_t expected = 0, expected_eval = 0;
+  for (int i = 0; i < NUM_POSITIONS; i++) {
+    expected += count_all_moves(&positions[i], sides[i]);
+    expected_eval += eval_position(&positions[i], sides[i]);
+  }
+
+  CpuLevel best = cpu_detect();
+  for (CpuLevel level = CPU_BASELINE; level <= best; level++) {
+    const CpuKernels *k = cpu_kernels_for(level);
+    double secs[5];
+    int64_t sums[5] = { 0, 0, 0, 0, 0 };
+    Bitboard check = BB_ZERO;
+
+    clock_t start = clock();
+    for (int r = 0; r < rounds; r++) {
+      k->jump_origins_batch(positions, sides, NUM_POSITIONS, origins);
+      check ^= origins[r % NUM_POSITIONS];
+    }
+    secs[0] = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    start = clock();
+    for (int r = 0; r < rounds; r++) {
+      for (int i = 0; i < NUM_POSITIONS; i++) sums[1] += k->count_all_moves(&positions[i], sides[i]);
+    }
+    secs[1] = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    start = clock();
+    for (int r = 0; r < rounds; r++) {
+      k->count_all_moves_batch(positions, sides, NUM_POSITIONS, counts);
+      for (int i = 0; i < NUM_POSITIONS; i++) sums[2] += counts[i];
+    }
+    secs[2] = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    start = clock();
+    for (int r = 0; r < rounds; r++) {
+      for (int i = 0; i < NUM_POSITIONS; i++) sums[3] += k->eval_position(&positions[i], sides[i]);
+    }
+    secs[3] = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    start = clock();
+    for (int r = 0; r < rounds; r++) {
+      k->eval_batch(positions, NUM_POSITIONS, sides, scores);
+      for (int i = 0; i < NUM_POSITIONS; i++) sums[4] += scores[i];
+    }
+    secs[4] = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    double total = (double)rounds * NUM_POSITIONS;
+    printf("  %-12s origins %.0f positions/s\n", k->name, secs[0] > 0 ? total / secs[0] : 0.0);
+    printf("  %-12s counts  %.0f positions/s one by one, %.0f batched (%.2fx)", "",
+           secs[1] > 0 ? total / secs[1] : 0.0, secs[2] > 0 ? total / secs[2] : 0.0,
+           secs[2] > 0 ? secs[1] / secs[2] : 0.0);
+    if (sums[1] != expected * rounds || sums[2] != expected * rounds) printf("  MISMATCH");
+    printf("\n");
+    printf("  %-12s eval    %.0f positions/s one by one, %.0f batched (%.2fx)", "",
+           secs[3] > 0 ? total / secs[3] : 0.0, secs[4] > 0 ? total / secs[4] : 0.0,
+           secs[4] > 0 ? secs[3] / secs[4] : 0.0);
+    if (sums[3] != expected_eval * rounds || sums[4] != expected_eval * rounds) printf("  MISMATCH");
+    printf("\n");
+    (void)check;
+  }
+
+  free(positions);
+  free(sides);
+  free(origins);
+  free(counts);
+  free(scores);
+}
+
+/* Evaluations per second: eval_position, eval_batch, and the network
+   both from scratch (refresh) and from the parent's accumulator (update),
+   for every supported variant; the two network figures must agree */
+void perft_benchmark_nnue(const Board *board, bool is_white_turn, const Nnue *net, int rounds) {
+  if (!board || !net || rounds <= 0) return;
+
+  enum { NUM_POSITIONS = 4096 };
+  Board *positions = malloc(NUM_POSITIONS * sizeof(Board));
+  Board *parents = malloc(NUM_POSITIONS * sizeof(Board));
+  bool *sides = malloc(NUM_POSITIONS * sizeof(bool));
+  MoveSequence *moves = malloc(NUM_POSITIONS * sizeof(MoveSequence));
+  NnueAccumulator *parent_accs = malloc(NUM_POSITIONS * sizeof(NnueAccumulator));
+  int *scores = malloc(NUM_POSITIONS * sizeof(int));
+  if (!positions || !parents || !sides || !moves || !parent_accs || !scores) {
+    free(positions);
+    free(parents);
+    free(sides);
+    free(moves);
+    free(parent_accs);
+    free(scores);
+    return;
+  }
+
+  random_game_positions(board, is_white_turn, NUM_POSITIONS, positions, sides, parents, moves);
+  for (int i = 0; i < NUM_POSITIONS; i++) nnue_refresh(net, &parents[i], &parent_accs[i]);
+
+  CpuLevel best = cpu_detect();
+  for (CpuLevel level = CPU_BASELINE; level <= best; level++) {
+    const CpuKernels *k = cpu_kernels_for(level);
+    double secs[4];
+    int64_t sums[4] = { 0, 0, 0, 0 };
+    NnueAccumulator acc;
+
+    clock_t start = clock();
+    for (int r = 0; r < rounds; r++) {
+      for (int i = 0; i < NUM_POSITIONS; i++) sums[0] += k->eval_position(&positions[i], sides[i]);
+    }
+    secs[0] = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    start = clock();
+    for (int r = 0; r < rounds; r++) {
+      k->eval_batch(positions, NUM_POSITIONS, sides, scores);
+      for (int i = 0; i < NUM_POSITIONS; i++) sums[1] += scores[i];
+    }
+    secs[1] = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    start = clock();
+    for (int r = 0; r < rounds; r++) {
+      for (int i = 0; i < NUM_POSITIONS; i++) {
+        nnue_refresh(net, &positions[i], &acc);
+        sums[2] += k->nnue_output(net, &acc, sides[i]);
+      }
+    }
+    secs[2] = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    start = clock();
+    for (int r = 0; r < rounds; r++) {
+      for (int i = 0; i < NUM_POSITIONS; i++) {
+        k->nnue_update(net, &parent_accs[i], &acc, &moves[i], !sides[i]);
+        sums[3] += k->nnue_output(net, &acc, sides[i]);
+      }
+    }
+    secs[3] = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    double total = (double)rounds * NUM_POSITIONS;
+    printf("  %-12s eval_position %.0f evals/s, eval_batch %.0f evals/s\n", k->name,
+           secs[0] > 0 ? total / secs[0] : 0.0, secs[1] > 0 ? total / secs[1] : 0.0);
+    printf("  %-12s nnue          %.0f evals/s refreshed, %.0f updated (%.2fx)", "",
+           secs[2] > 0 ? total / secs[2] : 0.0, secs[3] > 0 ? total / secs[3] : 0.0,
+           secs[3] > 0 ? secs[2] / secs[3] : 0.0);
+    if (sums[2] != sums[3]) printf("  MISMATCH");
+    printf("\n");
+  }
+
+  free(positions);
+  free(parents);
+  free(sides);
+  free(moves);
+  free(parent_accs);
+  free(scores);
+}
+
+// Sum of the tasks every worker ran
+static uint64_t pool_tasks(const Pool *pool) {
+  uint64_t tasks = 0;
+  PoolWorkerStats s;
+  for (int i = 0; i < pool_threads(pool); i++) {
+    pool_worker_stats(pool, i, &s);
+    tasks += s.tasks;
+  }
+  return tasks;
+}
+
+/* Task overhead and scaling of the work-stealing pool on perft. A one-worker
+   pool with every node a task against the plain recursion gives the cost of
+   a task; then the threads-wide pool with s = 0..3 plies counted serially at
+   the bottom shows how the speedup follows the task size */
+void perft_benchmark_pool(const Board *board, bool is_white_turn, int depth, int threads, bool pin) {
+  if (!board || depth <= 0) return;
+
+  /* Once to warm up, then timed */
+  uint64_t expected = perft_nodes(board, is_white_turn, depth);
+  double start = wall_seconds();
+  perft_nodes(board, is_white_turn, depth);
+  double serial = wall_seconds() - start;
+  printf("  %-16s %12llu nodes %8.3fs %12.0f nodes/s\n", "serial", (unsigned long long)expected,
+         serial, serial > 0 ? expected / serial : 0.0);
+
+  PoolConfig one = { .threads = 1, .pin = pin };
+  Pool *pool = pool_create(&one);
+  if (!pool) {
+    printf("Cannot start the pool\n");
+    return;
+  }
+  start = wall_seconds();
+  uint64_t nodes = perft_nodes_parallel(pool, board, is_white_turn, depth, 0);
+  double secs = wall_seconds() - start;
+  uint64_t tasks = pool_tasks(pool);
+  printf("  %-16s %12llu nodes %8.3fs %12llu tasks %6.1f ns/task overhead%s\n",
+         "1 worker, all", (unsigned long long)nodes, secs, (unsigned long long)tasks,
+         tasks ? (secs - serial) * 1e9 / tasks : 0.0, nodes != expected ? "  MISMATCH" : "");
+  pool_destroy(pool);
+
+  PoolConfig config = { .threads = threads, .pin = pin };
+  if (!(pool = pool_create(&config))) {
+    printf("Cannot start the pool\n");
+    return;
+  }
+  for (int serial_depth = 0; serial_depth <= 3 && serial_depth < depth; serial_depth++) {
+    pool_reset_stats(pool);
+    start = wall_seconds();
+    nodes = perft_nodes_parallel(pool, board, is_white_turn, depth, serial_depth);
+    secs = wall_seconds() - start;
+
+    char label[32];
+    snprintf(label, sizeof(label), "%d workers, s=%d", pool_threads(pool), serial_depth);
+    printf("  %-16s %12llu nodes %8.3fs %12llu tasks %6.2fx%s\n", label, (unsigned long long)nodes,
+           secs, (unsigned long long)pool_tasks(pool), secs > 0 ? serial / secs : 0.0,
+           nodes != expected ? "  MISMATCH" : "");
+  }
+  print_pool_stats(pool, stdout);
+  pool_destroy(pool);
+}
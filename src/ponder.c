@@ -0,0 +1,53 @@
+/* Background search on the opponent's time, run through the engine's
+   asynchronous search API. The engine belongs to its worker thread until
+   ponder_finish joins it. */
+#include "ponder.h"
+
+// Start pondering from `board` (opponent to move); false if no prediction
+bool ponder_start(Ponder *ponder, Engine *engine, const Board *board,
+                  bool opponent_is_white, int depth) {
+  ponder->active = false;
+
+  MoveSequence expected;
+  if (!engine_predicted_reply(engine, &expected)) return false;
+
+  Board after = *board;
+  execute_sequence(&after, &expected, opponent_is_white);
+
+  SearchLimits limits = { .depth = depth };
+  if (!engine_start(engine, &after, !opponent_is_white, &limits)) return false;
+
+  ponder->engine = engine;
+  ponder->expected = expected;
+  ponder->active = true;
+  return true;
+}
+
+static bool same_sequence(const MoveSequence *a, const MoveSequence *b) {
+  if (a->count != b->count) return false;
+
+  for (int i = 0; i < a->count; i++) {
+    if (a->jumps[i] != b->jumps[i]) return false;
+  }
+
+  return true;
+}
+
+// Finish pondering once the opponent has played `played` (NULL cancels)
+bool ponder_finish(Ponder *ponder, const MoveSequence *played,
+                   MoveSequence *best, int *score) {
+  if (!ponder->active) return false;
+  ponder->active = false;
+
+  bool hit = played && same_sequence(played, &ponder->expected);
+
+  /* Hit: let the same search run to its depth. Miss: cut it short. */
+  SearchResult result;
+  bool found = engine_wait(ponder->engine, &result, hit ? -1 : 0);
+
+  if (!hit || !found) return false;
+
+  *best = result.best;
+  if (score) *score = result.score;
+  return true;
+}
@@ -0,0 +1,473 @@
+/* Work-stealing thread pool (see pool.h). The deques are Chase-Lev
+   deques of task pointers in a fixed ring: the owner moves `bottom`, thieves
+   race on `top` with a compare-and-swap, and the owner only joins that race
+   for the last task. */
+#define _GNU_SOURCE
+#include "pool.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define POOL_MASK (POOL_DEQUE_SIZE - 1)
+#define POOL_SPINS 64          // rounds of stealing before an idle worker sleeps
+
+/* Counters are written by their worker only, and read by anyone */
+#define COUNT(x) __atomic_store_n(&(x), (x) + 1, __ATOMIC_RELAXED)
+
+_Static_assert((POOL_DEQUE_SIZE & POOL_MASK) == 0, "POOL_DEQUE_SIZE must be a power of two");
+
+typedef struct {
+  /* Owner and thieves write different lines */
+  int64_t bottom __attribute__((aligned(64)));
+  int64_t top __attribute__((aligned(64)));
+  PoolTask *tasks[POOL_DEQUE_SIZE] __attribute__((aligned(64)));
+} Deque;
+
+typedef struct {
+  Deque deque;
+  Pool *pool;
+  int index;
+  uint64_t rng;
+  PoolWorkerStats stats;
+  pthread_t tid;
+} __attribute__((aligned(64))) PoolWorker;
+
+struct Pool {
+  PoolWorker *workers;
+  int threads;                 // deques (thieves look at all of them)
+  int running;                 // worker threads started
+  bool pin;
+  int stop;
+  int sleeping;
+  int queued;                  // tasks in the shared queue
+  PoolTask *queue_head, *queue_tail;
+  pthread_mutex_t lock;
+  pthread_cond_t work_cond;    // new work or stop
+  pthread_cond_t done_cond;    // a group with an outside waiter finished
+};
+
+static __thread PoolWorker *current;   // the worker running on this thread
+
+/* Deque operations */
+
+static bool deque_push(Deque *d, PoolTask *task) {
+  int64_t b = __atomic_load_n(&d->bottom, __ATOMIC_RELAXED);
+  int64_t t = __atomic_load_n(&d->top, __ATOMIC_ACQUIRE);
+  if (b - t >= POOL_DEQUE_SIZE) return false;
+
+  __atomic_store_n(&d->tasks[b & POOL_MASK], task, __ATOMIC_RELAXED);
+  __atomic_store_n(&d->bottom, b + 1, __ATOMIC_RELEASE);   // publishes the task to thieves
+  return true;
+}
+
+static PoolTask *deque_pop(Deque *d) {
+  int64_t b = __atomic_load_n(&d->bottom, __ATOMIC_RELAXED) - 1;
+  __atomic_store_n(&d->bottom, b, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  int64_t t = __atomic_load_n(&d->top, __ATOMIC_RELAXED);
+
+  if (t > b) {
+    __atomic_store_n(&d->bottom, b + 1, __ATOMIC_RELAXED);
+    return NULL;
+  }
+
+  PoolTask *task = __atomic_load_n(&d->tasks[b & POOL_MASK], __ATOMIC_RELAXED);
+  if (t == b) {
+    /* Last task: a thief may be taking it too */
+    if (!__atomic_compare_exchange_n(&d->top, &t, t + 1, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+      task = NULL;
+    __atomic_store_n(&d->bottom, b + 1, __ATOMIC_RELAXED);
+  }
+  return task;
+}
+
+static PoolTask *deque_steal(Deque *d) {
+  int64_t t = __atomic_load_n(&d->top, __ATOMIC_ACQUIRE);
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  int64_t b = __atomic_load_n(&d->bottom, __ATOMIC_ACQUIRE);
+  if (t >= b) return NULL;
+
+  PoolTask *task = __atomic_load_n(&d->tasks[t & POOL_MASK], __ATOMIC_RELAXED);
+  if (!__atomic_compare_exchange_n(&d->top, &t, t + 1, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+    return NULL;
+  return task;
+}
+
+static bool deque_empty(Deque *d) {
+  return __atomic_load_n(&d->top, __ATOMIC_ACQUIRE) >= __atomic_load_n(&d->bottom, __ATOMIC_ACQUIRE);
+}
+
+/* Finding and running tasks */
+
+static PoolTask *queue_take(Pool *pool) {
+  if (__atomic_load_n(&pool->queued, __ATOMIC_ACQUIRE) == 0) return NULL;
+
+  pthread_mutex_lock(&pool->lock);
+  PoolTask *task = pool->queue_head;
+  if (task) {
+    pool->queue_head = task->next;
+    if (!pool->queue_head) pool->queue_tail = NULL;
+    __atomic_store_n(&pool->queued, pool->queued - 1, __ATOMIC_RELEASE);
+  }
+  pthread_mutex_unlock(&pool->lock);
+  return task;
+}
+
+// Own deque first, then the shared queue, then one round over the other workers
+static PoolTask *find_task(PoolWorker *w) {
+  Pool *pool = w->pool;
+  PoolTask *task = deque_pop(&w->deque);
+  if (task) return task;
+
+  if ((task = queue_take(pool))) {
+    COUNT(w->stats.steals);
+    return task;
+  }
+
+  /* xorshift: start the round at a random victim */
+  w->rng ^= w->rng << 13;
+  w->rng ^= w->rng >> 7;
+  w->rng ^= w->rng << 17;
+  int first = (int)(w->rng % (uint64_t)pool->threads);
+
+  for (int k = 0; k < pool->threads; k++) {
+    int v = (first + k) % pool->threads;
+    if (v == w->index) continue;
+    if ((task = deque_steal(&pool->workers[v].deque))) {
+      COUNT(w->stats.steals);
+      return task;
+    }
+  }
+  COUNT(w->stats.failed_steals);
+  return NULL;
+}
+
+static void finish(Pool *pool, PoolGroup *group) {
+  /* Read before the count drops: the group may be gone right after */
+  int external = __atomic_load_n(&group->external, __ATOMIC_ACQUIRE);
+  if (__atomic_sub_fetch(&group->pending, 1, __ATOMIC_ACQ_REL) == 0 && external) {
+    pthread_mutex_lock(&pool->lock);
+    pthread_cond_broadcast(&pool->done_cond);
+    pthread_mutex_unlock(&pool->lock);
+  }
+}
+
+// Run a task; the struct is not touched once fn starts
+static void run_task(PoolWorker *w, PoolTask *task) {
+  PoolFn fn = task->fn;
+  void *arg = task->arg;
+  PoolGroup *group = task->group;
+
+  COUNT(w->stats.tasks);
+  fn(arg);
+  finish(w->pool, group);
+}
+
+static bool work_available(Pool *pool) {
+  if (pool->queue_head) return true;
+  for (int i = 0; i < pool->threads; i++)
+    if (!deque_empty(&pool->workers[i].deque)) return true;
+  return false;
+}
+
+static void pin_worker(PoolWorker *w) {
+  long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  if (cpus <= 0) return;
+
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(w->index % cpus, &set);
+  pthread_setaffinity_np(pthread_self(), sizeof(set), &set);   // best effort
+}
+
+static void *worker_main(void *arg) {
+  PoolWorker *w = arg;
+  Pool *pool = w->pool;
+  int idle = 0;
+
+  current = w;
+  if (pool->pin) pin_worker(w);
+
+  while (!__atomic_load_n(&pool->stop, __ATOMIC_ACQUIRE)) {
+    PoolTask *task = find_task(w);
+    if (task) {
+      run_task(w, task);
+      idle = 0;
+      continue;
+    }
+    if (++idle < POOL_SPINS) {
+      sched_yield();
+      continue;
+    }
+
+    /* Announce the sleep before the last look, so a spawner either sees
+       it and signals or its task is seen here */
+    pthread_mutex_lock(&pool->lock);
+    __atomic_add_fetch(&pool->sleeping, 1, __ATOMIC_SEQ_CST);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    while (!pool->stop && !work_available(pool)) {
+      COUNT(w->stats.sleeps);
+      pthread_cond_wait(&pool->work_cond, &pool->lock);
+    }
+    __atomic_sub_fetch(&pool->sleeping, 1, __ATOMIC_SEQ_CST);
+    pthread_mutex_unlock(&pool->lock);
+    idle = 0;
+  }
+
+  current = NULL;
+  return NULL;
+}
+
+/* Pool lifetime */
+
+// NULL config = defaults
+Pool *pool_create(const PoolConfig *config) {
+  int threads = config ? config->threads : 0;
+  if (threads <= 0) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    threads = cpus > 0 ? (int)cpus : 1;
+  }
+  if (threads > POOL_MAX_THREADS) threads = POOL_MAX_THREADS;
+
+  Pool *pool = calloc(1, sizeof(Pool));
+  if (!pool) return NULL;
+  if (posix_memalign((void **)&pool->workers, 64, (size_t)threads * sizeof(PoolWorker)) != 0) {
+    free(pool);
+    return NULL;
+  }
+  memset(pool->workers, 0, (size_t)threads * sizeof(PoolWorker));
+
+  pool->threads = threads;
+  pool->pin = config && config->pin;
+  pthread_mutex_init(&pool->lock, NULL);
+  pthread_cond_init(&pool->work_cond, NULL);
+  pthread_cond_init(&pool->done_cond, NULL);
+
+  for (int i = 0; i < threads; i++) {
+    PoolWorker *w = &pool->workers[i];
+    w->pool = pool;
+    w->index = i;
+    w->rng = 0x9E3779B97F4A7C15ULL * (uint64_t)(i + 1);
+  }
+
+  /* A worker that fails to start leaves an empty deque behind */
+  int started = 0;
+  for (; started < threads; started++) {
+    if (pthread_create(&pool->workers[started].tid, NULL, worker_main, &pool->workers[started]) != 0)
+      break;
+  }
+  pool->running = started;
+
+  if (started == 0) {
+    pool_destroy(pool);
+    return NULL;
+  }
+  return pool;
+}
+
+void pool_destroy(Pool *pool) {
+  if (!pool) return;
+
+  pthread_mutex_lock(&pool->lock);
+  __atomic_store_n(&pool->stop, 1, __ATOMIC_RELEASE);
+  pthread_cond_broadcast(&pool->work_cond);
+  pthread_mutex_unlock(&pool->lock);
+
+  for (int i = 0; i < pool->running; i++) pthread_join(pool->workers[i].tid, NULL);
+
+  pthread_cond_destroy(&pool->done_cond);
+  pthread_cond_destroy(&pool->work_cond);
+  pthread_mutex_destroy(&pool->lock);
+  free(pool->workers);
+  free(pool);
+}
+
+static Pool *shared;
+static pthread_once_t shared_once = PTHREAD_ONCE_INIT;
+
+static void shared_init(void) {
+  shared = pool_create(NULL);
+}
+
+// The engine-wide pool, started on first use and kept until exit
+Pool *pool_shared(void) {
+  pthread_once(&shared_once, shared_init);
+  return shared;
+}
+
+// pool_shared when threads is 0, else a new pool of that size (free with pool_release)
+Pool *pool_acquire(int threads) {
+  if (threads <= 0) return pool_shared();
+  PoolConfig config = { .threads = threads };
+  return pool_create(&config);
+}
+
+void pool_release(Pool *pool) {
+  if (pool != shared) pool_destroy(pool);
+}
+
+int pool_threads(const Pool *pool) {
+  return pool->running;
+}
+
+// Index of the calling worker of pool (0..threads-1), or -1 outside it
+int pool_worker_id(const Pool *pool) {
+  return current && current->pool == pool ? current->index : -1;
+}
+
+/* Fork/join */
+
+void pool_spawn(Pool *pool, PoolGroup *group, PoolTask *task, PoolFn fn, void *arg) {
+  task->fn = fn;
+  task->arg = arg;
+  task->group = group;
+  task->next = NULL;
+
+  PoolWorker *w = current && current->pool == pool ? current : NULL;
+
+  if (w) {
+    __atomic_add_fetch(&group->pending, 1, __ATOMIC_RELAXED);
+    if (!deque_push(&w->deque, task)) {
+      /* Full: run it now, as a plain call would */
+      COUNT(w->stats.inlined);
+      run_task(w, task);
+      return;
+    }
+    COUNT(w->stats.spawned);
+
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&pool->sleeping, __ATOMIC_SEQ_CST) > 0) {
+      pthread_mutex_lock(&pool->lock);
+      pthread_cond_signal(&pool->work_cond);
+      pthread_mutex_unlock(&pool->lock);
+    }
+    return;
+  }
+
+  /* From outside the pool: the shared queue */
+  __atomic_store_n(&group->external, 1, __ATOMIC_RELEASE);
+  __atomic_add_fetch(&group->pending, 1, __ATOMIC_RELAXED);
+
+  pthread_mutex_lock(&pool->lock);
+  if (pool->queue_tail) pool->queue_tail->next = task;
+  else pool->queue_head = task;
+  pool->queue_tail = task;
+  __atomic_store_n(&pool->queued, pool->queued + 1, __ATOMIC_RELEASE);
+  pthread_cond_signal(&pool->work_cond);
+  pthread_mutex_unlock(&pool->lock);
+}
+
+/* A worker keeps running tasks until the group is done; any other thread
+   sleeps until the last task of the group wakes it */
+void pool_wait(Pool *pool, PoolGroup *group) {
+  PoolWorker *w = current && current->pool == pool ? current : NULL;
+
+  if (!w) {
+    pthread_mutex_lock(&pool->lock);
+    while (__atomic_load_n(&group->pending, __ATOMIC_ACQUIRE) > 0)
+      pthread_cond_wait(&pool->done_cond, &pool->lock);
+    pthread_mutex_unlock(&pool->lock);
+    return;
+  }
+
+  while (__atomic_load_n(&group->pending, __ATOMIC_ACQUIRE) > 0) {
+    PoolTask *task = find_task(w);
+    if (task) run_task(w, task);
+    else sched_yield();
+  }
+}
+
+typedef struct {
+  Pool *pool;
+  void (*fn)(void *arg, size_t i);
+  void *arg;
+  size_t begin, end, grain;
+} PoolRange;
+
+// Halve the range until it fits the grain, spawning the upper halves
+static void range_task(void *arg) {
+  PoolRange *r = arg;
+
+  if (r->end - r->begin <= r->grain) {
+    for (size_t i = r->begin; i < r->end; i++) r->fn(r->arg, i);
+    return;
+  }
+
+  PoolRange low = *r, high = *r;
+  low.end = high.begin = r->begin + (r->end - r->begin) / 2;
+
+  PoolGroup group = { 0 };
+  PoolTask task;
+  pool_spawn(r->pool, &group, &task, range_task, &high);
+  range_task(&low);
+  pool_wait(r->pool, &group);
+}
+
+// fn(arg, i) for every i in [0, count), in pieces of at most grain (0 = split evenly)
+void pool_parallel_for(Pool *pool, size_t count, size_t grain,
+                       void (*fn)(void *arg, size_t i), void *arg) {
+  if (count == 0) return;
+  if (grain == 0) grain = count / (size_t)pool->running;
+  if (grain == 0) grain = 1;
+
+  PoolRange range = { pool, fn, arg, 0, count, grain };
+  if (pool_worker_id(pool) >= 0) {
+    range_task(&range);
+    return;
+  }
+
+  PoolGroup group = { 0 };
+  PoolTask task;
+  pool_spawn(pool, &group, &task, range_task, &range);
+  pool_wait(pool, &group);
+}
+
+/* Statistics */
+
+void pool_worker_stats(const Pool *pool, int worker, PoolWorkerStats *out) {
+  const PoolWorkerStats *s = &pool->workers[worker].stats;
+  out->tasks = __atomic_load_n(&s->tasks, __ATOMIC_RELAXED);
+  out->spawned = __atomic_load_n(&s->spawned, __ATOMIC_RELAXED);
+  out->inlined = __atomic_load_n(&s->inlined, __ATOMIC_RELAXED);
+  out->steals = __atomic_load_n(&s->steals, __ATOMIC_RELAXED);
+  out->failed_steals = __atomic_load_n(&s->failed_steals, __ATOMIC_RELAXED);
+  out->sleeps = __atomic_load_n(&s->sleeps, __ATOMIC_RELAXED);
+}
+
+// Zero the counters; increments racing with it may survive
+void pool_reset_stats(Pool *pool) {
+  for (int i = 0; i < pool->running; i++) {
+    PoolWorkerStats *s = &pool->workers[i].stats;
+    __atomic_store_n(&s->tasks, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&s->spawned, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&s->inlined, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&s->steals, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&s->failed_steals, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&s->sleeps, 0, __ATOMIC_RELAXED);
+  }
+}
+
+void print_pool_stats(const Pool *pool, FILE *out) {
+  PoolWorkerStats total = { 0 }, s;
+
+  fprintf(out, "worker        tasks      spawned    inlined     steals     failed   sleeps\n");
+  for (int i = 0; i < pool->running; i++) {
+    pool_worker_stats(pool, i, &s);
+    fprintf(out, "%6d %12llu %12llu %10llu %10llu %10llu %8llu\n", i,
+            (unsigned long long)s.tasks, (unsigned long long)s.spawned,
+            (unsigned long long)s.inlined, (unsigned long long)s.steals,
+            (unsigned long long)s.failed_steals, (unsigned long long)s.sleeps);
+    total.tasks += s.tasks;
+    total.spawned += s.spawned;
+    total.inlined += s.inlined;
+    total.steals += s.steals;
+    total.failed_steals += s.failed_steals;
+    total.sleeps += s.sleeps;
+  }
+  fprintf(out, "   all %12llu %12llu %10llu %10llu %10llu %8llu\n",
+          (unsigned long long)total.tasks, (unsigned long long)total.spawned,
+          (unsigned long long)total.inlined, (unsigned long long)total.steals,
+          (unsigned long long)total.failed_steals, (unsigned long long)total.sleeps);
+}
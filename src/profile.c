@@ -0,0 +1,113 @@
+/* Phase sampling profiler (see profile.h). The SIGPROF handler only reads
+   the interrupted thread's phase and bumps a counter, both safe in a
+   signal handler. ITIMER_PROF counts CPU time of the whole process, so a
+   multi-threaded run is sampled across its threads. */
+#include "profile.h"
+#include <string.h>
+#include <time.h>
+
+static const char *const phase_names[PROF_NUM_PHASES] = {
+  "other", "search", "movegen", "eval", "hash", "perft"
+};
+
+#ifdef KONANE_PROFILE
+#include <signal.h>
+#include <sys/time.h>
+
+__thread volatile int profile_phase = PROF_OTHER;
+
+static uint64_t samples[PROF_NUM_PHASES];
+static bool active;
+static clock_t since;   // CPU time at start / reset
+
+static void on_sigprof(int sig) {
+  int phase = profile_phase;
+  if (phase < 0 || phase >= PROF_NUM_PHASES) phase = PROF_OTHER;
+  __atomic_fetch_add(&samples[phase], 1, __ATOMIC_RELAXED);
+}
+
+// Start sampling hz times per second of CPU time
+bool profile_start(int hz) {
+  if (active || hz <= 0 || hz > 1000000) return false;
+
+  struct sigaction sa;
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = on_sigprof;
+  sa.sa_flags = SA_RESTART;
+  sigemptyset(&sa.sa_mask);
+  if (sigaction(SIGPROF, &sa, NULL) != 0) return false;
+
+  struct itimerval timer = { { 0, 1000000 / hz }, { 0, 1000000 / hz } };
+  if (setitimer(ITIMER_PROF, &timer, NULL) != 0) return false;
+
+  since = clock();
+  active = true;
+  return true;
+}
+
+void profile_stop(void) {
+  if (!active) return;
+
+  struct itimerval off;
+  memset(&off, 0, sizeof(off));
+  setitimer(ITIMER_PROF, &off, NULL);
+  signal(SIGPROF, SIG_IGN);
+  active = false;
+}
+
+void profile_reset(void) {
+  for (int p = 0; p < PROF_NUM_PHASES; p++) __atomic_store_n(&samples[p], 0, __ATOMIC_RELAXED);
+  since = clock();
+}
+#else
+static uint64_t samples[PROF_NUM_PHASES];
+static bool active;
+static clock_t since;
+
+// Start sampling hz times per second of CPU time; not built in
+bool profile_start(int hz) {
+  return false;
+}
+
+void profile_stop(void) {
+}
+
+void profile_reset(void) {
+}
+#endif
+
+// Sampling is running
+bool profile_active(void) {
+  return active;
+}
+
+// Samples and share per phase
+void profile_report(FILE *out) {
+  uint64_t counts[PROF_NUM_PHASES], total = 0;
+  for (int p = 0; p < PROF_NUM_PHASES; p++) {
+    counts[p] = __atomic_load_n(&samples[p], __ATOMIC_RELAXED);
+    total += counts[p];
+  }
+
+  /* The kernel's tick can cap the rate below the one asked for */
+  double cpu = (double)(clock() - since) / CLOCKS_PER_SEC;
+  fprintf(out, "Profile: %llu samples over %.2fs CPU (%.0f/s)\n", (unsigned long long)total, cpu,
+          cpu > 0 ? total / cpu : 0.0);
+  if (!total) return;
+
+  for (int p = 0; p < PROF_NUM_PHASES; p++) {
+    if (!counts[p]) continue;
+    fprintf(out, "  %-8s %10llu %6.1f%%\n", phase_names[p], (unsigned long long)counts[p],
+            100.0 * counts[p] / total);
+  }
+}
+
+// Stop and report on stderr (for atexit), unless nothing was sampled since the last report
+void profile_exit_report(void) {
+  if (!active) return;
+  profile_stop();
+
+  uint64_t total = 0;
+  for (int p = 0; p < PROF_NUM_PHASES; p++) total += samples[p];
+  if (total) profile_report(stderr);
+}
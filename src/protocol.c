@@ -0,0 +1,374 @@
+/* Engine protocol (see protocol.h). The reader thread parses commands while
+   a search runs on a thread of its own; that thread prints the info lines
+   through the engine's per-iteration callback and finally the bestmove, so
+   "stop" and "isready" are answered while the engine is thinking. */
+#include "protocol.h"
+#include "ai.h"
+#include "book.h"
+#include "konane.h"
+#include <stdarg.h>
+#include <string.h>
+#include <strings.h>
+
+#define PROTOCOL_LINE_MAX 8192
+#define PROTOCOL_MAX_TOKENS (PROTOCOL_LINE_MAX / 2)
+
+typedef struct {
+  FILE *out;
+  pthread_mutex_t out_lock;
+  Engine *engine;
+  size_t hash_mb;
+  Nnue *nnue;           // EvalFile network (NULL = eval_position)
+
+  /* Position set by the last "position" command */
+  Board board;
+  bool is_white_turn;
+
+  /* Running search */
+  pthread_t thread;
+  bool thread_live;     // started and not yet joined
+  Board root;
+  bool root_white;
+  SearchLimits limits;
+  bool infinite;        // hold the bestmove back until "stop"
+  bool stop_requested;
+  double start;
+  pthread_mutex_t lock;
+  pthread_cond_t stop_cond;
+} Protocol;
+
+// Write one complete line (any thread)
+static void send_line(Protocol *p, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+static void send_line(Protocol *p, const char *fmt, ...) {
+  va_list args;
+  va_start(args, fmt);
+  pthread_mutex_lock(&p->out_lock);
+  vfprintf(p->out, fmt, args);
+  fputc('\n', p->out);
+  fflush(p->out);
+  pthread_mutex_unlock(&p->out_lock);
+  va_end(args);
+}
+
+// Still in the opening removals: the first two plies remove one stone each
+static bool in_removals(const Board *board) {
+  return popcount(board_occupied(board)) > TOTAL_CELLS - 2;
+}
+
+static void send_info(void *ctx, const SearchResult *result,
+                      const MoveSequence *pv, int pv_length) {
+  Protocol *p = ctx;
+  char line[PROTOCOL_LINE_MAX];
+  double ms = (wall_seconds() - p->start) * 1000.0;
+  uint64_t nps = ms > 0 ? (uint64_t)(result->nodes * 1000.0 / ms) : 0;
+
+  char score[32];
+  if (SCORE_IS_MATE(result->score)) {
+    /* The score carries the depth left where the loser ran out of jumps,
+       so that happened at ply (iteration depth - that offset); counted in
+       the side to move's moves, negative when it is the one losing */
+    int offset = SCORE_MATE - (result->score > 0 ? result->score : -result->score);
+    int plies = result->depth - offset;
+    if (plies < 1) plies = 1;
+    snprintf(score, sizeof(score), "mate %d", result->score > 0 ? (plies + 1) / 2 : -((plies + 1) / 2));
+  } else {
+    snprintf(score, sizeof(score), "cp %d", result->score);
+  }
+
+  int len = snprintf(line, sizeof(line), "info depth %d score %s nodes %llu nps %llu time %.0f pv",
+                     result->depth, score, (unsigned long long)result->nodes,
+                     (unsigned long long)nps, ms);
+
+  for (int i = 0; i < pv_length && len < (int)sizeof(line) - MOVE_TEXT_MAX - 1; i++) {
+    line[len++] = ' ';
+    move_sequence_to_text(&pv[i], line + len);
+    len += strlen(line + len);
+  }
+
+  send_line(p, "%s", line);
+}
+
+static void *search_thread(void *arg) {
+  Protocol *p = arg;
+  SearchResult result;
+  char move[MOVE_TEXT_MAX];
+
+  bool found = engine_search(p->engine, &p->root, p->root_white, &p->limits, &result);
+
+  /* "go infinite" must not answer before the GUI says stop */
+  pthread_mutex_lock(&p->lock);
+  while (p->infinite && !p->stop_requested) pthread_cond_wait(&p->stop_cond, &p->lock);
+  pthread_mutex_unlock(&p->lock);
+
+  if (found) {
+    move_sequence_to_text(&result.best, move);
+    send_line(p, "bestmove %s", move);
+  } else {
+    send_line(p, "bestmove none");
+  }
+  return NULL;
+}
+
+// End the running search (if any) and wait for its bestmove
+static void stop_search(Protocol *p) {
+  if (!p->thread_live) return;
+
+  pthread_mutex_lock(&p->lock);
+  p->stop_requested = true;
+  pthread_cond_signal(&p->stop_cond);
+  pthread_mutex_unlock(&p->lock);
+
+  engine_stop(p->engine);
+  pthread_join(p->thread, NULL);
+  p->thread_live = false;
+  engine_clear_stop(p->engine);
+}
+
+// Answer "go" during the removals: the book's choice, else the first legal one
+static void send_removal(Protocol *p) {
+  bool is_black = !p->is_white_turn;
+  int row, col;
+
+  if (!book_probe_removal(&p->board, is_black, &row, &col) ||
+      !is_valid_initial_removal(&p->board, row, col, is_black)) {
+    for (int sq = 0; sq < TOTAL_CELLS; sq++) {
+      index_to_coord(sq, &row, &col);
+      if (is_valid_initial_removal(&p->board, row, col, is_black)) break;
+      row = -1;
+    }
+  }
+
+  if (row < 0) send_line(p, "bestmove none");
+  else send_line(p, "bestmove %c%d", 'A' + col, row + 1);
+}
+
+// go [depth D] [movetime MS] [nodes N] [infinite]
+static void cmd_go(Protocol *p, char **tok, int n) {
+  SearchLimits limits = { 0 };
+  bool infinite = false;
+
+  for (int i = 0; i < n; i++) {
+    if (!strcmp(tok[i], "depth") && i + 1 < n) limits.depth = atoi(tok[++i]);
+    else if (!strcmp(tok[i], "movetime") && i + 1 < n) limits.movetime_ms = atoi(tok[++i]);
+    else if (!strcmp(tok[i], "nodes") && i + 1 < n) limits.nodes = strtoull(tok[++i], NULL, 10);
+    else if (!strcmp(tok[i], "infinite")) infinite = true;
+  }
+
+  /* A bare "go" searches to the default depth, as the game does */
+  if (!infinite && limits.depth <= 0 && limits.movetime_ms <= 0 && limits.nodes == 0)
+    limits.depth = DEF_DEPTH;
+
+  stop_search(p);
+
+  if (in_removals(&p->board)) {
+    send_removal(p);
+    return;
+  }
+
+  if (count_all_moves(&p->board, p->is_white_turn) > MAX_SEQUENCES) {
+    send_line(p, "info string more than %d legal moves, too many to search", MAX_SEQUENCES);
+    send_line(p, "bestmove none");
+    return;
+  }
+
+  p->root = p->board;
+  p->root_white = p->is_white_turn;
+  p->limits = limits;
+  p->infinite = infinite;
+  p->stop_requested = false;
+  p->start = wall_seconds();
+
+  if (pthread_create(&p->thread, NULL, search_thread, p) != 0) {
+    send_line(p, "info string cannot start search");
+    send_line(p, "bestmove none");
+    return;
+  }
+  p->thread_live = true;
+}
+
+// Play one removal or move token on the protocol's position
+static bool play_token(Protocol *p, const char *token) {
+  if (in_removals(&p->board)) {
+    int row, col;
+    if (!parse_coord(token, &row, &col) ||
+        !execute_initial_removal(&p->board, row, col, !p->is_white_turn))
+      return false;
+  } else {
+    MoveSequence moves[MAX_SEQUENCES];
+    char text[MOVE_TEXT_MAX];
+    int num_moves = generate_all_moves(&p->board, p->is_white_turn, moves);
+    int i;
+
+    for (i = 0; i < num_moves; i++) {
+      move_sequence_to_text(&moves[i], text);
+      if (!strcasecmp(text, token)) break;
+    }
+    if (i >= num_moves) return false;   // also when there are too many to list
+    execute_sequence(&p->board, &moves[i], p->is_white_turn);
+  }
+
+  p->is_white_turn = !p->is_white_turn;
+  return true;
+}
+
+// position startpos | fen <position> [moves ...]
+static void cmd_position(Protocol *p, char **tok, int n) {
+  int i = 0;
+
+  if (n >= 1 && !strcmp(tok[0], "startpos")) {
+    init_board(&p->board);
+    p->is_white_turn = false;
+    i = 1;
+  } else if (n >= 3 && !strcmp(tok[0], "fen")) {
+    char text[BOARD_TEXT_MAX + 8];
+    snprintf(text, sizeof(text), "%s %s", tok[1], tok[2]);
+    if (!board_from_text(text, &p->board, &p->is_white_turn)) {
+      send_line(p, "info string invalid position %s", text);
+      return;
+    }
+    i = 3;
+  } else {
+    send_line(p, "info string expected startpos or fen");
+    return;
+  }
+
+  if (i < n && !strcmp(tok[i], "moves")) {
+    for (i++; i < n; i++) {
+      if (!play_token(p, tok[i])) {
+        send_line(p, "info string illegal move %s", tok[i]);
+        return;
+      }
+    }
+  }
+}
+
+// setoption name EvalFile value PATH ("<empty>" = the classic evaluation)
+static void set_eval_file(Protocol *p, const char *path) {
+  Nnue *net = NULL;
+  if (strcmp(path, "<empty>")) {
+    net = nnue_load(path);
+    if (!net) {
+      send_line(p, "info string cannot load network %s", path);
+      return;
+    }
+  }
+
+  stop_search(p);
+  engine_set_nnue(p->engine, net);
+  nnue_free(p->nnue);
+  p->nnue = net;
+}
+
+// setoption name Hash value N | name EvalFile value PATH
+static void cmd_setoption(Protocol *p, char **tok, int n) {
+  if (n >= 4 && !strcmp(tok[0], "name") && !strcasecmp(tok[1], "EvalFile") &&
+      !strcmp(tok[2], "value")) {
+    set_eval_file(p, tok[3]);
+    return;
+  }
+  if (n < 4 || strcmp(tok[0], "name") || strcasecmp(tok[1], "Hash") || strcmp(tok[2], "value")) {
+    send_line(p, "info string unknown option");
+    return;
+  }
+
+  long mb = atol(tok[3]);
+  if (mb < 1 || mb > PROTOCOL_MAX_HASH_MB) {
+    send_line(p, "info string Hash must be 1 to %d", PROTOCOL_MAX_HASH_MB);
+    return;
+  }
+
+  stop_search(p);
+  Engine *engine = engine_create((size_t)mb);
+  if (!engine) {
+    send_line(p, "info string cannot allocate %ld MB", mb);
+    return;
+  }
+
+  engine_free(p->engine);
+  p->engine = engine;
+  p->hash_mb = (size_t)mb;
+  engine_set_info(p->engine, send_info, p);
+  engine_set_nnue(p->engine, p->nnue);
+}
+
+// Split a line into whitespace-separated tokens
+static int tokenize(char *line, char **tok) {
+  int n = 0;
+  char *save;
+
+  for (char *t = strtok_r(line, " \t\r\n", &save); t && n < PROTOCOL_MAX_TOKENS;
+       t = strtok_r(NULL, " \t\r\n", &save))
+    tok[n++] = t;
+  return n;
+}
+
+// Serve commands from in until "quit" or end of input; false on setup failure
+bool protocol_run(FILE *in, FILE *out) {
+  Protocol *p = calloc(1, sizeof(Protocol));
+  char *line = malloc(PROTOCOL_LINE_MAX);
+  char **tok = malloc(PROTOCOL_MAX_TOKENS * sizeof(char *));
+
+  if (!p || !line || !tok || !(p->engine = engine_create(PROTOCOL_DEF_HASH_MB))) {
+    free(p);
+    free(line);
+    free(tok);
+    return false;
+  }
+
+  p->out = out;
+  p->hash_mb = PROTOCOL_DEF_HASH_MB;
+  pthread_mutex_init(&p->out_lock, NULL);
+  pthread_mutex_init(&p->lock, NULL);
+  pthread_cond_init(&p->stop_cond, NULL);
+  engine_set_info(p->engine, send_info, p);
+  init_board(&p->board);
+
+  while (fgets(line, PROTOCOL_LINE_MAX, in)) {
+    int n = tokenize(line, tok);
+    if (n == 0) continue;
+
+    const char *cmd = tok[0];
+    if (!strcmp(cmd, "quit")) {
+      break;
+    } else if (!strcmp(cmd, "uci")) {
+      send_line(p, "id name konane %s", KONANE_VERSION);
+      send_line(p, "id author konane");
+      send_line(p, "option name Hash type spin default %d min 1 max %d",
+                PROTOCOL_DEF_HASH_MB, PROTOCOL_MAX_HASH_MB);
+      send_line(p, "option name EvalFile type string default <empty>");
+      send_line(p, "uciok");
+    } else if (!strcmp(cmd, "isready")) {
+      send_line(p, "readyok");
+    } else if (!strcmp(cmd, "setoption")) {
+      cmd_setoption(p, tok + 1, n - 1);
+    } else if (!strcmp(cmd, "ucinewgame")) {
+      stop_search(p);
+      engine_new_game(p->engine);
+    } else if (!strcmp(cmd, "position")) {
+      cmd_position(p, tok + 1, n - 1);
+    } else if (!strcmp(cmd, "go")) {
+      cmd_go(p, tok + 1, n - 1);
+    } else if (!strcmp(cmd, "stop")) {
+      stop_search(p);
+    } else {
+      send_line(p, "info string unknown command %s", cmd);
+    }
+  }
+
+  /* At end of input a bounded search may finish; "quit" ends it now */
+  if (feof(in) && p->thread_live && !p->infinite) {
+    pthread_join(p->thread, NULL);
+    p->thread_live = false;
+  }
+  stop_search(p);
+
+  engine_free(p->engine);
+  nnue_free(p->nnue);
+  pthread_cond_destroy(&p->stop_cond);
+  pthread_mutex_destroy(&p->lock);
+  pthread_mutex_destroy(&p->out_lock);
+  free(p);
+  free(line);
+  free(tok);
+  return true;
+}
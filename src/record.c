@@ -0,0 +1,437 @@
+/* Game record archive: writer appends variable-length game records and
+   rewrites the offset index on close; the reader maps the whole file, so
+   game N is one index lookup and a scan is a linear walk over memory. */
+#include "record.h"
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define RECORD_MAGIC "KGR1"
+
+typedef struct {
+  char magic[4];
+  uint32_t board_size;
+  uint64_t count;
+  uint64_t index_offset;  // 0 = no valid index (writer open)
+} ArchiveHeader;
+
+typedef struct {
+  uint8_t black_removal;
+  uint8_t white_removal;
+  uint8_t winner;
+  uint8_t reserved;
+  uint16_t num_moves;
+} RecordGameHeader;
+
+/* Direction vectors: up, right, down, left */
+static const int dir_row[4] = {-1, 0, 1, 0};
+static const int dir_col[4] = {0, 1, 0, -1};
+
+// Start a record from the position after both removals
+void record_begin(GameRecord *game, const Board *board) {
+  Board start;
+  init_board(&start);
+
+  /* Black removed one of its own stones, White one of its own */
+  Bitboard black_hole = start.black & ~board_occupied(board);
+  Bitboard white_hole = start.white & ~board_occupied(board);
+
+  game->black_removal = bb_any(black_hole) ? bb_ctz(black_hole) : 0;
+  game->white_removal = bb_any(white_hole) ? bb_ctz(white_hole) : 0;
+  game->winner = RECORD_UNFINISHED;
+  game->num_moves = 0;
+}
+
+// Add a move to a record (ignored once the record is full)
+void record_move(GameRecord *game, const MoveSequence *seq) {
+  if (game->num_moves < RECORD_MAX_PLIES) game->moves[game->num_moves++] = *seq;
+}
+
+// Replay a record's removals into a fresh board
+bool record_start_board(const GameRecord *game, Board *board) {
+  int row, col;
+  init_board(board);
+
+  index_to_coord(game->black_removal, &row, &col);
+  if (!execute_initial_removal(board, row, col, true)) return false;
+  index_to_coord(game->white_removal, &row, &col);
+  return execute_initial_removal(board, row, col, false);
+}
+
+/* ---- Encoding ---- */
+
+static size_t encoded_size(const GameRecord *game) {
+  size_t size = sizeof(RecordGameHeader);
+  for (int i = 0; i < game->num_moves; i++) size += 2 + (game->moves[i].count + 3) / 4;
+  return size;
+}
+
+static void encode_game(const GameRecord *game, uint8_t *out) {
+  RecordGameHeader header = {
+    .black_removal = (uint8_t)game->black_removal,
+    .white_removal = (uint8_t)game->white_removal,
+    .winner = (uint8_t)game->winner,
+    .num_moves = (uint16_t)game->num_moves
+  };
+  memcpy(out, &header, sizeof(header));
+  out += sizeof(header);
+
+  for (int i = 0; i < game->num_moves; i++) {
+    const MoveSequence *seq = &game->moves[i];
+    *out++ = (uint8_t)MOVE_FROM(seq->jumps[0]);
+    *out++ = (uint8_t)seq->count;
+
+    int dir_bytes = (seq->count + 3) / 4;
+    memset(out, 0, dir_bytes);
+    for (int j = 0; j < seq->count; j++)
+      out[j / 4] |= (uint8_t)(MOVE_DIRECTION(seq->jumps[j]) << (2 * (j % 4)));
+    out += dir_bytes;
+  }
+}
+
+// Decode one move; NULL if it is malformed or runs past end
+static const uint8_t *decode_move(const uint8_t *p, const uint8_t *end, MoveSequence *seq) {
+  if (end - p < 2) return NULL;
+
+  int from = p[0], count = p[1];
+  int dir_bytes = (count + 3) / 4;
+  if (from >= TOTAL_CELLS || count == 0 || count > MAX_MOVES || end - p < 2 + dir_bytes)
+    return NULL;
+
+  const uint8_t *dirs = p + 2;
+  int row, col;
+  index_to_coord(from, &row, &col);
+
+  seq->count = 0;
+  for (int j = 0; j < count; j++) {
+    int dir = (dirs[j / 4] >> (2 * (j % 4))) & 0x3;
+    int land_row = row + 2 * dir_row[dir], land_col = col + 2 * dir_col[dir];
+    if (!is_valid_position(land_row, land_col)) return NULL;
+
+    seq->jumps[seq->count++] = create_simple_jump(row, col, land_row, land_col,
+                                                  row + dir_row[dir], col + dir_col[dir], dir);
+    row = land_row;
+    col = land_col;
+  }
+
+  return p + 2 + dir_bytes;
+}
+
+// Size of the record at p without decoding it; 0 if malformed
+static size_t record_size(const uint8_t *p, const uint8_t *end) {
+  RecordGameHeader header;
+  if ((size_t)(end - p) < sizeof(header)) return 0;
+  memcpy(&header, p, sizeof(header));
+  int black_removal = header.black_removal, white_removal = header.white_removal;
+  if (header.num_moves > RECORD_MAX_PLIES || black_removal >= TOTAL_CELLS ||
+      white_removal >= TOTAL_CELLS)
+    return 0;
+
+  const uint8_t *q = p + sizeof(header);
+  for (int i = 0; i < header.num_moves; i++) {
+    if (end - q < 2) return 0;
+    int dir_bytes = (q[1] + 3) / 4;
+    if (end - q < 2 + dir_bytes) return 0;
+    q += 2 + dir_bytes;
+  }
+
+  return (size_t)(q - p);
+}
+
+/* Offsets of every complete record in data[start, end); returns how many
+   were found and where the last one ends */
+static uint64_t scan_records(const uint8_t *data, uint64_t start, uint64_t end,
+                             uint64_t **index_out, uint64_t *data_end) {
+  uint64_t count = 0, capacity = 0, pos = start;
+  uint64_t *index = NULL;
+
+  while (pos < end) {
+    size_t size = record_size(data + pos, data + end);
+    if (size == 0) break;
+
+    if (count == capacity) {
+      capacity = capacity ? capacity * 2 : 1024;
+      uint64_t *grown = realloc(index, capacity * sizeof(uint64_t));
+      if (!grown) break;
+      index = grown;
+    }
+
+    index[count++] = pos;
+    pos += size;
+  }
+
+  *index_out = index;
+  *data_end = pos;
+  return count;
+}
+
+/* ---- Writer ---- */
+
+static bool write_header(FILE *f, uint64_t count, uint64_t index_offset) {
+  ArchiveHeader header = { .board_size = BOARD_SIZE, .count = count, .index_offset = index_offset };
+  memcpy(header.magic, RECORD_MAGIC, 4);
+
+  return fseeko(f, 0, SEEK_SET) == 0 && fwrite(&header, sizeof(header), 1, f) == 1;
+}
+
+// Load the index of an existing archive into the writer
+static bool writer_load(ArchiveWriter *w, const char *path) {
+  Archive *archive = archive_open(path);
+  if (!archive) return false;
+
+  w->count = archive->count;
+  w->capacity = w->count > 1024 ? w->count : 1024;
+  w->index = malloc(w->capacity * sizeof(uint64_t));
+  if (!w->index) {
+    archive_close(archive);
+    return false;
+  }
+  memcpy(w->index, archive->index, w->count * sizeof(uint64_t));
+
+  /* New games overwrite the old index */
+  w->data_end = sizeof(ArchiveHeader);
+  if (w->count) {
+    uint64_t last = w->index[w->count - 1];
+    w->data_end = last + record_size(archive->data + last, archive->data + archive->map_size);
+  }
+
+  archive_close(archive);
+  return true;
+}
+
+// Open an archive for appending (created if missing)
+ArchiveWriter *archive_writer_open(const char *path) {
+  ArchiveWriter *w = calloc(1, sizeof(ArchiveWriter));
+  if (!w) return NULL;
+
+  struct stat st;
+  bool exists = stat(path, &st) == 0 && st.st_size > 0;
+
+  if (exists && !writer_load(w, path)) {
+    free(w);
+    return NULL;
+  }
+
+  if (!exists) {
+    w->capacity = 1024;
+    w->index = malloc(w->capacity * sizeof(uint64_t));
+    w->data_end = sizeof(ArchiveHeader);
+  }
+
+  /* Drop the old index right away, so an interrupted session leaves
+     only complete records (plus at most one partial) behind it */
+  w->file = fopen(path, exists ? "r+b" : "w+b");
+  if (!w->index || !w->file || !write_header(w->file, w->count, 0) ||
+      fflush(w->file) != 0 || ftruncate(fileno(w->file), (off_t)w->data_end) != 0 ||
+      fseeko(w->file, (off_t)w->data_end, SEEK_SET) != 0) {
+    if (w->file) fclose(w->file);
+    free(w->index);
+    free(w);
+    return NULL;
+  }
+
+  return w;
+}
+
+bool archive_append(ArchiveWriter *w, const GameRecord *game) {
+  if (!w || !game || game->num_moves < 0 || game->num_moves > RECORD_MAX_PLIES) return false;
+
+  if (w->count == w->capacity) {
+    uint64_t *grown = realloc(w->index, w->capacity * 2 * sizeof(uint64_t));
+    if (!grown) return false;
+    w->index = grown;
+    w->capacity *= 2;
+  }
+
+  uint8_t buf[sizeof(RecordGameHeader) + RECORD_MAX_PLIES * (2 + (MAX_MOVES + 3) / 4)];
+  size_t size = encoded_size(game);
+  encode_game(game, buf);
+
+  if (fwrite(buf, 1, size, w->file) != size) return false;
+
+  w->index[w->count++] = w->data_end;
+  w->data_end += size;
+  return true;
+}
+
+// Write the index and header; the writer is freed either way
+bool archive_writer_close(ArchiveWriter *w) {
+  if (!w) return false;
+
+  static const uint8_t pad[8] = { 0 };
+  uint64_t index_offset = (w->data_end + 7) & ~(uint64_t)7;
+  uint64_t file_end = index_offset + w->count * sizeof(uint64_t);
+
+  bool ok = fwrite(pad, 1, index_offset - w->data_end, w->file) == index_offset - w->data_end &&
+            fwrite(w->index, sizeof(uint64_t), w->count, w->file) == w->count &&
+            fflush(w->file) == 0 &&
+            ftruncate(fileno(w->file), (off_t)file_end) == 0 &&
+            write_header(w->file, w->count, index_offset);
+
+  ok = (fclose(w->file) == 0) && ok;
+  free(w->index);
+  free(w);
+  return ok;
+}
+
+/* ---- Reader ---- */
+
+// Memory-map an archive for reading
+Archive *archive_open(const char *path) {
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) return NULL;
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(ArchiveHeader)) {
+    close(fd);
+    return NULL;
+  }
+
+  void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) return NULL;
+
+  const ArchiveHeader *header = map;
+  uint64_t size = (uint64_t)st.st_size;
+
+  if (memcmp(header->magic, RECORD_MAGIC, 4) != 0 || header->board_size != BOARD_SIZE) {
+    munmap(map, st.st_size);
+    return NULL;
+  }
+
+  Archive *archive = calloc(1, sizeof(Archive));
+  if (!archive) {
+    munmap(map, st.st_size);
+    return NULL;
+  }
+
+  archive->map = map;
+  archive->map_size = st.st_size;
+  archive->data = map;
+
+  bool indexed = header->index_offset >= sizeof(ArchiveHeader) &&
+                 header->index_offset <= size &&
+                 header->index_offset % 8 == 0 &&
+                 header->count <= (size - header->index_offset) / sizeof(uint64_t);
+
+  if (indexed) {
+    archive->index = (const uint64_t *)(archive->data + header->index_offset);
+    archive->count = header->count;
+  } else {
+    /* Writer still open or interrupted: recover whatever is complete */
+    uint64_t data_end;
+    archive->count = scan_records(archive->data, sizeof(ArchiveHeader), size,
+                                  &archive->owned_index, &data_end);
+    archive->index = archive->owned_index;
+  }
+
+  return archive;
+}
+
+void archive_close(Archive *archive) {
+  if (!archive) return;
+  munmap(archive->map, archive->map_size);
+  free(archive->owned_index);
+  free(archive);
+}
+
+uint64_t archive_count(const Archive *archive) {
+  return archive ? archive->count : 0;
+}
+
+// Decode game n (0-based)
+bool archive_game(const Archive *archive, uint64_t n, GameRecord *game) {
+  if (!archive || n >= archive->count) return false;
+
+  const uint8_t *end = archive->data + archive->map_size;
+  const uint8_t *p = archive->data + archive->index[n];
+  RecordGameHeader header;
+
+  if (archive->index[n] >= archive->map_size || (size_t)(end - p) < sizeof(header)) return false;
+  memcpy(&header, p, sizeof(header));
+  if (header.num_moves > RECORD_MAX_PLIES) return false;
+  p += sizeof(header);
+
+  game->black_removal = header.black_removal;
+  game->white_removal = header.white_removal;
+  game->winner = header.winner;
+  game->num_moves = header.num_moves;
+
+  for (int i = 0; i < game->num_moves; i++) {
+    p = decode_move(p, end, &game->moves[i]);
+    if (!p) return false;
+  }
+
+  return true;
+}
+
+// Iterate over all positions of all games
+void archive_positions_begin(const Archive *archive, ArchivePositions *it) {
+  memset(it, 0, sizeof(*it));
+  it->archive = archive;
+  /* ply == num_moves == 0 makes the first call load game 0 */
+}
+
+// Load the header and start position of the cursor's current game
+static bool positions_load_game(ArchivePositions *it) {
+  const Archive *archive = it->archive;
+
+  while (it->game < archive->count) {
+    const uint8_t *p = archive->data + archive->index[it->game];
+    RecordGameHeader header;
+    GameRecord removals;
+
+    if (archive->index[it->game] + sizeof(header) <= archive->map_size) {
+      memcpy(&header, p, sizeof(header));
+      removals.black_removal = header.black_removal;
+      removals.white_removal = header.white_removal;
+
+      if (header.num_moves > 0 && record_start_board(&removals, &it->board)) {
+        it->next = p + sizeof(header);
+        it->ply = 0;
+        it->num_moves = header.num_moves;
+        it->winner = header.winner;
+        it->is_white_turn = false;
+        return true;
+      }
+    }
+
+    it->game++;
+  }
+
+  return false;
+}
+
+bool archive_positions_next(ArchivePositions *it, Board *board, bool *is_white_turn,
+                            MoveSequence *played, int *winner) {
+  const uint8_t *end = it->archive->data + it->archive->map_size;
+
+  while (true) {
+    if (it->ply >= it->num_moves) {
+      if (it->num_moves > 0) it->game++;
+      if (!positions_load_game(it)) return false;
+    }
+
+    MoveSequence seq;
+    const uint8_t *next = decode_move(it->next, end, &seq);
+    if (!next) {
+      /* Corrupt record: skip the rest of the game */
+      it->ply = it->num_moves;
+      continue;
+    }
+
+    if (board) *board = it->board;
+    if (is_white_turn) *is_white_turn = it->is_white_turn;
+    if (played) *played = seq;
+    if (winner) *winner = it->winner;
+
+    execute_sequence(&it->board, &seq, it->is_white_turn);
+    it->is_white_turn = !it->is_white_turn;
+    it->next = next;
+    it->ply++;
+    return true;
+  }
+}
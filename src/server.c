@@ -0,0 +1,759 @@
+/* Analysis server (see server.h) and its load generator. The listener
+   accepts connections, one reader thread per connection turns lines into
+   jobs on a shared bounded queue, and a fixed pool of workers, each owning
+   an engine, answers them. A connection is reference counted by its
+   reader and its queued jobs, so it stays valid until the last answer. */
+#include "server.h"
+#include <errno.h>
+#include <poll.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#define SERVER_ID_MAX 32
+#define SERVER_READ_BUF (SERVER_LINE_MAX * 16)
+#define SERVER_POLL_MS 200
+
+typedef struct Conn {
+  int fd;
+  int refs;             // reader + queued jobs (server lock)
+  bool closed;          // reader gone: drop its remaining jobs
+  pthread_mutex_t write_lock;
+  struct Conn *next;
+  struct Server *server;
+} Conn;
+
+typedef struct {
+  Conn *conn;
+  char id[SERVER_ID_MAX];
+  Board board;
+  bool is_white_turn;
+  SearchLimits limits;
+  double received;
+  double deadline;      // wall clock, 0 = none
+} Job;
+
+typedef struct Server {
+  const ServerConfig *config;
+  ServerStats *stats;
+  pthread_mutex_t lock;
+  pthread_cond_t work_cond;
+  pthread_cond_t idle_cond;
+  Job **queue;          // ring of queue_max slots
+  int head;
+  bool closing;
+  Conn *conns;
+  int readers;
+} Server;
+
+typedef struct {
+  Server *server;
+  Engine *engine;
+} ServerWorker;
+
+ServerConfig server_default_config(void) {
+  ServerConfig config = {
+    .socket_path = SERVER_DEF_SOCKET,
+    .threads = 0,
+    .hash_mb = SERVER_DEF_HASH_MB,
+    .queue_max = SERVER_DEF_QUEUE,
+    .limits = { .depth = DEF_DEPTH }
+  };
+  return config;
+}
+
+static double elapsed_ms(double since) {
+  return (wall_seconds() - since) * 1000.0;
+}
+
+// Write a whole buffer; false once the peer is gone
+static bool send_all(int fd, const char *buf, size_t len) {
+  while (len > 0) {
+    ssize_t n = send(fd, buf, len, MSG_NOSIGNAL);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) return false;
+    buf += n;
+    len -= (size_t)n;
+  }
+  return true;
+}
+
+static void conn_reply(Conn *conn, const char *line) {
+  pthread_mutex_lock(&conn->write_lock);
+  send_all(conn->fd, line, strlen(line));
+  pthread_mutex_unlock(&conn->write_lock);
+}
+
+// Drop one reference (server lock held); the last one closes the socket
+static void conn_release(Server *server, Conn *conn) {
+  if (--conn->refs > 0) return;
+
+  for (Conn **c = &server->conns; *c; c = &(*c)->next) {
+    if (*c == conn) {
+      *c = conn->next;
+      break;
+    }
+  }
+  close(conn->fd);
+  pthread_mutex_destroy(&conn->write_lock);
+  free(conn);
+}
+
+/* ---- Workers ---- */
+
+static void answer_job(ServerWorker *w, Job *job) {
+  Server *server = w->server;
+  char line[SERVER_ID_MAX + MOVE_TEXT_MAX + 128];
+  double queued_ms = elapsed_ms(job->received);
+  SearchLimits limits = job->limits;
+
+  /* Whatever is left of the deadline caps the search */
+  if (job->deadline > 0) {
+    int left_ms = (int)((job->deadline - wall_seconds()) * 1000.0);
+    if (left_ms < 1) left_ms = 1;
+    if (limits.movetime_ms <= 0 || limits.movetime_ms > left_ms) limits.movetime_ms = left_ms;
+  }
+
+  SearchResult result;
+  bool found = engine_search(w->engine, &job->board, job->is_white_turn, &limits, &result);
+
+  if (found) {
+    char move[MOVE_TEXT_MAX];
+    move_sequence_to_text(&result.best, move);
+    snprintf(line, sizeof(line), "%s bestmove %s score %d depth %d nodes %llu queue %.1f time %.1f\n",
+             job->id, move, result.score, result.depth, (unsigned long long)result.nodes,
+             queued_ms, result.seconds * 1000.0);
+  } else {
+    snprintf(line, sizeof(line), "%s bestmove none queue %.1f time %.1f\n",
+             job->id, queued_ms, result.seconds * 1000.0);
+  }
+
+  /* Count before replying, so a client's next stats query includes it */
+  pthread_mutex_lock(&server->lock);
+  server->stats->running--;
+  server->stats->completed++;
+  server->stats->nodes += result.nodes;
+  server->stats->queue_seconds += queued_ms / 1000.0;
+  pthread_mutex_unlock(&server->lock);
+
+  conn_reply(job->conn, line);
+}
+
+static void *server_worker(void *arg) {
+  ServerWorker *w = arg;
+  Server *server = w->server;
+  ServerStats *stats = server->stats;
+  char line[SERVER_ID_MAX + 64];
+
+  pthread_mutex_lock(&server->lock);
+  while (true) {
+    while (stats->queue_depth == 0 && !server->closing)
+      pthread_cond_wait(&server->work_cond, &server->lock);
+    if (stats->queue_depth == 0) break;
+
+    Job *job = server->queue[server->head];
+    server->head = (server->head + 1) % server->config->queue_max;
+    stats->queue_depth--;
+
+    if (server->closing || job->conn->closed) {
+      stats->dropped++;
+      line[0] = '\0';
+    } else if (job->deadline > 0 && wall_seconds() >= job->deadline) {
+      stats->expired++;
+      snprintf(line, sizeof(line), "%s expired queue %.1f\n", job->id, elapsed_ms(job->received));
+    } else {
+      stats->running++;
+      pthread_mutex_unlock(&server->lock);
+
+      answer_job(w, job);
+
+      pthread_mutex_lock(&server->lock);
+      line[0] = '\0';
+    }
+
+    if (line[0]) {
+      pthread_mutex_unlock(&server->lock);
+      conn_reply(job->conn, line);
+      pthread_mutex_lock(&server->lock);
+    }
+
+    conn_release(server, job->conn);
+    free(job);
+  }
+  pthread_mutex_unlock(&server->lock);
+
+  return NULL;
+}
+
+/* ---- Connections ---- */
+
+// Parse "<id> <position> [depth D] [movetime MS] [nodes N] [deadline MS]"
+static bool parse_request(char **tok, int n, const ServerConfig *config, Job *job) {
+  char text[BOARD_TEXT_MAX + 8];
+  int deadline_ms = 0;
+
+  if (n < 3) return false;
+  snprintf(text, sizeof(text), "%s %s", tok[1], tok[2]);
+  if (!board_from_text(text, &job->board, &job->is_white_turn)) return false;
+
+  /* A worker could only fail on a position with more moves than a list holds */
+  if (count_all_moves(&job->board, job->is_white_turn) > MAX_SEQUENCES) return false;
+
+  SearchLimits limits = { 0 };
+  for (int i = 3; i < n; i++) {
+    if (i + 1 >= n) return false;
+    if (!strcmp(tok[i], "depth")) limits.depth = atoi(tok[++i]);
+    else if (!strcmp(tok[i], "movetime")) limits.movetime_ms = atoi(tok[++i]);
+    else if (!strcmp(tok[i], "nodes")) limits.nodes = strtoull(tok[++i], NULL, 10);
+    else if (!strcmp(tok[i], "deadline")) deadline_ms = atoi(tok[++i]);
+    else return false;
+  }
+
+  if (limits.depth < 0 || limits.movetime_ms < 0 || deadline_ms < 0) return false;
+  if (!limits.depth && !limits.movetime_ms && !limits.nodes) limits = config->limits;
+
+  job->limits = limits;
+  job->received = wall_seconds();
+  job->deadline = deadline_ms > 0 ? job->received + deadline_ms / 1000.0 : 0.0;
+  return true;
+}
+
+static void handle_line(Conn *conn, char *line) {
+  Server *server = conn->server;
+  ServerStats *stats = server->stats;
+  char *tok[16], *save;
+  char reply[SERVER_ID_MAX + 256];
+  int n = 0;
+
+  for (char *t = strtok_r(line, " \t\r", &save); t && n < 16; t = strtok_r(NULL, " \t\r", &save))
+    tok[n++] = t;
+  if (n == 0) return;
+
+  char id[SERVER_ID_MAX];
+  snprintf(id, sizeof(id), "%s", tok[0]);
+
+  if (n == 2 && !strcmp(tok[1], "stats")) {
+    pthread_mutex_lock(&server->lock);
+    snprintf(reply, sizeof(reply),
+             "%s stats queue %d max_queue %d running %d accepted %llu completed %llu "
+             "expired %llu rejected %llu invalid %llu dropped %llu\n",
+             id, stats->queue_depth, stats->max_queue_depth, stats->running,
+             (unsigned long long)stats->accepted, (unsigned long long)stats->completed,
+             (unsigned long long)stats->expired, (unsigned long long)stats->rejected,
+             (unsigned long long)stats->invalid, (unsigned long long)stats->dropped);
+    pthread_mutex_unlock(&server->lock);
+    conn_reply(conn, reply);
+    return;
+  }
+
+  Job *job = malloc(sizeof(Job));
+  if (!job || !parse_request(tok, n, server->config, job)) {
+    free(job);
+    pthread_mutex_lock(&server->lock);
+    stats->invalid++;
+    pthread_mutex_unlock(&server->lock);
+    snprintf(reply, sizeof(reply), "%s error bad request\n", id);
+    conn_reply(conn, reply);
+    return;
+  }
+
+  memcpy(job->id, id, sizeof(id));
+  job->conn = conn;
+
+  pthread_mutex_lock(&server->lock);
+  if (stats->queue_depth >= server->config->queue_max) {
+    stats->rejected++;
+    pthread_mutex_unlock(&server->lock);
+    free(job);
+    snprintf(reply, sizeof(reply), "%s busy\n", id);
+    conn_reply(conn, reply);
+    return;
+  }
+
+  int tail = (server->head + stats->queue_depth) % server->config->queue_max;
+  server->queue[tail] = job;
+  conn->refs++;
+  stats->accepted++;
+  if (++stats->queue_depth > stats->max_queue_depth) stats->max_queue_depth = stats->queue_depth;
+  pthread_cond_signal(&server->work_cond);
+  pthread_mutex_unlock(&server->lock);
+}
+
+static void *conn_reader(void *arg) {
+  Conn *conn = arg;
+  Server *server = conn->server;
+  char buf[SERVER_READ_BUF];
+  size_t len = 0;
+  bool discarding = false;  // inside an over-long line
+
+  while (true) {
+    ssize_t n = read(conn->fd, buf + len, sizeof(buf) - len);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) break;
+    len += (size_t)n;
+
+    char *start = buf, *nl;
+    while ((nl = memchr(start, '\n', len - (size_t)(start - buf)))) {
+      *nl = '\0';
+      if (!discarding && nl - start < SERVER_LINE_MAX) handle_line(conn, start);
+      discarding = false;
+      start = nl + 1;
+    }
+
+    len -= (size_t)(start - buf);
+    memmove(buf, start, len);
+
+    if (len >= SERVER_LINE_MAX) {
+      if (!discarding) conn_reply(conn, "- error line too long\n");
+      discarding = true;
+      len = 0;
+    }
+  }
+
+  pthread_mutex_lock(&server->lock);
+  conn->closed = true;
+  server->readers--;
+  pthread_cond_broadcast(&server->idle_cond);
+  conn_release(server, conn);
+  pthread_mutex_unlock(&server->lock);
+  return NULL;
+}
+
+static void accept_conn(Server *server, int listen_fd) {
+  int fd = accept(listen_fd, NULL, NULL);
+  if (fd < 0) return;
+
+  Conn *conn = calloc(1, sizeof(Conn));
+  if (!conn) {
+    close(fd);
+    return;
+  }
+
+  conn->fd = fd;
+  conn->refs = 1;
+  conn->server = server;
+  pthread_mutex_init(&conn->write_lock, NULL);
+
+  pthread_attr_t attr;
+  pthread_t tid;
+  pthread_attr_init(&attr);
+  pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+
+  pthread_mutex_lock(&server->lock);
+  conn->next = server->conns;
+  server->conns = conn;
+  server->readers++;
+  server->stats->connections++;
+
+  if (pthread_create(&tid, &attr, conn_reader, conn) != 0) {
+    server->readers--;
+    conn_release(server, conn);
+  }
+  pthread_mutex_unlock(&server->lock);
+  pthread_attr_destroy(&attr);
+}
+
+// Bind the listening socket, replacing a stale socket file (never other files)
+static int listen_unix(const char *path) {
+  struct sockaddr_un addr = { .sun_family = AF_UNIX };
+  struct stat st;
+
+  if (strlen(path) >= sizeof(addr.sun_path)) return -1;
+  strcpy(addr.sun_path, path);
+
+  if (stat(path, &st) == 0) {
+    if (!S_ISSOCK(st.st_mode)) return -1;
+    unlink(path);
+  }
+
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0) return -1;
+  if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(fd, 128) < 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+// Serve until *quit becomes non-zero (e.g. from a signal handler)
+bool server_run(const ServerConfig *config, volatile sig_atomic_t *quit, ServerStats *stats) {
+  if (!config || !quit || !stats || config->queue_max <= 0) return false;
+
+  memset(stats, 0, sizeof(*stats));
+
+  int threads = config->threads;
+  if (threads <= 0) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    threads = cpus > 0 ? (int)cpus : 1;
+  }
+
+  int listen_fd = listen_unix(config->socket_path);
+  if (listen_fd < 0) {
+    printf("Cannot listen on %s\n", config->socket_path);
+    return false;
+  }
+
+  Server server = { .config = config, .stats = stats };
+  server.queue = calloc((size_t)config->queue_max, sizeof(Job *));
+  ServerWorker *workers = calloc((size_t)threads, sizeof(ServerWorker));
+  pthread_t *tids = calloc((size_t)threads, sizeof(pthread_t));
+
+  pthread_mutex_init(&server.lock, NULL);
+  pthread_cond_init(&server.work_cond, NULL);
+  pthread_cond_init(&server.idle_cond, NULL);
+
+  int started = 0;
+  if (server.queue && workers && tids) {
+    for (; started < threads; started++) {
+      workers[started].server = &server;
+      workers[started].engine = engine_create(config->hash_mb);
+      if (!workers[started].engine) break;
+      if (pthread_create(&tids[started], NULL, server_worker, &workers[started]) != 0) {
+        engine_free(workers[started].engine);
+        break;
+      }
+    }
+  }
+
+  double start = wall_seconds();
+
+  if (started > 0) {
+    printf("Serving on %s with %d workers (%zu MB hash each)\n",
+           config->socket_path, started, config->hash_mb);
+    fflush(stdout);
+
+    struct pollfd pfd = { .fd = listen_fd, .events = POLLIN };
+    while (!*quit) {
+      if (poll(&pfd, 1, SERVER_POLL_MS) > 0 && (pfd.revents & POLLIN)) accept_conn(&server, listen_fd);
+    }
+  }
+
+  close(listen_fd);
+  unlink(config->socket_path);
+
+  /* Wake every reader, wait for them, then let the workers drain the queue */
+  pthread_mutex_lock(&server.lock);
+  server.closing = true;
+  for (Conn *c = server.conns; c; c = c->next) shutdown(c->fd, SHUT_RDWR);
+  while (server.readers > 0) pthread_cond_wait(&server.idle_cond, &server.lock);
+  pthread_cond_broadcast(&server.work_cond);
+  pthread_mutex_unlock(&server.lock);
+
+  for (int t = 0; t < started; t++) engine_stop(workers[t].engine);
+  for (int t = 0; t < started; t++) {
+    pthread_join(tids[t], NULL);
+    engine_free(workers[t].engine);
+  }
+
+  stats->seconds = wall_seconds() - start;
+
+  pthread_cond_destroy(&server.idle_cond);
+  pthread_cond_destroy(&server.work_cond);
+  pthread_mutex_destroy(&server.lock);
+  free(server.queue);
+  free(workers);
+  free(tids);
+
+  return started > 0;
+}
+
+void print_server_stats(const ServerStats *stats) {
+  printf("%llu connections, %llu requests in %.1fs\n",
+         (unsigned long long)stats->connections, (unsigned long long)stats->accepted, stats->seconds);
+  printf("  completed %llu, expired %llu, rejected %llu, invalid %llu, dropped %llu\n",
+         (unsigned long long)stats->completed, (unsigned long long)stats->expired,
+         (unsigned long long)stats->rejected, (unsigned long long)stats->invalid,
+         (unsigned long long)stats->dropped);
+  printf("  max queue depth %d, mean queue wait %.2f ms, %.0f nodes/s\n",
+         stats->max_queue_depth,
+         stats->completed ? stats->queue_seconds * 1000.0 / stats->completed : 0.0,
+         stats->seconds > 0 ? stats->nodes / stats->seconds : 0.0);
+}
+
+/* ---- Load generator ---- */
+
+typedef struct {
+  const LoadgenConfig *config;
+  char (*positions)[BOARD_TEXT_MAX];
+  int num_positions;
+  double *sent_at;      // per request
+  double *latency_ms;   // per request, < 0 = no reply
+  char *outcome;        // per request: 'b'estmove, 'e'xpired, 'B'usy, 'x' error
+} Loadgen;
+
+typedef struct {
+  Loadgen *lg;
+  int index;
+  int stray;            // replies matching no request awaiting one
+  bool ok;
+} LoadgenConn;
+
+LoadgenConfig loadgen_default_config(void) {
+  LoadgenConfig config = {
+    .socket_path = SERVER_DEF_SOCKET,
+    .positions_path = NULL,
+    .requests = 1000,
+    .connections = 4,
+    .inflight = 8,
+    .limits = { .depth = 4 },
+    .deadline_ms = 0,
+    .seed = 1
+  };
+  return config;
+}
+
+static int connect_unix(const char *path) {
+  struct sockaddr_un addr = { .sun_family = AF_UNIX };
+  if (strlen(path) >= sizeof(addr.sun_path)) return -1;
+  strcpy(addr.sun_path, path);
+
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0) return -1;
+  if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+// Random mid-game positions: random removals, then 0-19 random plies
+static int random_positions(Loadgen *lg, int count, uint64_t seed) {
+  uint64_t rng = seed | 1;
+  int made = 0;
+
+  while (made < count) {
+    Board board;
+    bool white = false;
+    int row, col;
+    MoveSequence seq;
+
+    init_board(&board);
+    do {
+      index_to_coord((int)(random_next(&rng) % TOTAL_CELLS), &row, &col);
+    } while (!execute_initial_removal(&board, row, col, true));
+    do {
+      index_to_coord((int)(random_next(&rng) % TOTAL_CELLS), &row, &col);
+    } while (!execute_initial_removal(&board, row, col, false));
+
+    int plies = (int)(random_next(&rng) % 20);
+    for (int i = 0; i < plies && sample_random_move(&board, white, &rng, &seq); i++) {
+      execute_sequence(&board, &seq, white);
+      white = !white;
+    }
+    if (count_all_moves(&board, white) == 0) continue;
+
+    board_to_text(&board, white, lg->positions[made++]);
+  }
+  return made;
+}
+
+static int file_positions(Loadgen *lg, const char *path, int max) {
+  FILE *f = fopen(path, "r");
+  char line[SERVER_LINE_MAX];
+  int made = 0;
+  if (!f) return 0;
+
+  while (made < max && fgets(line, sizeof(line), f)) {
+    Board board;
+    bool white;
+    line[strcspn(line, "\r\n")] = '\0';
+    if (line[0] == '\0' || line[0] == '#' || !board_from_text(line, &board, &white)) continue;
+    board_to_text(&board, white, lg->positions[made++]);
+  }
+
+  fclose(f);
+  return made;
+}
+
+// Format request number r (ids start at 1; 0 is the closing stats query)
+static int format_request(const Loadgen *lg, int r, char *buf, size_t len) {
+  const LoadgenConfig *config = lg->config;
+  int n = snprintf(buf, len, "%d %s", r + 1, lg->positions[r % lg->num_positions]);
+
+  if (config->limits.depth) n += snprintf(buf + n, len - n, " depth %d", config->limits.depth);
+  if (config->limits.movetime_ms) n += snprintf(buf + n, len - n, " movetime %d", config->limits.movetime_ms);
+  if (config->limits.nodes) n += snprintf(buf + n, len - n, " nodes %llu", (unsigned long long)config->limits.nodes);
+  if (config->deadline_ms) n += snprintf(buf + n, len - n, " deadline %d", config->deadline_ms);
+  n += snprintf(buf + n, len - n, "\n");
+  return n;
+}
+
+/* One connection: requests index, index + C, index + 2C, ... with at most
+   `inflight` of them awaiting a reply at any time */
+static void *loadgen_conn(void *arg) {
+  LoadgenConn *c = arg;
+  Loadgen *lg = c->lg;
+  const LoadgenConfig *config = lg->config;
+  int stride = config->connections;
+  int assigned = (config->requests - c->index + stride - 1) / stride;
+  int sent = 0, answered = 0;
+  char buf[SERVER_READ_BUF], line[SERVER_LINE_MAX + 64];
+  size_t len = 0;
+
+  int fd = connect_unix(config->socket_path);
+  if (fd < 0) return NULL;
+
+  while (answered < assigned) {
+    while (sent < assigned && sent - answered < config->inflight) {
+      int r = c->index + sent * stride;
+      int n = format_request(lg, r, line, sizeof(line));
+      lg->sent_at[r] = wall_seconds();
+      if (!send_all(fd, line, (size_t)n)) goto done;
+      sent++;
+    }
+
+    ssize_t n = read(fd, buf + len, sizeof(buf) - len);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) goto done;
+    len += (size_t)n;
+
+    char *start = buf, *nl;
+    while ((nl = memchr(start, '\n', len - (size_t)(start - buf)))) {
+      *nl = '\0';
+      char *word;
+      long id = strtol(start, &word, 10);
+      if (id >= 1 && id <= config->requests && lg->latency_ms[id - 1] < 0) {
+        int r = (int)id - 1;
+        lg->latency_ms[r] = elapsed_ms(lg->sent_at[r]);
+        while (*word == ' ') word++;
+        lg->outcome[r] = !strncmp(word, "bestmove", 8) ? 'b' : !strncmp(word, "expired", 7) ? 'e' :
+                         !strncmp(word, "busy", 4) ? 'B' : 'x';
+        answered++;
+      } else {
+        /* No id we wait for (e.g. "- error line too long"): some request
+           will never be answered, so free its slot rather than hang */
+        c->stray++;
+        answered++;
+      }
+      start = nl + 1;
+    }
+    len -= (size_t)(start - buf);
+    memmove(buf, start, len);
+    if (len == sizeof(buf)) goto done;
+  }
+  c->ok = true;
+
+done:
+  close(fd);
+  return NULL;
+}
+
+static int compare_double(const void *a, const void *b) {
+  double x = *(const double *)a, y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+static double percentile(const double *sorted, int n, double p) {
+  if (n == 0) return 0.0;
+  int i = (int)(p * (n - 1) + 0.5);
+  return sorted[i];
+}
+
+// Ask the server for its counters and print them
+static void print_server_counters(const char *path) {
+  char buf[SERVER_READ_BUF];
+  size_t len = 0;
+  int fd = connect_unix(path);
+  if (fd < 0) return;
+
+  if (send_all(fd, "0 stats\n", 8)) {
+    ssize_t n;
+    while (len < sizeof(buf) - 1 && (n = read(fd, buf + len, sizeof(buf) - 1 - len)) > 0) {
+      len += (size_t)n;
+      if (memchr(buf, '\n', len)) break;
+    }
+    buf[len] = '\0';
+    if (len > 2) printf("Server: %s", buf + 2);
+  }
+  close(fd);
+}
+
+bool loadgen_run(const LoadgenConfig *config, LoadgenResult *result) {
+  if (!config || !result || config->requests <= 0 || config->connections <= 0 || config->inflight <= 0)
+    return false;
+
+  memset(result, 0, sizeof(*result));
+
+  int conns = config->connections < config->requests ? config->connections : config->requests;
+  LoadgenConfig cfg = *config;
+  cfg.connections = conns;
+
+  Loadgen lg = { .config = &cfg };
+  int max_positions = config->requests < 4096 ? config->requests : 4096;
+  lg.positions = malloc((size_t)max_positions * sizeof(*lg.positions));
+  lg.sent_at = calloc((size_t)config->requests, sizeof(double));
+  lg.latency_ms = malloc((size_t)config->requests * sizeof(double));
+  lg.outcome = calloc((size_t)config->requests, 1);
+  LoadgenConn *cs = calloc((size_t)conns, sizeof(LoadgenConn));
+  pthread_t *tids = calloc((size_t)conns, sizeof(pthread_t));
+  bool ok = false;
+
+  if (!lg.positions || !lg.sent_at || !lg.latency_ms || !lg.outcome || !cs || !tids) goto out;
+
+  lg.num_positions = config->positions_path ? file_positions(&lg, config->positions_path, max_positions)
+                                            : random_positions(&lg, max_positions, config->seed);
+  if (lg.num_positions == 0) {
+    printf("No positions to send\n");
+    goto out;
+  }
+
+  for (int r = 0; r < config->requests; r++) lg.latency_ms[r] = -1.0;
+
+  double start = wall_seconds();
+  int started = 0;
+  for (; started < conns; started++) {
+    cs[started].lg = &lg;
+    cs[started].index = started;
+    if (pthread_create(&tids[started], NULL, loadgen_conn, &cs[started]) != 0) break;
+  }
+  for (int t = 0; t < started; t++) {
+    pthread_join(tids[t], NULL);
+    if (!cs[t].ok) result->errors++;
+    result->errors += cs[t].stray;
+  }
+  result->seconds = wall_seconds() - start;
+
+  /* Latency percentiles over every request that got a reply */
+  int replies = 0;
+  for (int r = 0; r < config->requests; r++) {
+    if (lg.sent_at[r] > 0) result->sent++;
+    if (lg.latency_ms[r] < 0) continue;
+    lg.latency_ms[replies++] = lg.latency_ms[r];
+    switch (lg.outcome[r]) {
+      case 'b': result->answered++; break;
+      case 'e': result->expired++; break;
+      case 'B': result->busy++; break;
+      default: result->errors++; break;
+    }
+  }
+
+  qsort(lg.latency_ms, (size_t)replies, sizeof(double), compare_double);
+  result->p50_ms = percentile(lg.latency_ms, replies, 0.50);
+  result->p90_ms = percentile(lg.latency_ms, replies, 0.90);
+  result->p99_ms = percentile(lg.latency_ms, replies, 0.99);
+  result->max_ms = replies ? lg.latency_ms[replies - 1] : 0.0;
+
+  print_server_counters(config->socket_path);
+  ok = replies > 0;
+
+out:
+  free(lg.positions);
+  free(lg.sent_at);
+  free(lg.latency_ms);
+  free(lg.outcome);
+  free(cs);
+  free(tids);
+  return ok;
+}
+
+void print_loadgen_result(const LoadgenConfig *config, const LoadgenResult *result) {
+  printf("%d requests over %d connections (%d in flight each) in %.2fs: %.1f requests/s\n",
+         result->sent, config->connections, config->inflight, result->seconds,
+         result->seconds > 0 ? result->sent / result->seconds : 0.0);
+  printf("  answered %d, expired %d, busy %d, errors %d\n",
+         result->answered, result->expired, result->busy, result->errors);
+  printf("  latency ms: p50 %.2f  p90 %.2f  p99 %.2f  max %.2f\n",
+         result->p50_ms, result->p90_ms, result->p99_ms, result->max_ms);
+}
@@ -0,0 +1,319 @@
+/* Exact solver based on depth-first proof-number search (df-pn).
+   Konane has no draws and every move removes a stone, so the game graph
+   is acyclic and df-pn needs none of the usual cycle handling. Numbers are
+   kept in negamax form: phi is the cost of proving the side to move wins,
+   delta the cost of proving it loses. */
+#include "solver.h"
+#include "game.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define PN_INF 0x7FFFFFFFu
+#define BUCKET_SIZE 4
+
+typedef struct {
+  uint64_t key;   // 0 = empty slot
+  uint32_t phi;
+  uint32_t delta;
+  uint64_t work;  // nodes spent below this entry (replacement priority)
+} PnEntry;
+
+/* Moves and children of one ply, kept on the heap rather than in the
+   recursive frames */
+typedef struct {
+  MoveSequence moves[MAX_SEQUENCES];
+  Board kids[MAX_SEQUENCES];
+  uint64_t kid_keys[MAX_SEQUENCES];
+} SolverPly;
+
+typedef struct {
+  PnEntry *entries;
+  size_t bucket_mask;
+  size_t used;
+  uint64_t nodes;
+  uint64_t node_limit;
+  bool aborted;
+  bool overflow;  // met a position with more than MAX_SEQUENCES moves
+  SolverPly *plies[TOTAL_CELLS + 1];  // by distance from the root, allocated on first use
+} Solver;
+
+static uint32_t pn_add(uint32_t a, uint32_t b) {
+  if (a == PN_INF || b == PN_INF) return PN_INF;
+  uint64_t sum = (uint64_t)a + b;
+  return sum >= PN_INF ? PN_INF - 1 : (uint32_t)sum;
+}
+
+static PnEntry *pn_lookup(Solver *s, uint64_t key) {
+  PnEntry *bucket = &s->entries[(key & s->bucket_mask) * BUCKET_SIZE];
+  for (int i = 0; i < BUCKET_SIZE; i++) {
+    if (bucket[i].key == key) return &bucket[i];
+  }
+  return NULL;
+}
+
+static void pn_store(Solver *s, uint64_t key, uint32_t phi, uint32_t delta, uint64_t work) {
+  PnEntry *bucket = &s->entries[(key & s->bucket_mask) * BUCKET_SIZE];
+  PnEntry *victim = &bucket[0];
+
+  for (int i = 0; i < BUCKET_SIZE; i++) {
+    if (bucket[i].key == key || bucket[i].key == 0) {
+      victim = &bucket[i];
+      break;
+    }
+    if (bucket[i].work < victim->work) victim = &bucket[i];
+  }
+
+  if (victim->key == 0) s->used++;
+  victim->key = key;
+  victim->phi = phi;
+  victim->delta = delta;
+  victim->work = work;
+}
+
+// Fetch proof/disproof numbers, defaulting unexplored nodes to (1, 1)
+static void pn_get(Solver *s, uint64_t key, uint32_t *phi, uint32_t *delta) {
+  PnEntry *e = pn_lookup(s, key);
+  if (e) {
+    *phi = e->phi;
+    *delta = e->delta;
+  } else {
+    *phi = 1;
+    *delta = 1;
+  }
+}
+
+// The lists of a ply; running out of memory aborts the solve
+static SolverPly *solver_ply(Solver *s, int ply) {
+  if (!s->plies[ply]) s->plies[ply] = malloc(sizeof(SolverPly));
+  if (!s->plies[ply]) s->aborted = true;
+  return s->plies[ply];
+}
+
+// Expand a node `ply` moves below the root until its numbers exceed the thresholds
+static void dfpn_mid(Solver *s, const Board *board, bool is_white_turn, int ply,
+                     uint32_t th_phi, uint32_t th_delta) {
+  uint64_t key = board_hash(board, is_white_turn);
+  uint64_t start_nodes = s->nodes++;
+
+  SolverPly *sp = solver_ply(s, ply);
+  if (!sp) return;
+
+  MoveSequence *moves = sp->moves;
+  int num_moves = generate_all_moves(board, is_white_turn, moves);
+
+  if (num_moves == 0) {
+    pn_store(s, key, PN_INF, 0, 1);
+    return;
+  }
+
+  /* Moves that cannot be listed cannot be proven either */
+  if (num_moves < 0) {
+    s->overflow = s->aborted = true;
+    return;
+  }
+
+  Board *kids = sp->kids;
+  uint64_t *kid_keys = sp->kid_keys;
+  for (int i = 0; i < num_moves; i++) {
+    kids[i] = *board;
+    execute_sequence(&kids[i], &moves[i], is_white_turn);
+    kid_keys[i] = board_hash(&kids[i], !is_white_turn);
+  }
+
+  while (true) {
+    uint32_t phi = PN_INF, delta = 0, second = PN_INF, best_phi = 0;
+    int best = 0;
+
+    for (int i = 0; i < num_moves; i++) {
+      uint32_t c_phi, c_delta;
+      pn_get(s, kid_keys[i], &c_phi, &c_delta);
+
+      if (c_delta < phi) {
+        second = phi;
+        phi = c_delta;
+        best = i;
+        best_phi = c_phi;
+      } else if (c_delta < second) {
+        second = c_delta;
+      }
+      delta = pn_add(delta, c_phi);
+    }
+
+    if (phi >= th_phi || delta >= th_delta || s->aborted) {
+      pn_store(s, key, phi, delta, s->nodes - start_nodes);
+      return;
+    }
+
+    if (s->node_limit && s->nodes >= s->node_limit) {
+      s->aborted = true;
+      pn_store(s, key, phi, delta, s->nodes - start_nodes);
+      return;
+    }
+
+    /* Child thresholds, with the 1+epsilon trick on the sibling bound to
+       avoid thrashing between two nearly equal children. */
+    uint64_t c_th_phi = (uint64_t)th_delta - delta + best_phi;
+    if (c_th_phi > PN_INF) c_th_phi = PN_INF;
+    uint64_t c_th_delta = (uint64_t)second + second / 4 + 1;
+    if (c_th_delta > th_phi) c_th_delta = th_phi;
+
+    dfpn_mid(s, &kids[best], !is_white_turn, ply + 1, (uint32_t)c_th_phi, (uint32_t)c_th_delta);
+  }
+}
+
+// Solve a node from scratch (or from whatever the table already knows)
+static bool dfpn_root(Solver *s, const Board *board, bool is_white_turn, int ply,
+                      uint32_t *phi, uint32_t *delta) {
+  dfpn_mid(s, board, is_white_turn, ply, PN_INF, PN_INF);
+  pn_get(s, board_hash(board, is_white_turn), phi, delta);
+  return *phi == 0 || *delta == 0;
+}
+
+/* Walk the proof tree: the winner plays its cheapest proven win, the loser
+   its most expensive refutation (the longest resistance we know of). The
+   winner needs just one reply proven lost for the opponent, so it takes
+   the cheapest the table already proves and otherwise searches replies
+   only up to the first that is; the loser's every reply is checked. */
+static void extract_pv(Solver *s, const Board *root, bool is_white_turn, SolveResult *result) {
+  Board board = *root;
+  bool side = is_white_turn;
+  result->pv_length = 0;
+
+  while (result->pv_length < TOTAL_CELLS && !s->aborted) {
+    int ply = result->pv_length;
+
+    /* Solved before listing the moves: the search reuses this ply's list */
+    uint32_t phi, delta;
+    pn_get(s, board_hash(&board, side), &phi, &delta);
+    if (phi != 0 && delta != 0 && !dfpn_root(s, &board, side, ply, &phi, &delta)) break;
+
+    SolverPly *sp = solver_ply(s, ply);
+    if (!sp) break;
+    MoveSequence *moves = sp->moves;
+    int num_moves = generate_all_moves(&board, side, moves);
+    if (num_moves <= 0) break;
+
+    bool winning = (phi == 0);
+    int pick = -1;
+    uint64_t pick_work = 0;
+
+    for (int i = 0; i < num_moves; i++) {
+      Board next = board;
+      execute_sequence(&next, &moves[i], side);
+      uint64_t key = board_hash(&next, !side);
+
+      PnEntry *e = pn_lookup(s, key);
+      if (!e || (e->phi != 0 && e->delta != 0)) {
+        if (winning) continue;
+        uint32_t c_phi, c_delta;
+        if (!dfpn_root(s, &next, !side, ply + 1, &c_phi, &c_delta)) return;
+        e = pn_lookup(s, key);
+        if (!e) continue;
+      }
+
+      if (winning && e->delta == 0 && (pick < 0 || e->work < pick_work)) {
+        pick = i;
+        pick_work = e->work;
+      } else if (!winning && e->phi == 0 && (pick < 0 || e->work > pick_work)) {
+        pick = i;
+        pick_work = e->work;
+      }
+    }
+
+    for (int i = 0; winning && pick < 0 && i < num_moves; i++) {
+      Board next = board;
+      execute_sequence(&next, &moves[i], side);
+      uint64_t key = board_hash(&next, !side);
+
+      PnEntry *e = pn_lookup(s, key);
+      if (e && (e->phi == 0 || e->delta == 0)) continue;
+
+      uint32_t c_phi, c_delta;
+      if (!dfpn_root(s, &next, !side, ply + 1, &c_phi, &c_delta)) return;
+      if (c_delta == 0) pick = i;
+    }
+
+    if (pick < 0) break;
+
+    result->pv[result->pv_length++] = moves[pick];
+    execute_sequence(&board, &moves[pick], side);
+    side = !side;
+  }
+}
+
+// Prove the position won or lost for the side to move using df-pn
+bool solve_position(const Board *board, bool is_white_turn,
+                    size_t hash_mb, uint64_t node_limit,
+                    SolveResult *result) {
+  if (!board || !result) return false;
+
+  memset(result, 0, sizeof(*result));
+
+  size_t buckets = 1;
+  size_t bytes = (hash_mb ? hash_mb : 1) * 1024 * 1024;
+  while (buckets * 2 * BUCKET_SIZE * sizeof(PnEntry) <= bytes) buckets *= 2;
+
+  Solver s = { 0 };
+  s.entries = calloc(buckets * BUCKET_SIZE, sizeof(PnEntry));
+  if (!s.entries) return false;
+  s.bucket_mask = buckets - 1;
+  s.node_limit = node_limit;
+
+  clock_t start = clock();
+
+  /* A proven root stays proven when the line's own searches run out of
+     budget; only the line is cut short */
+  uint32_t phi, delta;
+  if (dfpn_root(&s, board, is_white_turn, 0, &phi, &delta)) {
+    result->outcome = (phi == 0) ? SOLVE_WIN : SOLVE_LOSS;
+    extract_pv(&s, board, is_white_turn, result);
+    result->pv_truncated = s.aborted;
+  } else {
+    result->move_overflow = s.overflow;
+  }
+
+  result->seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+  result->nodes = s.nodes;
+  result->hash_entries = buckets * BUCKET_SIZE;
+  result->hash_used = s.used;
+
+  for (int i = 0; i <= TOTAL_CELLS; i++) free(s.plies[i]);
+  free(s.entries);
+  return result->outcome != SOLVE_UNKNOWN;
+}
+
+// Print a SolveResult
+void print_solve_result(const SolveResult *result, bool is_white_turn) {
+  const char *mover = is_white_turn ? "White" : "Black";
+  const char *other = is_white_turn ? "Black" : "White";
+
+  if (result->outcome == SOLVE_UNKNOWN) {
+    if (result->move_overflow)
+      printf("Result: unknown (a position has more than %d moves)\n", MAX_SEQUENCES);
+    else
+      printf("Result: unknown (node limit reached)\n");
+  } else {
+    printf("Result: %s to move %s\n", mover,
+           result->outcome == SOLVE_WIN ? "WINS" : "LOSES");
+    printf("Winner: %s\n", result->outcome == SOLVE_WIN ? mover : other);
+  }
+
+  if (result->pv_length > 0 || result->pv_truncated) {
+    printf("Winning line (%d plies%s):\n", result->pv_length,
+           result->pv_truncated ? ", cut short" : "");
+    for (int i = 0; i < result->pv_length; i++) {
+      bool white = (i % 2 == 0) ? is_white_turn : !is_white_turn;
+      printf(" %2d. %s ", i + 1, white ? "White" : "Black");
+      print_move_sequence(&result->pv[i]);
+    }
+  }
+
+  double nps = result->seconds > 0 ? result->nodes / result->seconds : 0.0;
+  printf("Nodes: %llu, time=%.3fs, %.0f nodes/sec\n",
+         (unsigned long long)result->nodes, result->seconds, nps);
+  printf("Hash: %zu / %zu entries used (%.1f%%)\n",
+         result->hash_used, result->hash_entries,
+         result->hash_entries ? 100.0 * result->hash_used / result->hash_entries : 0.0);
+}
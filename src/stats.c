@@ -0,0 +1,70 @@
+/* Search statistics: derived figures and output (see stats.h). */
+#include "stats.h"
+#include "cpu.h"
+#include <string.h>
+
+void search_stats_reset(SearchStats *stats) {
+  memset(stats, 0, sizeof(*stats));
+}
+
+// Share of cutoffs made by the first move (move ordering quality)
+double search_stats_first_cutoff_rate(const SearchStats *stats) {
+  return stats->beta_cutoffs ? (double)stats->first_move_cutoffs / stats->beta_cutoffs : 0.0;
+}
+
+// Nodes of iteration d over nodes of iteration d - 1 (0 if unknown)
+double search_stats_ebf(const SearchStats *stats, int depth) {
+  if (depth < 2 || depth > STATS_MAX_DEPTH) return 0.0;
+  if (!stats->depth_nodes[depth - 1] || !stats->depth_nodes[depth]) return 0.0;
+  return (double)stats->depth_nodes[depth] / stats->depth_nodes[depth - 1];
+}
+
+void print_search_stats(const SearchStats *stats) {
+  printf("Kernels: %s\n", cpu_kernels->name);
+  printf("Nodes: %llu (%llu leaf evals, %llu terminal) in %.3fs, %.0f nodes/s\n",
+         (unsigned long long)stats->nodes, (unsigned long long)stats->leaf_evals,
+         (unsigned long long)stats->terminal_nodes, stats->seconds,
+         stats->seconds > 0 ? stats->nodes / stats->seconds : 0.0);
+  printf("Beta cutoffs: %llu, %.1f%% by the first move\n",
+         (unsigned long long)stats->beta_cutoffs, 100.0 * search_stats_first_cutoff_rate(stats));
+  if (stats->hash_probes) {
+    printf("Hash: %llu probes, %.1f%% hits, %llu cutoffs\n",
+           (unsigned long long)stats->hash_probes,
+           100.0 * stats->hash_hits / stats->hash_probes, (unsigned long long)stats->hash_cutoffs);
+  }
+  printf("Longest jump chain: %d\n", stats->max_sequence);
+
+  for (int d = 1; d <= stats->depth; d++) {
+    if (!stats->depth_nodes[d]) continue;
+    printf("  depth %2d: %12llu nodes %9.3fs", d, (unsigned long long)stats->depth_nodes[d],
+           stats->depth_seconds[d]);
+    double ebf = search_stats_ebf(stats, d);
+    if (ebf > 0) printf("  EBF %.2f", ebf);
+    printf("\n");
+  }
+}
+
+// One JSON object on a single line
+void search_stats_json(const SearchStats *stats, FILE *out) {
+  fprintf(out, "{\"kernels\":\"%s\",\"nodes\":%llu,\"leaf_evals\":%llu,\"terminal_nodes\":%llu,"
+               "\"beta_cutoffs\":%llu,\"first_move_cutoffs\":%llu,\"first_cutoff_rate\":%.4f,"
+               "\"hash_probes\":%llu,\"hash_hits\":%llu,\"hash_cutoffs\":%llu,"
+               "\"max_sequence\":%d,\"depth\":%d,\"seconds\":%.6f,\"iterations\":[",
+          cpu_kernels->name,
+          (unsigned long long)stats->nodes, (unsigned long long)stats->leaf_evals,
+          (unsigned long long)stats->terminal_nodes, (unsigned long long)stats->beta_cutoffs,
+          (unsigned long long)stats->first_move_cutoffs, search_stats_first_cutoff_rate(stats),
+          (unsigned long long)stats->hash_probes, (unsigned long long)stats->hash_hits,
+          (unsigned long long)stats->hash_cutoffs, stats->max_sequence, stats->depth,
+          stats->seconds);
+
+  bool first = true;
+  for (int d = 1; d <= stats->depth; d++) {
+    if (!stats->depth_nodes[d]) continue;
+    fprintf(out, "%s{\"depth\":%d,\"nodes\":%llu,\"seconds\":%.6f,\"ebf\":%.3f}",
+            first ? "" : ",", d, (unsigned long long)stats->depth_nodes[d],
+            stats->depth_seconds[d], search_stats_ebf(stats, d));
+    first = false;
+  }
+  fprintf(out, "]}\n");
+}
@@ -0,0 +1,267 @@
+/* Search trace ring buffer, dump file and decoder (see trace.h). */
+#include "trace.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define TRACE_MAGIC "KTR1"
+
+typedef struct {
+  char magic[4];
+  uint32_t board_size;
+  uint32_t event_size;
+  uint32_t reserved;
+  uint64_t written;
+  uint64_t count;
+} TraceHeader;
+
+_Static_assert(sizeof(TraceEvent) == 16, "trace events are 16 bytes in files");
+
+// Ring of at least `events` events (rounded up to a power of two)
+TraceBuffer *trace_create(uint64_t events) {
+  uint64_t capacity = 1;
+  while (capacity < events) capacity <<= 1;
+
+  TraceBuffer *trace = calloc(1, sizeof(TraceBuffer));
+  if (!trace) return NULL;
+
+  /* Touch the whole ring now, not while searching */
+  trace->events = calloc(capacity, sizeof(TraceEvent));
+  if (!trace->events) {
+    free(trace);
+    return NULL;
+  }
+  trace->mask = capacity - 1;
+  return trace;
+}
+
+void trace_free(TraceBuffer *trace) {
+  if (!trace) return;
+  free(trace->events);
+  free(trace);
+}
+
+void trace_clear(TraceBuffer *trace) {
+  trace->written = 0;
+}
+
+// Write the kept events to a file
+bool trace_dump(const TraceBuffer *trace, const char *path) {
+  FILE *f = fopen(path, "wb");
+  if (!f) return false;
+
+  uint64_t capacity = trace->mask + 1;
+  uint64_t count = trace->written < capacity ? trace->written : capacity;
+  uint64_t first = trace->written - count;
+
+  TraceHeader header = {
+    .board_size = BOARD_SIZE, .event_size = sizeof(TraceEvent),
+    .written = trace->written, .count = count
+  };
+  memcpy(header.magic, TRACE_MAGIC, 4);
+  bool ok = fwrite(&header, sizeof(header), 1, f) == 1;
+
+  /* Oldest first: the tail of the ring, then its head */
+  uint64_t start = first & trace->mask;
+  uint64_t tail = count < capacity - start ? count : capacity - start;
+  ok = ok && fwrite(&trace->events[start], sizeof(TraceEvent), tail, f) == tail;
+  ok = ok && fwrite(trace->events, sizeof(TraceEvent), count - tail, f) == count - tail;
+
+  return fclose(f) == 0 && ok;
+}
+
+TraceLog *trace_load(const char *path) {
+  FILE *f = fopen(path, "rb");
+  if (!f) return NULL;
+
+  TraceHeader header;
+  TraceLog *log = calloc(1, sizeof(TraceLog));
+  bool ok = log && fread(&header, sizeof(header), 1, f) == 1 &&
+            memcmp(header.magic, TRACE_MAGIC, 4) == 0 && header.board_size == BOARD_SIZE &&
+            header.event_size == sizeof(TraceEvent) && header.count <= header.written;
+
+  if (ok) {
+    log->events = malloc(header.count * sizeof(TraceEvent) + 1);
+    log->count = header.count;
+    log->written = header.written;
+    ok = log->events && fread(log->events, sizeof(TraceEvent), log->count, f) == log->count;
+  }
+  fclose(f);
+
+  if (!ok) {
+    trace_log_free(log);
+    return NULL;
+  }
+  return log;
+}
+
+void trace_log_free(TraceLog *log) {
+  if (!log) return;
+  free(log->events);
+  free(log);
+}
+
+// Ply that fits the per-ply tables (a damaged file may hold anything)
+static bool ply_in_range(int ply) {
+  return ply <= TOTAL_CELLS;
+}
+
+static void print_score(int score, FILE *out) {
+  if (score >= TRACE_SCORE_INF) fprintf(out, "inf");
+  else if (score <= -TRACE_SCORE_INF) fprintf(out, "-inf");
+  else fprintf(out, "%d", score);
+}
+
+static void print_move(MoveKey key, FILE *out) {
+  MoveSequence seq;
+  char text[MOVE_TEXT_MAX];
+
+  if (key && move_key_unpack(key, &seq)) {
+    move_sequence_to_text(&seq, text);
+    fprintf(out, "%s", text);
+  } else {
+    fprintf(out, "%s", key ? "?" : "root");
+  }
+}
+
+// Nodes per ply with their kinds, and the iterations
+void trace_print_stats(const TraceLog *log, FILE *out) {
+  enum { KINDS = 5 };   // nodes, leaf, hash, cutoff, terminal
+  uint64_t counts[TOTAL_CELLS + 1][KINDS] = { { 0 } };
+  uint64_t children[TOTAL_CELLS + 1] = { 0 };
+  int max_ply = -1;
+
+  fprintf(out, "%llu events (%llu written, %llu overwritten)\n", (unsigned long long)log->count,
+          (unsigned long long)log->written, (unsigned long long)(log->written - log->count));
+
+  for (uint64_t i = 0; i < log->count; i++) {
+    const TraceEvent *e = &log->events[i];
+
+    if (e->kind == TRACE_ITERATION) {
+      fprintf(out, "iteration depth %d score ", e->depth);
+      print_score(e->score, out);
+      fprintf(out, " best ");
+      print_move(e->move, out);
+      fprintf(out, "\n");
+      continue;
+    }
+    if (e->kind != TRACE_NODE || !ply_in_range(e->ply)) continue;
+
+    uint64_t *c = counts[e->ply];
+    c[0]++;
+    if (e->flags & TRACE_LEAF) c[1]++;
+    if (e->flags & TRACE_HASH) c[2]++;
+    if (e->flags & TRACE_CUTOFF) c[3]++;
+    if (e->flags & TRACE_TERMINAL) c[4]++;
+    children[e->ply] += e->moves;
+    if (e->ply > max_ply) max_ply = e->ply;
+  }
+
+  fprintf(out, "ply       nodes        leaf        hash      cutoff    terminal  moves/node\n");
+  for (int p = 0; p <= max_ply; p++) {
+    uint64_t *c = counts[p];
+    uint64_t interior = c[0] - c[1] - c[2] - c[4];
+    fprintf(out, "%3d %11llu %11llu %11llu %11llu %11llu %11.2f\n", p,
+            (unsigned long long)c[0], (unsigned long long)c[1], (unsigned long long)c[2],
+            (unsigned long long)c[3], (unsigned long long)c[4],
+            interior ? (double)children[p] / interior : 0.0);
+  }
+}
+
+typedef struct {
+  const TraceLog *log;
+  int64_t *first_child;
+  int64_t *next_sibling;
+  int max_ply;
+  FILE *out;
+} TreePrinter;
+
+static void print_node(const TreePrinter *tp, int64_t i) {
+  const TraceEvent *e = &tp->log->events[i];
+
+  fprintf(tp->out, "%*s", 2 * e->ply, "");
+  print_move(e->move, tp->out);
+  fprintf(tp->out, " [");
+  print_score(e->alpha, tp->out);
+  fprintf(tp->out, ", ");
+  print_score(e->beta, tp->out);
+  fprintf(tp->out, "] d%d -> ", e->depth);
+  print_score(e->score, tp->out);
+  if (e->moves) fprintf(tp->out, " (%d moves)", e->moves);
+  if (e->flags & TRACE_CUTOFF) fprintf(tp->out, " cutoff");
+  if (e->flags & TRACE_HASH) fprintf(tp->out, " hash");
+  if (e->flags & TRACE_LEAF) fprintf(tp->out, " leaf");
+  if (e->flags & TRACE_TERMINAL) fprintf(tp->out, " terminal");
+  fprintf(tp->out, "\n");
+
+  if (tp->max_ply >= 0 && e->ply >= tp->max_ply) return;
+  for (int64_t c = tp->first_child[i]; c >= 0; c = tp->next_sibling[c]) print_node(tp, c);
+}
+
+/* Print what is waiting for a parent, shallowest first (deeper lists are
+   only left over where the ring dropped the parents), and clear it */
+static void flush_pending(const TreePrinter *tp, int64_t *pending) {
+  for (int p = 0; p < TOTAL_CELLS + 2; p++) {
+    /* Lists are built newest first; put them back in search order */
+    int64_t prev = -1;
+    for (int64_t c = pending[p]; c >= 0;) {
+      int64_t next = tp->next_sibling[c];
+      tp->next_sibling[c] = prev;
+      prev = c;
+      c = next;
+    }
+    if (p > 0 && prev >= 0) fprintf(tp->out, "(parents overwritten)\n");
+    for (int64_t c = prev; c >= 0; c = tp->next_sibling[c]) print_node(tp, c);
+    pending[p] = -1;
+  }
+}
+
+// The tree, indented by ply, down to max_ply (< 0 = all)
+void trace_print_tree(const TraceLog *log, int max_ply, FILE *out) {
+  int64_t *first_child = malloc(log->count * sizeof(int64_t) + 1);
+  int64_t *next_sibling = malloc(log->count * sizeof(int64_t) + 1);
+  int64_t pending[TOTAL_CELLS + 2];
+
+  if (!first_child || !next_sibling) {
+    free(first_child);
+    free(next_sibling);
+    return;
+  }
+
+  TreePrinter tp = { log, first_child, next_sibling, max_ply, out };
+  for (int p = 0; p < TOTAL_CELLS + 2; p++) pending[p] = -1;
+
+  for (uint64_t i = 0; i < log->count; i++) {
+    const TraceEvent *e = &log->events[i];
+
+    if (e->kind == TRACE_ITERATION) {
+      flush_pending(&tp, pending);
+      fprintf(out, "== iteration depth %d score ", e->depth);
+      print_score(e->score, out);
+      fprintf(out, " best ");
+      print_move(e->move, out);
+      fprintf(out, "\n");
+      continue;
+    }
+    if (e->kind != TRACE_NODE || !ply_in_range(e->ply)) continue;
+
+    /* Children finished before their parent, in reverse order on pending[ply + 1];
+       flip them into search order */
+    int64_t prev = -1;
+    for (int64_t c = pending[e->ply + 1]; c >= 0;) {
+      int64_t next = next_sibling[c];
+      next_sibling[c] = prev;
+      prev = c;
+      c = next;
+    }
+    first_child[i] = prev;
+    pending[e->ply + 1] = -1;
+
+    next_sibling[i] = pending[e->ply];
+    pending[e->ply] = (int64_t)i;
+  }
+
+  /* A search stopped mid-iteration leaves its partial tree */
+  flush_pending(&tp, pending);
+  free(first_child);
+  free(next_sibling);
+}
@@ -0,0 +1,112 @@
+/* Layered transposition table. A slot whose layer is above the root
+   watermark counts as free: releasing a layer costs nothing, and those
+   slots are recycled before any live entry is replaced. */
+#include "tt.h"
+#include "profile.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Allocate / free a table of roughly size_mb megabytes
+TransTable *tt_create(size_t size_mb) {
+  TransTable *tt = calloc(1, sizeof(TransTable));
+  if (!tt) return NULL;
+
+  size_t bytes = (size_mb ? size_mb : 1) * 1024 * 1024;
+  size_t buckets = 1;
+  while (buckets * 2 * TT_BUCKET_SIZE * sizeof(TTEntry) <= bytes) buckets *= 2;
+
+  tt->entries = calloc(buckets * TT_BUCKET_SIZE, sizeof(TTEntry));
+  if (!tt->entries) {
+    free(tt);
+    return NULL;
+  }
+
+  tt->bucket_mask = buckets - 1;
+  tt->root_layer = TOTAL_CELLS;
+  return tt;
+}
+
+void tt_free(TransTable *tt) {
+  if (!tt) return;
+  free(tt->entries);
+  free(tt);
+}
+
+void tt_clear(TransTable *tt) {
+  memset(tt->entries, 0, (tt->bucket_mask + 1) * TT_BUCKET_SIZE * sizeof(TTEntry));
+  tt->root_layer = TOTAL_CELLS;
+  tt->probes = tt->hits = tt->stores = 0;
+}
+
+// Move the root to a position with `stones` stones, releasing higher layers
+void tt_set_root(TransTable *tt, int stones) {
+  if (stones < 0) stones = 0;
+  if (stones > TOTAL_CELLS) stones = TOTAL_CELLS;
+  tt->root_layer = stones;
+}
+
+static bool slot_live(const TransTable *tt, const TTEntry *e) {
+  return e->key != 0 && e->layer <= tt->root_layer;
+}
+
+// Probe for a position; NULL on miss
+const TTEntry *tt_probe(TransTable *tt, uint64_t key, int layer) {
+  PROFILE_PHASE(PROF_HASH);
+  TTEntry *bucket = &tt->entries[(key & tt->bucket_mask) * TT_BUCKET_SIZE];
+  tt->probes++;
+
+  for (int i = 0; i < TT_BUCKET_SIZE; i++) {
+    if (bucket[i].key == key && bucket[i].layer == layer && slot_live(tt, &bucket[i])) {
+      tt->hits++;
+      return &bucket[i];
+    }
+  }
+
+  return NULL;
+}
+
+/* Replacement: same position first, then released (or empty) slots, then
+   the live entry with the shallowest draft; among equal drafts the one
+   with fewer stones goes, since its subtree is the cheapest to redo. */
+void tt_store(TransTable *tt, uint64_t key, int layer, int depth,
+              int score, TTBound bound, MoveKey move) {
+  PROFILE_PHASE(PROF_HASH);
+  TTEntry *bucket = &tt->entries[(key & tt->bucket_mask) * TT_BUCKET_SIZE];
+  TTEntry *victim = NULL;
+
+  for (int i = 0; i < TT_BUCKET_SIZE; i++) {
+    TTEntry *e = &bucket[i];
+
+    if (e->key == key && e->layer == layer && slot_live(tt, e)) {
+      /* Keep a deeper result, but always remember the newer best move */
+      if (depth < e->depth) {
+        if (move) e->move = move;
+        return;
+      }
+      victim = e;
+      break;
+    }
+
+    if (!slot_live(tt, e)) {
+      if (!victim || slot_live(tt, victim)) victim = e;
+      continue;
+    }
+
+    if (!victim) {
+      victim = e;
+    } else if (slot_live(tt, victim) &&
+               (e->depth < victim->depth ||
+                (e->depth == victim->depth && e->layer < victim->layer))) {
+      victim = e;
+    }
+  }
+
+  victim->key = key;
+  victim->move = move;
+  victim->score = score > TT_SCORE_MAX ? TT_SCORE_MAX :
+                  score < -TT_SCORE_MAX ? -TT_SCORE_MAX : score;
+  victim->depth = (uint32_t)depth;
+  victim->bound = bound;
+  victim->layer = (uint32_t)layer;
+  tt->stores++;
+}
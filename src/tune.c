@@ -0,0 +1,299 @@
+/* Texel tuning of the evaluation weights (see tune.h). The positions are
+   decoded from the archive in one pass, then every pass over them (term
+   extraction, loss and gradient) is cut into one slice per pool worker. */
+#include "tune.h"
+#include "pool.h"
+#include "record.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#define TUNE_CHECK_EVERY 100
+#define TUNE_MIN_GAIN 1e-7
+
+typedef struct {
+  Board *boards;
+  bool *white;                       // side to move
+  uint8_t *wins;                     // 1 = side to move went on to win
+  int16_t (*terms)[EVAL_NUM_TERMS];  // from the side to move
+  bool *usable;                      // not decided
+  size_t count;
+} TuneData;
+
+typedef enum { PASS_TERMS, PASS_GRADIENT } TunePass;
+
+typedef struct {
+  TuneData *data;
+  size_t begin, end;
+  TunePass pass;
+  double k;
+  const double *weights;
+  double loss;                       // sum over the slice
+  double grad[EVAL_NUM_TERMS];
+  PoolTask task;
+} TuneSlice;
+
+TuneConfig tune_default_config(void) {
+  TuneConfig config = {
+    .archive_path = RECORD_DEF_PATH,
+    .out_path = EVAL_WEIGHTS_DEF_PATH,
+    .threads = 0,
+    .iterations = TUNE_DEF_ITERATIONS,
+    .rate = TUNE_DEF_RATE,
+    .progress = true
+  };
+  return config;
+}
+
+// log(1 + e^x) without overflow
+static double softplus(double x) {
+  return (x > 0 ? x : 0.0) + log1p(exp(-fabs(x)));
+}
+
+static void tune_worker(void *arg) {
+  TuneSlice *s = arg;
+  TuneData *d = s->data;
+
+  if (s->pass == PASS_TERMS) {
+    for (size_t i = s->begin; i < s->end; i++) {
+      int terms[EVAL_NUM_TERMS];
+      d->usable[i] = eval_terms(&d->boards[i], terms);
+      for (int t = 0; t < EVAL_NUM_TERMS; t++)
+        d->terms[i][t] = (int16_t)(d->white[i] ? terms[t] : -terms[t]);
+    }
+    return;
+  }
+
+  /* Loss -log(p) for a win and -log(1 - p) for a loss, p = sigmoid(k * score);
+     its derivative for weight t is k * (p - result) * term t */
+  double loss = 0.0, grad[EVAL_NUM_TERMS] = { 0 };
+  for (size_t i = s->begin; i < s->end; i++) {
+    const int16_t *f = d->terms[i];
+    double score = 0.0;
+    for (int t = 0; t < EVAL_NUM_TERMS; t++) score += s->weights[t] * f[t];
+
+    double z = s->k * score;
+    loss += softplus(d->wins[i] ? -z : z);
+    double err = s->k * (1.0 / (1.0 + exp(-z)) - d->wins[i]);
+    for (int t = 0; t < EVAL_NUM_TERMS; t++) grad[t] += err * f[t];
+  }
+
+  s->loss = loss;
+  memcpy(s->grad, grad, sizeof(grad));
+}
+
+// Run one pass over the data, a slice per task
+static void run_pass(Pool *pool, TuneSlice *slices, int threads, TunePass pass, double k,
+                     const double *weights) {
+  PoolGroup group = { 0 };
+
+  for (int t = 0; t < threads; t++) {
+    slices[t].pass = pass;
+    slices[t].k = k;
+    slices[t].weights = weights;
+    pool_spawn(pool, &group, &slices[t].task, tune_worker, &slices[t]);
+  }
+  pool_wait(pool, &group);
+}
+
+// Mean loss and gradient over all slices
+static double mean_loss(Pool *pool, TuneSlice *slices, int threads, size_t count, double k,
+                        const double *weights, double *grad) {
+  run_pass(pool, slices, threads, PASS_GRADIENT, k, weights);
+
+  double loss = 0.0;
+  if (grad) memset(grad, 0, EVAL_NUM_TERMS * sizeof(double));
+  for (int t = 0; t < threads; t++) {
+    loss += slices[t].loss;
+    if (grad)
+      for (int w = 0; w < EVAL_NUM_TERMS; w++) grad[w] += slices[t].grad[w] / count;
+  }
+  return loss / count;
+}
+
+// Split [0, count) into one slice per thread
+static void make_slices(TuneSlice *slices, int threads, TuneData *data, size_t count) {
+  for (int t = 0; t < threads; t++) {
+    slices[t].data = data;
+    slices[t].begin = count * t / threads;
+    slices[t].end = count * (t + 1) / threads;
+  }
+}
+
+// Every position of every finished game, with the result for its side to move
+static bool load_positions(const char *path, TuneData *data, TuneResult *result) {
+  Archive *archive = archive_open(path);
+  if (!archive) return false;
+
+  size_t capacity = 1 << 16;
+  data->boards = malloc(capacity * sizeof(Board));
+  data->white = malloc(capacity * sizeof(bool));
+  data->wins = malloc(capacity * sizeof(uint8_t));
+  bool ok = data->boards && data->white && data->wins;
+
+  ArchivePositions it;
+  Board board;
+  bool white;
+  int winner;
+
+  archive_positions_begin(archive, &it);
+  while (ok && archive_positions_next(&it, &board, &white, NULL, &winner)) {
+    if (winner == RECORD_UNFINISHED) {
+      result->skipped++;
+      continue;
+    }
+
+    if (data->count == capacity) {
+      capacity *= 2;
+      Board *boards = realloc(data->boards, capacity * sizeof(Board));
+      if (boards) data->boards = boards;
+      bool *sides = realloc(data->white, capacity * sizeof(bool));
+      if (sides) data->white = sides;
+      uint8_t *wins = realloc(data->wins, capacity * sizeof(uint8_t));
+      if (wins) data->wins = wins;
+      ok = boards && sides && wins;
+      if (!ok) break;
+    }
+
+    data->boards[data->count] = board;
+    data->white[data->count] = white;
+    data->wins[data->count++] = winner == (white ? RECORD_WHITE_WINS : RECORD_BLACK_WINS);
+  }
+
+  result->games = archive_count(archive);
+  archive_close(archive);
+  return ok;
+}
+
+static void free_data(TuneData *data) {
+  free(data->boards);
+  free(data->white);
+  free(data->wins);
+  free(data->terms);
+  free(data->usable);
+}
+
+// Tune the weights on an archive; false if it cannot be read or holds no usable position
+bool tune_run(const TuneConfig *config, TuneResult *result) {
+  if (!config || !result || config->iterations < 0) return false;
+  memset(result, 0, sizeof(*result));
+  memcpy(result->weights, eval_weights, sizeof(result->weights));
+
+  Pool *pool = pool_acquire(config->threads);
+  if (!pool) return false;
+  int threads = pool_threads(pool);
+
+  double start = wall_seconds();
+  TuneData data = { 0 };
+  bool ok = load_positions(config->archive_path, &data, result);
+
+  if (ok) {
+    data.terms = malloc(data.count * sizeof(*data.terms) + 1);
+    data.usable = malloc(data.count * sizeof(bool) + 1);
+    ok = data.terms && data.usable;
+  }
+
+  TuneSlice slices[POOL_MAX_THREADS];
+
+  /* Terms in parallel, then keep the undecided positions */
+  if (ok) {
+    make_slices(slices, threads, &data, data.count);
+    run_pass(pool, slices, threads, PASS_TERMS, 0.0, NULL);
+
+    size_t kept = 0;
+    for (size_t i = 0; i < data.count; i++) {
+      if (!data.usable[i]) continue;
+      memcpy(data.terms[kept], data.terms[i], sizeof(data.terms[i]));
+      data.wins[kept++] = data.wins[i];
+    }
+    result->skipped += data.count - kept;
+    data.count = result->positions = kept;
+    ok = kept > 0;
+  }
+  result->extract_seconds = wall_seconds() - start;
+
+  if (!ok) {
+    free_data(&data);
+    pool_release(pool);
+    return false;
+  }
+
+  make_slices(slices, threads, &data, data.count);
+  double weights[EVAL_NUM_TERMS];
+  for (int t = 0; t < EVAL_NUM_TERMS; t++) weights[t] = eval_weights[t];
+
+  /* k: golden-section search on log k for the starting weights */
+  double lo = log(1e-5), hi = 0.0, ratio = (sqrt(5.0) - 1) / 2;
+  double a = hi - ratio * (hi - lo), b = lo + ratio * (hi - lo);
+  double loss_a = mean_loss(pool, slices, threads, data.count, exp(a), weights, NULL);
+  double loss_b = mean_loss(pool, slices, threads, data.count, exp(b), weights, NULL);
+  for (int i = 0; i < 40; i++) {
+    if (loss_a < loss_b) {
+      hi = b;
+      b = a;
+      loss_b = loss_a;
+      a = hi - ratio * (hi - lo);
+      loss_a = mean_loss(pool, slices, threads, data.count, exp(a), weights, NULL);
+    } else {
+      lo = a;
+      a = b;
+      loss_a = loss_b;
+      b = lo + ratio * (hi - lo);
+      loss_b = mean_loss(pool, slices, threads, data.count, exp(b), weights, NULL);
+    }
+  }
+  result->k = exp((lo + hi) / 2);
+  result->loss_before = mean_loss(pool, slices, threads, data.count, result->k, weights, NULL);
+
+  /* Adam on the weights */
+  double m[EVAL_NUM_TERMS] = { 0 }, v[EVAL_NUM_TERMS] = { 0 }, grad[EVAL_NUM_TERMS];
+  const double beta1 = 0.9, beta2 = 0.999;
+  double beta1_t = 1.0, beta2_t = 1.0;
+
+  double checkpoint = result->loss_before;
+  for (int it = 1; it <= config->iterations; it++) {
+    double loss = mean_loss(pool, slices, threads, data.count, result->k, weights, grad);
+    result->iterations = it;
+
+    /* Converged: stop once TUNE_CHECK_EVERY iterations gain next to nothing */
+    if (it % TUNE_CHECK_EVERY == 0) {
+      if (checkpoint - loss < TUNE_MIN_GAIN) break;
+      checkpoint = loss;
+    }
+    beta1_t *= beta1;
+    beta2_t *= beta2;
+
+    for (int t = 0; t < EVAL_NUM_TERMS; t++) {
+      m[t] = beta1 * m[t] + (1 - beta1) * grad[t];
+      v[t] = beta2 * v[t] + (1 - beta2) * grad[t] * grad[t];
+      weights[t] -= config->rate * (m[t] / (1 - beta1_t)) / (sqrt(v[t] / (1 - beta2_t)) + 1e-12);
+    }
+
+    if (config->progress && config->iterations >= 10 && it % (config->iterations / 10) == 0) {
+      printf("iteration %5d: loss %.6f\n", it, loss);
+      fflush(stdout);
+    }
+  }
+
+  for (int t = 0; t < EVAL_NUM_TERMS; t++) {
+    result->weights[t] = (int)lround(weights[t]);
+    weights[t] = result->weights[t];
+  }
+  result->loss_after = mean_loss(pool, slices, threads, data.count, result->k, weights, NULL);
+  result->seconds = wall_seconds() - start;
+
+  free_data(&data);
+  pool_release(pool);
+  if (config->out_path) return eval_weights_save(result->weights, config->out_path);
+  return true;
+}
+
+void print_tune_result(const TuneResult *result) {
+  printf("%llu games, %llu positions (%llu skipped), terms in %.2fs, %.2fs in all\n",
+         (unsigned long long)result->games, (unsigned long long)result->positions,
+         (unsigned long long)result->skipped, result->extract_seconds, result->seconds);
+  printf("k %.6f, loss %.6f -> %.6f after %d iterations\n", result->k, result->loss_before,
+         result->loss_after, result->iterations);
+  for (int t = 0; t < EVAL_NUM_TERMS; t++)
+    printf("  %-16s %5d -> %5d\n", eval_term_names[t], eval_weights[t], result->weights[t]);
+}
@@ -1,6 +1,21 @@
 /* Minimal text-based UI for selecting gameplay and benchmarks. */
 #include "ui.h"
 #include "perft.h"
+#include "solver.h"
+
+// Ask which engine an AI player uses
+static PlayerType choose_engine(const char *who) {
+  int n = -1;
+
+  while (n < 1 || n > 3) {
+    printf("%s engine: (1) Negamax (2) MCTS (3) Random\n> ", who);
+    if (scanf("%d", &n) != 1) return PLAYER_TYPE_AI_NEGAMAX;
+  }
+
+  if (n == 2) return PLAYER_TYPE_AI_MCTS;
+  if (n == 3) return PLAYER_TYPE_AI_RANDOM;
+  return PLAYER_TYPE_AI_NEGAMAX;
+}
 
 // Display main menu
 void main_menu(void) {
@@ -8,8 +23,8 @@ void main_menu(void) {
 
   int n = -1;
 
-  while (n < 1 || n > 4) {
-    printf("(1) Play PvP\n(2) Play PvAI\n(3) Watch AIvAI\n(4) Perft / Benchmarks\n");
+  while (n < 1 || n > 5) {
+    printf("(1) Play PvP\n(2) Play PvAI\n(3) Watch AIvAI\n(4) Perft / Benchmarks\n(5) Solve position\n");
     printf("> ");
     scanf("%d", &n);
   }
@@ -21,15 +36,54 @@ void main_menu(void) {
       break;
     case 2:
       /* Player vs AI */
-      run_game(GAME_MODE_HUMAN_VS_AI);
+      {
+        PlayerType ai = choose_engine("AI");
+        run_game_players(GAME_MODE_HUMAN_VS_AI, ai, ai);
+      }
       break;  
     case 3:
       /* AI vs AI spectator mode */
-      run_game(GAME_MODE_AI_VS_AI);
+      {
+        PlayerType black_ai = choose_engine("Black AI");
+        PlayerType white_ai = choose_engine("White AI");
+        run_game_players(GAME_MODE_AI_VS_AI, black_ai, white_ai);
+      }
       break;
     case 4:
       /* Perft and benchmarking utilities */
       perft_menu();
       break;
+    case 5:
+      /* Exact win/loss proof with the df-pn solver */
+      solver_menu();
+      break;
   }
-} 
\ No newline at end of file
+} 
+
+// Interactive solver (asks for the opening removals)
+void solver_menu(void) {
+  Board board;
+  init_board(&board);
+
+  int row, col;
+
+  print_board(&board);
+  do {
+    printf("Black removal (corner/center): ");
+  } while (!read_coord(&row, &col) || !execute_initial_removal(&board, row, col, true));
+
+  do {
+    printf("White removal (adjacent): ");
+  } while (!read_coord(&row, &col) || !execute_initial_removal(&board, row, col, false));
+
+  int hash_mb = SOLVER_DEF_HASH_MB;
+  printf("Hash size in MB [%d]: ", SOLVER_DEF_HASH_MB);
+  if (scanf("%d", &hash_mb) != 1 || hash_mb <= 0) hash_mb = SOLVER_DEF_HASH_MB;
+
+  print_board(&board);
+  printf("Solving (Black to move)...\n");
+
+  SolveResult result;
+  solve_position(&board, false, (size_t)hash_mb, SOLVER_DEF_NODES, &result);
+  print_solve_result(&result, false);
+}